@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+
+namespace hscpp { namespace mem {
+
+    // Range of virtual address space reserved up front, whose pages are committed as allocations
+    // reach them. Allocations never move, and all memory in the arena is released at once when the
+    // arena is destroyed. Freed allocations are decommitted and merged with adjacent free ranges.
+    // Allocations are served from the lowest free range large enough to hold them, and the top
+    // moves back over free ranges that reach it.
+    class Arena
+    {
+    public:
+        // If bUseHugePages is set, the range is aligned to huge pages and, where supported, the OS
+        // is advised to back it with transparent huge pages.
+        Arena(uint64_t reservedSize, bool bUseHugePages);
+        ~Arena();
+
+        Arena(const Arena& rhs) = delete;
+        Arena& operator=(const Arena& rhs) = delete;
+
+        // False if the address space could not be reserved.
+        bool IsValid() const;
+
+        // Throws an std::bad_alloc once the reserved range is exhausted, as new would.
+        uint8_t* Allocate(uint64_t size);
+        void Free(uint8_t* pMemory);
+
+        uint64_t GetReservedSize() const;
+        uint64_t GetCommittedSize() const;
+
+    private:
+        static const uint64_t ALIGNMENT = 64;
+        static const uint64_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+        uint8_t* m_pReservation = nullptr;
+        uint64_t m_ReservationSize = 0;
+
+        uint8_t* m_pBegin = nullptr;
+        uint8_t* m_pEnd = nullptr;
+        uint8_t* m_pTop = nullptr;
+        uint8_t* m_pCommittedEnd = nullptr;
+
+        uint64_t m_PageSize = 0;
+        uint64_t m_CommitSize = 0;
+
+        std::unordered_map<uint8_t*, uint64_t> m_SizesByAllocation;
+        std::map<uint8_t*, uint64_t> m_FreeSizesByAddress; // Ordered, so that neighbours can be merged.
+
+        mutable std::mutex m_Mutex;
+
+        bool Commit(uint8_t* pBegin, uint8_t* pEnd);
+        void Decommit(uint8_t* pBegin, uint8_t* pEnd);
+    };
+
+}}
\ No newline at end of file
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <atomic>
+
 namespace hscpp { namespace mem {
 
     // Use an IMemoryManager to avoid circular dependency between Ref and MemoryManager.
@@ -14,6 +16,22 @@ namespace hscpp { namespace mem {
 
         virtual ~IMemoryManager() = default;
         virtual uint8_t* GetMemory(uint64_t id) = 0;
+
+        // State of a Block that is shared with Refs. The state of each Block is stored at a fixed
+        // address for the lifetime of the IMemoryManager.
+        struct BlockState
+        {
+            uint8_t* pMemory = nullptr; // Updated on a runtime swap.
+            std::atomic<uint32_t> generation = { 0 }; // Incremented when the Block is freed, to detect reuse of its id.
+            std::atomic<uint32_t> nSharedRefs = { 0 };
+
+            // Destroys the object, without freeing its Block. Set when the object becomes shared, so
+            // that any SharedRef or WeakRef releasing the last reference can destroy it.
+            void (*pDestroy)(uint8_t* pMemory) = nullptr;
+        };
+
+        virtual BlockState* GetBlockState(uint64_t id) = 0;
+
         virtual void FreeBlock(uint64_t id, bool bReleaseReservation) = 0;
     };
 
@@ -1,13 +1,20 @@
 #pragma once
 
 #include <vector>
+#include <atomic>
 #include <cstdint>
+#include <cstddef>
 #include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 
 #include "hscpp/module/IAllocator.h"
 #include "hscpp/module/AllocationResolver.h"
 #include "hscpp/mem/Ref.h"
 #include "hscpp/mem/IMemoryManager.h"
+#include "hscpp/mem/Arena.h"
 
 namespace hscpp { namespace mem {
 
@@ -29,10 +36,43 @@ namespace hscpp { namespace mem {
             // Overridable Allocate/Free functions.
             std::function<uint8_t*(uint64_t size)> AllocateCb;
             std::function<void(uint8_t* pMemory)> FreeCb;
+
+            // Allocate objects from slabs, rather than calling AllocateCb once per object. Objects
+            // of the same size and alignment share slabs, and the BlockHeader is kept out of line,
+            // so that objects are aligned to alignof(T).
+            bool bUseSlabs = false;
+
+            // Size of each slab allocated through AllocateCb. Objects larger than a slab are given
+            // a slab of their own.
+            uint64_t slabSize = 64 * 1024;
+
+            // Allow objects to be allocated and freed from several threads at once. Each thread
+            // caches free Blocks and slots, so that most allocations and frees do not take a lock.
+            // The Block table grows without moving existing Blocks, so Refs can be dereferenced
+            // without locking. AllocateCb and FreeCb must be thread-safe.
+            //
+            // Tracked types may be allocated and freed on any thread. A runtime swap replaces every
+            // tracked object, so other threads must not use or free tracked objects while a swap
+            // is in progress.
+            bool bThreadSafe = false;
+
+            // When every instance of a type is swapped at once, pack the new instances into the
+            // lowest free slots, and free slabs left empty by the old instances. Requires bUseSlabs.
+            bool bCompactOnSwap = false;
+
+            // If nonzero, reserve this much address space up front, and allocate from it in place of
+            // AllocateCb and FreeCb. Pages are committed as they are first used, and all memory is
+            // released at once when the MemoryManager is destroyed. Best combined with bUseSlabs.
+            uint64_t arenaSize = 0;
+
+            // Align the arena to huge pages, and ask the OS to back it with transparent huge pages.
+            bool bUseHugePages = false;
         };
 
         static UniqueRef<MemoryManager> Create(const Config& config = Config());
 
+        ~MemoryManager();
+
         template <typename T>
         UniqueRef<T> Allocate();
 
@@ -40,46 +80,166 @@ namespace hscpp { namespace mem {
         // calling the destructor.
 
         uint64_t GetNumBlocks() const;
+        uint64_t GetNumSlabs() const;
+
+        // nullptr if Config::arenaSize was zero, or the address space could not be reserved.
+        const Arena* GetArena() const;
+
+        // Free empty slabs, and make subsequent allocations fill the lowest free slots. Objects are
+        // only relocated during a runtime swap, as only hscpp knows how to move them. Slots cached
+        // by the calling thread, or by threads that have exited, are returned first. Slots cached
+        // by other running threads keep their slabs alive.
+        void Compact();
 
     private:
+        // Header of a chunk of memory holding several Blocks, allocated in Hscpp_AllocateSwapBatch.
+        // The chunk is freed once each of its Blocks has been freed.
+        struct ChunkHeader
+        {
+            std::atomic<uint64_t> nBlocks = { 0 }; // Blocks of a chunk may be freed on several threads.
+            uint64_t reserved = 0;
+        };
+
         struct BlockHeader
         {
             uint64_t iBlock = INVALID_ID;
+            ChunkHeader* pChunk = nullptr; // nullptr if this Block was allocated individually.
+            uint8_t* pAllocation = nullptr; // Memory returned by AllocateCb, if allocated individually.
         };
 
-        struct Block
+        struct Slab;
+
+        struct Slot
         {
-            // Get BlockHeader at location: pMemory - sizeof(BlockHeader)
             uint8_t* pMemory = nullptr;
+            Slab* pSlab = nullptr;
+        };
+
+        // Slabs holding objects with the same slot size and alignment.
+        struct SizeClass
+        {
+            uint64_t key = 0;
+            uint64_t slotSize = 0;
+            uint64_t alignment = 0;
+            std::vector<Slot> freeSlots;
+        };
+
+        // Memory divided into equally sized slots. The Block using each slot is stored here rather
+        // than in a BlockHeader, so that slots are not offset from their alignment.
+        struct Slab
+        {
+            SizeClass* pSizeClass = nullptr;
+            uint8_t* pAllocation = nullptr; // Memory returned by AllocateCb.
+            uint8_t* pBegin = nullptr;
+            uint8_t* pEnd = nullptr;
+            std::vector<uint64_t> blockBySlot;
+            uint64_t nUsedSlots = 0;
+        };
+
+        struct Block : public BlockState
+        {
+            // If pSlab is nullptr, get BlockHeader at location: pMemory - sizeof(BlockHeader)
+            Slab* pSlab = nullptr;
+        };
+
+        // Free Blocks and slots held by a single thread, when thread-safe. Cached Blocks remain
+        // reserved, and cached slots remain counted as used by their slab, until they are flushed
+        // back to the shared lists. When a thread exits, its cache is adopted by the next thread
+        // to use the MemoryManager.
+        struct ThreadCache
+        {
+            std::atomic<bool> bOwned = { true };
+
+            std::vector<uint64_t> freeBlocks;
+            std::atomic<uint64_t> nFreeBlocks = { 0 }; // Size of freeBlocks, read by GetNumBlocks.
+
+            std::unordered_map<uint64_t, std::vector<Slot>> freeSlotsByKey; // By SizeClass key.
         };
 
+        // Number of Blocks or slots moved between a ThreadCache and the shared lists at once. A
+        // cache that grows to twice this size is flushed back down to it.
+        static const size_t CACHE_BATCH_SIZE = 32;
+
         AllocationResolver* m_pAllocationResolver = nullptr;
 
         std::function<uint8_t*(uint64_t size)> m_AllocateCb;
         std::function<void(uint8_t* pMemory)> m_FreeCb;
 
-        std::vector<Block> m_Blocks;
+        std::unique_ptr<Arena> m_pArena;
+
+        // Blocks are stored in segments, which are never moved once allocated. This allows Refs to
+        // point directly at the state of their Block, which is updated on a swap, and allows other
+        // threads to use the table while it grows. Segment k holds FIRST_SEGMENT_SIZE * 2^k Blocks.
+        static const uint64_t FIRST_SEGMENT_SIZE = 1024;
+        static const size_t MAX_SEGMENTS = 48;
+
+        std::unique_ptr<Block[]> m_BlockSegments[MAX_SEGMENTS];
+        uint64_t m_nBlocks = 0;
+
+        bool m_bThreadSafe = false;
+        mutable std::mutex m_Mutex;
+
+        // Unique across MemoryManagers, so that each thread can find its cache for this instance.
+        uint64_t m_InstanceId = 0;
+        std::vector<std::shared_ptr<ThreadCache>> m_ThreadCaches;
+
+        // State of the Ref to the MemoryManager itself.
+        BlockState m_SelfState;
 
         uint64_t m_iFreeBlocksBegin = 0;
         std::vector<uint64_t> m_FreeBlockIndices;
         std::vector<uint64_t> m_FreeBlockIndexByBlock;
 
+        bool m_bUseSlabs = false;
+        bool m_bCompactOnSwap = false;
+        uint64_t m_SlabSize = 0;
+
+        std::unordered_map<uint64_t, SizeClass> m_SizeClassesByKey;
+        std::vector<std::unique_ptr<Slab>> m_Slabs;
+
+        // Slabs by the address of their end, used to find the slab holding a given address.
+        std::map<uintptr_t, Slab*> m_SlabsByEnd;
+
         MemoryManager() = default;
 
         // hscpp::mem::IMemoryManager
         // Used by Ref to get underlying memory for a given id. Note that the returned pointer
         // may change for the same id, should a runtime swap take place.
         uint8_t* GetMemory(uint64_t id) override;
+        BlockState* GetBlockState(uint64_t id) override;
         void FreeBlock(uint64_t iBlock, bool bReleaseReservation) override;
 
         // hscpp::IAllocator
         AllocationInfo Hscpp_Allocate(uint64_t size) override;
+        AllocationInfo Hscpp_AllocateAligned(uint64_t size, uint64_t alignment) override;
         AllocationInfo Hscpp_AllocateSwap(uint64_t previousId, uint64_t size) override;
+        AllocationInfo Hscpp_AllocateSwapAligned(uint64_t previousId, uint64_t size, uint64_t alignment) override;
+        void Hscpp_AllocateSwapBatch(const uint64_t* pPreviousIds, size_t nInstances,
+            uint64_t size, uint64_t alignment, AllocationInfo* pInfos) override;
         uint64_t Hscpp_FreeSwap(uint8_t* pMemory) override;
 
         // Helper methods
-        uint8_t* AllocateBlock(uint64_t size, uint64_t iBlock);
+        Block& GetBlock(uint64_t iBlock);
+        static size_t GetSegment(uint64_t iBlock, uint64_t& iInSegment);
+        std::unique_lock<std::mutex> Lock() const;
+        ThreadCache& GetThreadCache();
+        void FlushThreadCache(ThreadCache& cache, size_t nMaxCached);
+        uint8_t* AllocateNewBlock(uint64_t size, uint64_t alignment, uint64_t iBlock);
+        uint8_t* AllocateBlock(uint64_t size, uint64_t alignment, uint64_t iBlock);
+        uint8_t* AllocateSlot(uint64_t size, uint64_t alignment, uint64_t iBlock);
+        uint8_t* AllocateCachedSlot(uint64_t size, uint64_t alignment, uint64_t iBlock);
+        static uint64_t GetSizeClassKey(uint64_t& size, uint64_t& alignment);
+        SizeClass& GetSizeClass(uint64_t size, uint64_t alignment);
+        void AddSlab(SizeClass& sizeClass);
+        void SortFreeSlots(SizeClass& sizeClass);
+        void ReleaseEmptySlabs();
+        Slab* FindSlab(const uint8_t* pMemory);
+        void FreeBlockMemory(uint64_t iBlock);
+        void FreeBlockAllocation(uint64_t iBlock);
+        void FreeCachedBlock(uint64_t iBlock);
         uint64_t ReserveFirstFreeBlock();
+        uint64_t ReserveBlock();
+        void ReleaseBlock(uint64_t iBlock);
     };
 
     template<typename T>
@@ -102,12 +262,13 @@ namespace hscpp { namespace mem {
             uint64_t size = sizeof(typename std::aligned_storage<sizeof(T)>::type);
 
             iBlock = ReserveFirstFreeBlock();
-            uint8_t* pMemory = AllocateBlock(size, iBlock);
+            uint8_t* pMemory = AllocateNewBlock(size, alignof(T), iBlock);
             new (pMemory) T;
         }
 
         ref.m_Id = iBlock;
         ref.m_pMemoryManager = this;
+        ref.m_ppMemory = &GetBlockState(iBlock)->pMemory;
         return ref;
     }
 
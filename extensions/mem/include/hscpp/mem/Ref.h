@@ -9,6 +9,15 @@ namespace hscpp { namespace mem {
     {
         friend class MemoryManager;
 
+        template <typename U>
+        friend class SharedRef;
+
+        template <typename U>
+        friend class WeakRef;
+
+        template <typename U>
+        friend class FastRef;
+
     public:
         T* operator->() const
         {
@@ -29,6 +38,9 @@ namespace hscpp { namespace mem {
         uint64_t m_Id = IMemoryManager::INVALID_ID;
         IMemoryManager* m_pMemoryManager = nullptr;
 
+        // Address of the memory pointer of this Ref's Block, which is updated on a runtime swap.
+        uint8_t* const* m_ppMemory = nullptr;
+
         // Throws an std::runtime_error on a nullptr access. This makes it possible to catch
         // a null dereference on Linux and macOS with the hscpp::DoProtectedCall wrapper, and fix
         // the error during runtime (on Windows, a nullptr exception can always be caught).
@@ -39,24 +51,23 @@ namespace hscpp { namespace mem {
                 throw std::runtime_error("Ref is null (MemoryManager == nullptr).");
             }
 
-            T* pT = reinterpret_cast<T*>(m_pMemoryManager->GetMemory(m_Id));
-            if (pT == nullptr)
+            if (m_ppMemory == nullptr || *m_ppMemory == nullptr)
             {
                 throw std::runtime_error("Ref is null.");
             }
 
-            return pT;
+            return reinterpret_cast<T*>(*m_ppMemory);
         }
 
         // No std::runtime_error throw on a nullptr access.
         T* GetMemoryUnsafe() const
         {
-            if (m_pMemoryManager == nullptr)
+            if (m_ppMemory == nullptr)
             {
                 return nullptr;
             }
 
-            return reinterpret_cast<T*>(m_pMemoryManager->GetMemory(m_Id));
+            return reinterpret_cast<T*>(*m_ppMemory);
         }
 
     };
@@ -66,6 +77,9 @@ namespace hscpp { namespace mem {
     {
         friend class MemoryManager;
 
+        template <typename U>
+        friend class SharedRef;
+
         // Do not allow copy.
         UniqueRef(const UniqueRef<T>& rhs) = delete;
         UniqueRef<T>& operator=(const UniqueRef<T>& rhs) = delete;
@@ -106,6 +120,7 @@ namespace hscpp { namespace mem {
             }
 
             this->m_Id = IMemoryManager::INVALID_ID;
+            this->m_ppMemory = nullptr;
         }
 
         ~UniqueRef()
@@ -118,9 +133,294 @@ namespace hscpp { namespace mem {
         {
             this->m_Id = rhs.m_Id;
             this->m_pMemoryManager = rhs.m_pMemoryManager;
+            this->m_ppMemory = rhs.m_ppMemory;
+
+            rhs.m_Id = IMemoryManager::INVALID_ID;
+            rhs.m_pMemoryManager = nullptr;
+            rhs.m_ppMemory = nullptr;
+        }
+    };
+
+    // Ref with shared ownership. The count of SharedRefs is stored in the Block's state, and the
+    // object is destroyed when the last SharedRef is freed. Like a UniqueRef, it follows the object
+    // across a runtime swap.
+    template <typename T>
+    class SharedRef : public Ref<T>
+    {
+        template <typename U>
+        friend class WeakRef;
+
+    public:
+        SharedRef() = default;
+
+        SharedRef(UniqueRef<T>&& rhs)
+        {
+            if (rhs.m_pMemoryManager != nullptr && rhs.m_Id != IMemoryManager::INVALID_ID)
+            {
+                rhs.m_pMemoryManager->GetBlockState(rhs.m_Id)->pDestroy = &Destroy;
+                Acquire(rhs.m_Id, rhs.m_pMemoryManager);
+            }
 
             rhs.m_Id = IMemoryManager::INVALID_ID;
             rhs.m_pMemoryManager = nullptr;
+            rhs.m_ppMemory = nullptr;
+        }
+
+        SharedRef(const SharedRef<T>& rhs)
+        {
+            Copy(rhs);
+        }
+
+        SharedRef(SharedRef<T>&& rhs) noexcept
+        {
+            Move(std::move(rhs));
+        }
+
+        SharedRef<T>& operator=(const SharedRef<T>& rhs)
+        {
+            if (this != &rhs)
+            {
+                Free();
+                Copy(rhs);
+            }
+
+            return *this;
+        }
+
+        SharedRef<T>& operator=(SharedRef<T>&& rhs) noexcept
+        {
+            if (this != &rhs)
+            {
+                Free();
+                Move(std::move(rhs));
+            }
+
+            return *this;
+        }
+
+        // Release this reference, destroying the object if it was the last SharedRef to it.
+        void Free()
+        {
+            if (m_pState != nullptr)
+            {
+                Release(this->m_Id, this->m_pMemoryManager, m_pState);
+            }
+
+            this->m_Id = IMemoryManager::INVALID_ID;
+            this->m_pMemoryManager = nullptr;
+            this->m_ppMemory = nullptr;
+            m_pState = nullptr;
+        }
+
+        uint32_t GetNumSharedRefs() const
+        {
+            return (m_pState == nullptr) ? 0 : m_pState->nSharedRefs.load();
+        }
+
+        ~SharedRef()
+        {
+            Free();
+        }
+
+    private:
+        IMemoryManager::BlockState* m_pState = nullptr;
+
+        static void Destroy(uint8_t* pMemory)
+        {
+            reinterpret_cast<T*>(pMemory)->~T();
+        }
+
+        // Release a reference to a Block, destroying its object if it was the last reference. The
+        // object is destroyed through the Block's state, as the Block may have been reused by an
+        // object of another type since a WeakRef was locked.
+        static void Release(uint64_t id, IMemoryManager* pMemoryManager, IMemoryManager::BlockState* pState)
+        {
+            if (--pState->nSharedRefs == 0)
+            {
+                if (id == IMemoryManager::MEMORY_MANAGER_ID)
+                {
+                    delete pMemoryManager;
+                }
+                else
+                {
+                    pState->pDestroy(pState->pMemory);
+                    pMemoryManager->FreeBlock(id, true);
+                }
+            }
+        }
+
+        void Acquire(uint64_t id, IMemoryManager* pMemoryManager)
+        {
+            Adopt(id, pMemoryManager);
+            m_pState->nSharedRefs++;
+        }
+
+        // Refer to a Block whose shared reference count has already been incremented.
+        void Adopt(uint64_t id, IMemoryManager* pMemoryManager)
+        {
+            this->m_Id = id;
+            this->m_pMemoryManager = pMemoryManager;
+
+            m_pState = pMemoryManager->GetBlockState(id);
+            this->m_ppMemory = &m_pState->pMemory;
+        }
+
+        void Copy(const SharedRef<T>& rhs)
+        {
+            if (rhs.m_pState != nullptr)
+            {
+                Acquire(rhs.m_Id, rhs.m_pMemoryManager);
+            }
+        }
+
+        void Move(SharedRef<T>&& rhs) noexcept
+        {
+            this->m_Id = rhs.m_Id;
+            this->m_pMemoryManager = rhs.m_pMemoryManager;
+            this->m_ppMemory = rhs.m_ppMemory;
+            m_pState = rhs.m_pState;
+
+            rhs.m_Id = IMemoryManager::INVALID_ID;
+            rhs.m_pMemoryManager = nullptr;
+            rhs.m_ppMemory = nullptr;
+            rhs.m_pState = nullptr;
+        }
+    };
+
+    // Non-owning reference, which detects when its object has been freed. The generation of the
+    // Block is saved on construction, and compared to the Block's current generation on access, so
+    // that reuse of the Block by another object is detected in constant time. A runtime swap does
+    // not change the generation, so a WeakRef follows the object across a swap.
+    template <typename T>
+    class WeakRef
+    {
+    public:
+        WeakRef() = default;
+
+        WeakRef(const Ref<T>& ref)
+        {
+            if (ref.m_pMemoryManager != nullptr && ref.m_Id != IMemoryManager::INVALID_ID)
+            {
+                m_Id = ref.m_Id;
+                m_pMemoryManager = ref.m_pMemoryManager;
+                m_pState = m_pMemoryManager->GetBlockState(m_Id);
+                m_Generation = m_pState->generation;
+            }
+        }
+
+        bool IsExpired() const
+        {
+            return m_pState == nullptr || m_pState->generation != m_Generation || m_pState->pMemory == nullptr;
+        }
+
+        // Get a SharedRef to the object, which is null if the object has been freed or is not owned
+        // by SharedRefs.
+        SharedRef<T> Lock() const
+        {
+            SharedRef<T> ref;
+            if (IsExpired())
+            {
+                return ref;
+            }
+
+            // Only increment the count while another SharedRef holds the object. Otherwise, the last
+            // SharedRef could free the object between checking the count and incrementing it.
+            uint32_t nSharedRefs = m_pState->nSharedRefs.load();
+            do
+            {
+                if (nSharedRefs == 0)
+                {
+                    return ref;
+                }
+            } while (!m_pState->nSharedRefs.compare_exchange_weak(nSharedRefs, nSharedRefs + 1));
+
+            // The Block may have been freed and reused by another object before the increment. That
+            // object's owners may have released it since, so release the reference as they would.
+            if (IsExpired())
+            {
+                SharedRef<T>::Release(m_Id, m_pMemoryManager, m_pState);
+                return ref;
+            }
+
+            ref.Adopt(m_Id, m_pMemoryManager);
+            return ref;
+        }
+
+        // Throws an std::runtime_error if the object has been freed, as with Ref.
+        T* operator->() const
+        {
+            return GetMemory();
+        }
+
+        T* operator*() const
+        {
+            return GetMemory();
+        }
+
+        T* operator&() const
+        {
+            return GetMemory();
+        }
+
+    private:
+        uint64_t m_Id = IMemoryManager::INVALID_ID;
+        IMemoryManager* m_pMemoryManager = nullptr;
+        IMemoryManager::BlockState* m_pState = nullptr;
+        uint32_t m_Generation = 0;
+
+        T* GetMemory() const
+        {
+            if (IsExpired())
+            {
+                throw std::runtime_error("WeakRef has expired.");
+            }
+
+            return reinterpret_cast<T*>(m_pState->pMemory);
+        }
+    };
+
+    // Ref which dereferences with a single load, for code that dereferences Refs in hot loops. Like
+    // a Ref, a FastRef points at the memory pointer of its Block, so it follows the object across a
+    // runtime swap. Null accesses throw an std::runtime_error only in debug builds, and a FastRef
+    // must not outlive its MemoryManager.
+    template <typename T>
+    class FastRef
+    {
+    public:
+        FastRef() = default;
+
+        FastRef(const Ref<T>& ref)
+            : m_ppMemory(ref.m_ppMemory)
+        {}
+
+        T* operator->() const
+        {
+            return GetMemory();
+        }
+
+        T* operator*() const
+        {
+            return GetMemory();
+        }
+
+        T* operator&() const
+        {
+            return GetMemory();
+        }
+
+    private:
+        uint8_t* const* m_ppMemory = nullptr;
+
+        T* GetMemory() const
+        {
+#ifndef NDEBUG
+            if (m_ppMemory == nullptr || *m_ppMemory == nullptr)
+            {
+                throw std::runtime_error("FastRef is null.");
+            }
+#endif
+
+            return reinterpret_cast<T*>(*m_ppMemory);
         }
     };
 
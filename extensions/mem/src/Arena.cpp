@@ -0,0 +1,255 @@
+#include <algorithm>
+#include <iterator>
+#include <new>
+
+#include "hscpp/mem/Arena.h"
+
+#if defined(_WIN32)
+    #include <Windows.h>
+#else
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
+
+namespace hscpp { namespace mem {
+
+    static uint8_t* AlignUp(uint8_t* pMemory, uint64_t alignment)
+    {
+        uintptr_t address = reinterpret_cast<uintptr_t>(pMemory);
+        return reinterpret_cast<uint8_t*>((address + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1));
+    }
+
+    static uint8_t* AlignDown(uint8_t* pMemory, uint64_t alignment)
+    {
+        uintptr_t address = reinterpret_cast<uintptr_t>(pMemory);
+        return reinterpret_cast<uint8_t*>(address & ~static_cast<uintptr_t>(alignment - 1));
+    }
+
+    Arena::Arena(uint64_t reservedSize, bool bUseHugePages)
+    {
+#if defined(_WIN32)
+        SYSTEM_INFO systemInfo;
+        GetSystemInfo(&systemInfo);
+        m_PageSize = systemInfo.dwPageSize;
+#else
+        m_PageSize = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+#endif
+
+        // Commit in large steps, to avoid a system call on every allocation. With huge pages, commit
+        // whole huge pages, so that the OS can back them with a single TLB entry.
+        m_CommitSize = bUseHugePages ? HUGE_PAGE_SIZE : (std::max)(m_PageSize, static_cast<uint64_t>(64 * 1024));
+
+        uint64_t size = (reservedSize + m_CommitSize - 1) / m_CommitSize * m_CommitSize;
+        uint64_t alignment = bUseHugePages ? HUGE_PAGE_SIZE : m_PageSize;
+
+        // Over-reserve, so that the usable range can be aligned to a huge page.
+        m_ReservationSize = size + alignment - m_PageSize;
+
+#if defined(_WIN32)
+        m_pReservation = static_cast<uint8_t*>(VirtualAlloc(nullptr,
+            static_cast<SIZE_T>(m_ReservationSize), MEM_RESERVE, PAGE_NOACCESS));
+#else
+        int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    #if defined(MAP_NORESERVE)
+        flags |= MAP_NORESERVE;
+    #endif
+
+        void* pReservation = mmap(nullptr, static_cast<size_t>(m_ReservationSize), PROT_NONE, flags, -1, 0);
+        m_pReservation = (pReservation == MAP_FAILED) ? nullptr : static_cast<uint8_t*>(pReservation);
+#endif
+
+        if (m_pReservation == nullptr)
+        {
+            m_ReservationSize = 0;
+            return;
+        }
+
+        m_pBegin = AlignUp(m_pReservation, alignment);
+        m_pEnd = m_pBegin + size;
+        m_pTop = m_pBegin;
+        m_pCommittedEnd = m_pBegin;
+
+#if defined(MADV_HUGEPAGE)
+        if (bUseHugePages)
+        {
+            // Only a hint. If transparent huge pages are disabled, regular pages are used.
+            madvise(m_pBegin, static_cast<size_t>(size), MADV_HUGEPAGE);
+        }
+#endif
+    }
+
+    Arena::~Arena()
+    {
+        if (m_pReservation == nullptr)
+        {
+            return;
+        }
+
+        // Release every allocation at once.
+#if defined(_WIN32)
+        VirtualFree(m_pReservation, 0, MEM_RELEASE);
+#else
+        munmap(m_pReservation, static_cast<size_t>(m_ReservationSize));
+#endif
+    }
+
+    bool Arena::IsValid() const
+    {
+        return m_pReservation != nullptr;
+    }
+
+    uint8_t* Arena::Allocate(uint64_t size)
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+
+        if (m_pReservation == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+
+        size = ((std::max)(size, static_cast<uint64_t>(1)) + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+
+        // Reuse the lowest free range that is large enough, recommitting the pages it uses. First
+        // fit keeps allocations low in the arena, so that free ranges near the top can be released.
+        for (auto freeIt = m_FreeSizesByAddress.begin(); freeIt != m_FreeSizesByAddress.end(); ++freeIt)
+        {
+            if (freeIt->second < size)
+            {
+                continue;
+            }
+
+            uint8_t* pMemory = freeIt->first;
+            if (!Commit(AlignDown(pMemory, m_PageSize), AlignUp(pMemory + size, m_PageSize)))
+            {
+                throw std::bad_alloc();
+            }
+
+            uint64_t remainingSize = freeIt->second - size;
+            m_FreeSizesByAddress.erase(freeIt);
+
+            if (remainingSize > 0)
+            {
+                m_FreeSizesByAddress.emplace(pMemory + size, remainingSize);
+            }
+
+            m_SizesByAllocation[pMemory] = size;
+            return pMemory;
+        }
+
+        if (size > static_cast<uint64_t>(m_pEnd - m_pTop))
+        {
+            throw std::bad_alloc();
+        }
+
+        uint8_t* pMemory = m_pTop;
+        if (pMemory + size > m_pCommittedEnd)
+        {
+            uint8_t* pCommittedEnd = (std::min)(AlignUp(pMemory + size, m_CommitSize), m_pEnd);
+            if (!Commit(m_pCommittedEnd, pCommittedEnd))
+            {
+                throw std::bad_alloc();
+            }
+
+            m_pCommittedEnd = pCommittedEnd;
+        }
+
+        m_pTop += size;
+        m_SizesByAllocation[pMemory] = size;
+
+        return pMemory;
+    }
+
+    void Arena::Free(uint8_t* pMemory)
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+
+        auto sizeIt = m_SizesByAllocation.find(pMemory);
+        if (sizeIt == m_SizesByAllocation.end())
+        {
+            return; // Equivalent to deleting a nullptr.
+        }
+
+        uint64_t size = sizeIt->second;
+        m_SizesByAllocation.erase(sizeIt);
+
+        // Merge with the free ranges directly before and after this allocation.
+        uint8_t* pBegin = pMemory;
+        uint8_t* pEnd = pMemory + size;
+
+        auto nextIt = m_FreeSizesByAddress.lower_bound(pMemory);
+        if (nextIt != m_FreeSizesByAddress.end() && nextIt->first == pEnd)
+        {
+            pEnd += nextIt->second;
+            nextIt = m_FreeSizesByAddress.erase(nextIt);
+        }
+
+        if (nextIt != m_FreeSizesByAddress.begin())
+        {
+            auto previousIt = std::prev(nextIt);
+            if (previousIt->first + previousIt->second == pBegin)
+            {
+                pBegin = previousIt->first;
+                m_FreeSizesByAddress.erase(previousIt);
+            }
+        }
+
+        // Return pages that are no longer shared with other allocations to the OS. Pages at the
+        // edges of this allocation may now lie entirely within the merged range. The address range
+        // stays reserved.
+        Decommit((std::max)(AlignUp(pBegin, m_PageSize), AlignDown(pMemory, m_PageSize)),
+            (std::min)(AlignDown(pEnd, m_PageSize), AlignUp(pMemory + size, m_PageSize)));
+
+        if (pEnd == m_pTop)
+        {
+            // The range reaches the top, so move the top back rather than keeping it for reuse.
+            // Decommitted pages below the committed end will be committed again when the top
+            // reaches them.
+            m_pTop = pBegin;
+            m_pCommittedEnd = (std::min)(m_pCommittedEnd, AlignUp(pBegin, m_PageSize));
+        }
+        else
+        {
+            m_FreeSizesByAddress.emplace(pBegin, static_cast<uint64_t>(pEnd - pBegin));
+        }
+    }
+
+    uint64_t Arena::GetReservedSize() const
+    {
+        return static_cast<uint64_t>(m_pEnd - m_pBegin);
+    }
+
+    uint64_t Arena::GetCommittedSize() const
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        return static_cast<uint64_t>(m_pCommittedEnd - m_pBegin);
+    }
+
+    bool Arena::Commit(uint8_t* pBegin, uint8_t* pEnd)
+    {
+        if (pBegin >= pEnd)
+        {
+            return true;
+        }
+
+#if defined(_WIN32)
+        return VirtualAlloc(pBegin, static_cast<SIZE_T>(pEnd - pBegin), MEM_COMMIT, PAGE_READWRITE) != nullptr;
+#else
+        return mprotect(pBegin, static_cast<size_t>(pEnd - pBegin), PROT_READ | PROT_WRITE) == 0;
+#endif
+    }
+
+    void Arena::Decommit(uint8_t* pBegin, uint8_t* pEnd)
+    {
+        if (pBegin >= pEnd)
+        {
+            return;
+        }
+
+#if defined(_WIN32)
+        VirtualFree(pBegin, static_cast<SIZE_T>(pEnd - pBegin), MEM_DECOMMIT);
+#else
+        madvise(pBegin, static_cast<size_t>(pEnd - pBegin), MADV_DONTNEED);
+#endif
+    }
+
+}}
\ No newline at end of file
@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include "hscpp/mem/MemoryManager.h"
 
 namespace hscpp { namespace mem {
@@ -8,20 +10,111 @@ namespace hscpp { namespace mem {
         pMemoryManager->m_pAllocationResolver = config.pAllocationResolver;
         pMemoryManager->m_AllocateCb = config.AllocateCb;
         pMemoryManager->m_FreeCb = config.FreeCb;
-        pMemoryManager->m_Blocks.reserve(config.reservedBlocks);
+
+        if (config.arenaSize > 0)
+        {
+            // If the address space could not be reserved, fall back to AllocateCb and FreeCb.
+            std::unique_ptr<Arena> pArena(new Arena(config.arenaSize, config.bUseHugePages));
+            if (pArena->IsValid())
+            {
+                Arena* pRawArena = pArena.get();
+                pMemoryManager->m_AllocateCb = [pRawArena](uint64_t size) {
+                    return pRawArena->Allocate(size);
+                };
+
+                pMemoryManager->m_FreeCb = [pRawArena](uint8_t* pMemory) {
+                    pRawArena->Free(pMemory);
+                };
+
+                pMemoryManager->m_pArena = std::move(pArena);
+            }
+        }
+
         pMemoryManager->m_FreeBlockIndices.reserve(config.reservedBlocks);
         pMemoryManager->m_FreeBlockIndexByBlock.reserve(config.reservedBlocks);
+        pMemoryManager->m_bUseSlabs = config.bUseSlabs;
+        pMemoryManager->m_SlabSize = config.slabSize;
+        pMemoryManager->m_bThreadSafe = config.bThreadSafe;
+        pMemoryManager->m_bCompactOnSwap = config.bCompactOnSwap;
+        pMemoryManager->m_SelfState.pMemory = reinterpret_cast<uint8_t*>(pMemoryManager);
+
+        static std::atomic<uint64_t> s_nInstances = { 0 };
+        pMemoryManager->m_InstanceId = ++s_nInstances;
 
         UniqueRef<MemoryManager> ref;
         ref.m_pMemoryManager = pMemoryManager;
         ref.m_Id = IMemoryManager::MEMORY_MANAGER_ID;
+        ref.m_ppMemory = &pMemoryManager->GetBlockState(ref.m_Id)->pMemory;
 
         return std::move(ref);
     }
 
+    MemoryManager::~MemoryManager()
+    {
+        if (m_pArena != nullptr)
+        {
+            // Slabs are released along with the arena.
+            return;
+        }
+
+        for (const auto& pSlab : m_Slabs)
+        {
+            m_FreeCb(pSlab->pAllocation);
+        }
+    }
+
     uint64_t MemoryManager::GetNumBlocks() const
     {
-        return m_iFreeBlocksBegin;
+        std::unique_lock<std::mutex> lock = Lock();
+
+        // Blocks cached by threads are reserved, but not in use.
+        uint64_t nCachedBlocks = 0;
+        for (const auto& pCache : m_ThreadCaches)
+        {
+            nCachedBlocks += pCache->nFreeBlocks.load(std::memory_order_relaxed);
+        }
+
+        return m_iFreeBlocksBegin - nCachedBlocks;
+    }
+
+    uint64_t MemoryManager::GetNumSlabs() const
+    {
+        std::unique_lock<std::mutex> lock = Lock();
+        return m_Slabs.size();
+    }
+
+    const Arena* MemoryManager::GetArena() const
+    {
+        return m_pArena.get();
+    }
+
+    void MemoryManager::Compact()
+    {
+        ThreadCache* pOwnCache = m_bThreadSafe ? &GetThreadCache() : nullptr;
+
+        std::unique_lock<std::mutex> lock = Lock();
+
+        if (pOwnCache != nullptr)
+        {
+            FlushThreadCache(*pOwnCache, 0);
+        }
+
+        // Caches of threads that have exited are only adopted under the lock, so they can be flushed.
+        for (const auto& pCache : m_ThreadCaches)
+        {
+            if (!pCache->bOwned.load(std::memory_order_acquire))
+            {
+                FlushThreadCache(*pCache, 0);
+            }
+        }
+
+        ReleaseEmptySlabs();
+
+        // Fill the lowest free slots first, so that new objects are packed into the fewest slabs.
+        for (auto& key__sizeClass : m_SizeClassesByKey)
+        {
+            SortFreeSlots(key__sizeClass.second);
+        }
     }
 
     uint8_t* MemoryManager::GetMemory(uint64_t id)
@@ -33,7 +126,20 @@ namespace hscpp { namespace mem {
             case IMemoryManager::MEMORY_MANAGER_ID:
                 return reinterpret_cast<uint8_t*>(this);
             default:
-                return m_Blocks.at(id).pMemory;
+                return GetBlock(id).pMemory;
+        }
+    }
+
+    IMemoryManager::BlockState* MemoryManager::GetBlockState(uint64_t id)
+    {
+        switch (id)
+        {
+            case IMemoryManager::INVALID_ID:
+                return nullptr;
+            case IMemoryManager::MEMORY_MANAGER_ID:
+                return &m_SelfState;
+            default:
+                return &GetBlock(id);
         }
     }
 
@@ -46,37 +152,41 @@ namespace hscpp { namespace mem {
             case IMemoryManager::MEMORY_MANAGER_ID:
                 break; // MemoryManager instance does not use any Block.
             default:
-                m_FreeCb(m_Blocks.at(iBlock).pMemory - sizeof(BlockHeader));
-                m_Blocks.at(iBlock).pMemory = nullptr;
-
-                if (bReleaseReservation)
+            {
+                if (m_bThreadSafe && bReleaseReservation)
                 {
-                    // Get the index of the last Block that is not free, in the free Block list.
-                    size_t iLastUsedBlock = m_FreeBlockIndices.at(m_iFreeBlocksBegin - 1);
-
-                    // Map the Block index to the free Block list.
-                    size_t iFreeBlock = m_FreeBlockIndexByBlock.at(iBlock);
+                    FreeCachedBlock(iBlock);
+                    break;
+                }
 
-                    // Swap freed Block with last taken Block before the free Blocks. Since the
-                    // number of free Blocks will be decremented, this will push the freed Block
-                    // into the free list.
-                    std::swap(m_FreeBlockIndices.at(iFreeBlock), m_FreeBlockIndices.at(m_iFreeBlocksBegin - 1));
+                std::unique_lock<std::mutex> lock = Lock();
+                FreeBlockMemory(iBlock);
 
-                    // Update the free Block list mapping.
-                    std::swap(m_FreeBlockIndexByBlock.at(iBlock), m_FreeBlockIndexByBlock.at(iLastUsedBlock));
+                if (bReleaseReservation)
+                {
+                    // The id may now be reused by another object. Invalidate WeakRefs to this one.
+                    Block& block = GetBlock(iBlock);
+                    block.generation++;
+                    block.nSharedRefs = 0;
 
-                    m_iFreeBlocksBegin--;
+                    ReleaseBlock(iBlock);
                 }
 
                 break;
+            }
         }
     }
 
     AllocationInfo MemoryManager::Hscpp_Allocate(uint64_t size)
+    {
+        return Hscpp_AllocateAligned(size, alignof(std::max_align_t));
+    }
+
+    AllocationInfo MemoryManager::Hscpp_AllocateAligned(uint64_t size, uint64_t alignment)
     {
         // Performing a generic allocation through hscpp.
         uint64_t iBlock = ReserveFirstFreeBlock();
-        uint8_t* pMemory = AllocateBlock(size, iBlock);
+        uint8_t* pMemory = AllocateNewBlock(size, alignment, iBlock);
 
         AllocationInfo info;
         info.id = iBlock;
@@ -86,57 +196,598 @@ namespace hscpp { namespace mem {
     }
 
     AllocationInfo MemoryManager::Hscpp_AllocateSwap(uint64_t previousId, uint64_t size)
+    {
+        return Hscpp_AllocateSwapAligned(previousId, size, alignof(std::max_align_t));
+    }
+
+    AllocationInfo MemoryManager::Hscpp_AllocateSwapAligned(uint64_t previousId, uint64_t size, uint64_t alignment)
     {
         // Performing a runtime swap of an HSCPP_TRACK object. Reuse the old Block, so that old
         // Refs will now refer to the newly allocated class.
         uint64_t iBlock = previousId;
-        AllocateBlock(size, iBlock);
+        AllocateBlock(size, alignment, iBlock);
 
         AllocationInfo info;
         info.id = iBlock;
-        info.pMemory = m_Blocks.at(iBlock).pMemory;
+        info.pMemory = GetBlock(iBlock).pMemory;
 
         return info;
     }
 
+    void MemoryManager::Hscpp_AllocateSwapBatch(const uint64_t* pPreviousIds, size_t nInstances,
+        uint64_t size, uint64_t alignment, AllocationInfo* pInfos)
+    {
+        if (nInstances == 0)
+        {
+            return;
+        }
+
+        if (m_bUseSlabs)
+        {
+            std::unique_lock<std::mutex> lock = Lock();
+
+            // Hand out free slots in order of address, so that instances swapped together are
+            // adjacent within their slabs.
+            SortFreeSlots(GetSizeClass(size, alignment));
+        }
+
+        // Blocks within a chunk are only aligned to sizeof(ChunkHeader), so allocate over-aligned
+        // types individually.
+        if (m_bUseSlabs || alignment > sizeof(ChunkHeader))
+        {
+            for (size_t i = 0; i < nInstances; ++i)
+            {
+                pInfos[i] = Hscpp_AllocateSwapAligned(pPreviousIds[i], size, alignment);
+            }
+
+            if (m_bUseSlabs && m_bCompactOnSwap)
+            {
+                // The old instances were freed before this batch, and the new instances have been
+                // packed into the lowest slots. Slabs that held only old instances are now empty.
+                std::unique_lock<std::mutex> lock = Lock();
+                ReleaseEmptySlabs();
+            }
+
+            return;
+        }
+
+        // Performing a runtime swap of every instance of a class. Rather than allocating each
+        // Block individually, place the new instances in a single chunk, so that they are
+        // contiguous in memory. As in Hscpp_AllocateSwap, the old Blocks are reused.
+        const uint64_t chunkAlignment = sizeof(ChunkHeader);
+        const uint64_t headerSize = (sizeof(BlockHeader) + chunkAlignment - 1) / chunkAlignment * chunkAlignment;
+        uint64_t stride = (headerSize + size + chunkAlignment - 1) / chunkAlignment * chunkAlignment;
+
+        uint8_t* pChunk = m_AllocateCb(sizeof(ChunkHeader) + stride * nInstances);
+
+        ChunkHeader* pChunkHeader = new (pChunk) ChunkHeader();
+        pChunkHeader->nBlocks = nInstances;
+
+        for (size_t i = 0; i < nInstances; ++i)
+        {
+            uint64_t iBlock = pPreviousIds[i];
+            uint8_t* pMemory = pChunk + sizeof(ChunkHeader) + stride * i + headerSize;
+
+            BlockHeader* pBlockHeader = new (pMemory - sizeof(BlockHeader)) BlockHeader();
+            pBlockHeader->iBlock = iBlock;
+            pBlockHeader->pChunk = pChunkHeader;
+
+            GetBlock(iBlock).pMemory = pMemory;
+
+            pInfos[i].id = iBlock;
+            pInfos[i].pMemory = GetBlock(iBlock).pMemory;
+        }
+    }
+
     uint64_t MemoryManager::Hscpp_FreeSwap(uint8_t* pMemory)
     {
         // Performing a free during a runtime swap. Return the old object id so that
         // HscppAllocateSwap knows the previous id of the deleted object. The Block's
         // memory will be freed, but its id will still be reserved.
-        uint64_t iBlock = reinterpret_cast<BlockHeader*>(pMemory - sizeof(BlockHeader))->iBlock;
+        uint64_t iBlock = IMemoryManager::INVALID_ID;
+
+        {
+            std::unique_lock<std::mutex> lock = Lock();
+
+            Slab* pSlab = FindSlab(pMemory);
+            if (pSlab != nullptr)
+            {
+                iBlock = pSlab->blockBySlot.at((pMemory - pSlab->pBegin) / pSlab->pSizeClass->slotSize);
+            }
+            else
+            {
+                iBlock = reinterpret_cast<BlockHeader*>(pMemory - sizeof(BlockHeader))->iBlock;
+            }
+        }
+
         FreeBlock(iBlock, false);
 
         return iBlock;
     }
 
-    uint8_t* MemoryManager::AllocateBlock(uint64_t size, uint64_t iBlock)
+    uint8_t* MemoryManager::AllocateNewBlock(uint64_t size, uint64_t alignment, uint64_t iBlock)
     {
+        // Swapped objects are allocated from the shared slot lists, so that they can be packed
+        // into the lowest slots. New objects are allocated from the calling thread's cache.
+        if (m_bThreadSafe && m_bUseSlabs)
+        {
+            return AllocateCachedSlot(size, alignment, iBlock);
+        }
+
+        return AllocateBlock(size, alignment, iBlock);
+    }
+
+    uint8_t* MemoryManager::AllocateBlock(uint64_t size, uint64_t alignment, uint64_t iBlock)
+    {
+        if (m_bUseSlabs)
+        {
+            return AllocateSlot(size, alignment, iBlock);
+        }
+
         // Allocate sizeof(BlockHeader) extra space, allowing Block info to be saved alongside
         // the pointer. This makes it possible to quickly find the index during an Hscpp_FreeSwap.
-        uint8_t* pMemory = m_AllocateCb(size + sizeof(BlockHeader));
+        // Over-allocate by the alignment, so that the object can be aligned past the BlockHeader.
+        alignment = (std::max)(alignment, static_cast<uint64_t>(alignof(std::max_align_t)));
+        uint8_t* pAllocation = m_AllocateCb(size + sizeof(BlockHeader) + alignment - 1);
+
+        uintptr_t address = reinterpret_cast<uintptr_t>(pAllocation + sizeof(BlockHeader));
+        address = (address + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+        uint8_t* pMemory = reinterpret_cast<uint8_t*>(address);
+
+        // The BlockHeader directly precedes the object.
+        BlockHeader* pBlockHeader = new (pMemory - sizeof(BlockHeader)) BlockHeader();
+        pBlockHeader->iBlock = iBlock;
+        pBlockHeader->pAllocation = pAllocation;
+
+        GetBlock(iBlock).pMemory = pMemory;
+        return pMemory;
+    }
 
-        reinterpret_cast<BlockHeader*>(pMemory)->iBlock = iBlock;
+    uint8_t* MemoryManager::AllocateSlot(uint64_t size, uint64_t alignment, uint64_t iBlock)
+    {
+        std::unique_lock<std::mutex> lock = Lock();
+
+        SizeClass& sizeClass = GetSizeClass(size, alignment);
+        if (sizeClass.freeSlots.empty())
+        {
+            AddSlab(sizeClass);
+        }
+
+        Slot slot = sizeClass.freeSlots.back();
+        sizeClass.freeSlots.pop_back();
+
+        slot.pSlab->blockBySlot.at((slot.pMemory - slot.pSlab->pBegin) / sizeClass.slotSize) = iBlock;
+
+        slot.pSlab->nUsedSlots++;
+
+        Block& block = GetBlock(iBlock);
+        block.pMemory = slot.pMemory;
+        block.pSlab = slot.pSlab;
+
+        return block.pMemory;
+    }
+
+    uint8_t* MemoryManager::AllocateCachedSlot(uint64_t size, uint64_t alignment, uint64_t iBlock)
+    {
+        ThreadCache& cache = GetThreadCache();
+
+        uint64_t slotSize = size;
+        uint64_t slotAlignment = alignment;
+        std::vector<Slot>& freeSlots = cache.freeSlotsByKey[GetSizeClassKey(slotSize, slotAlignment)];
+
+        if (freeSlots.empty())
+        {
+            std::unique_lock<std::mutex> lock = Lock();
+            SizeClass& sizeClass = GetSizeClass(size, alignment);
+
+            // Objects larger than a slab are given a slab each, so take no more than a slab's worth.
+            uint64_t nSlots = (std::min)(static_cast<uint64_t>(CACHE_BATCH_SIZE),
+                (std::max)(m_SlabSize / sizeClass.slotSize, static_cast<uint64_t>(1)));
+
+            for (uint64_t i = 0; i < nSlots; ++i)
+            {
+                if (sizeClass.freeSlots.empty())
+                {
+                    AddSlab(sizeClass);
+                }
+
+                freeSlots.push_back(sizeClass.freeSlots.back());
+                sizeClass.freeSlots.pop_back();
+
+                freeSlots.back().pSlab->nUsedSlots++;
+            }
+
+            // Slots are taken from the back, so reverse them to hand them out in order of address.
+            std::reverse(freeSlots.begin(), freeSlots.end());
+        }
+
+        Slot slot = freeSlots.back();
+        freeSlots.pop_back();
+
+        slot.pSlab->blockBySlot.at((slot.pMemory - slot.pSlab->pBegin) / slotSize) = iBlock;
+
+        Block& block = GetBlock(iBlock);
+        block.pMemory = slot.pMemory;
+        block.pSlab = slot.pSlab;
 
-        // Return memory past the BlockHeader.
-        m_Blocks.at(iBlock).pMemory = pMemory + sizeof(BlockHeader);
-        return m_Blocks.at(iBlock).pMemory;
+        return block.pMemory;
+    }
+
+    uint64_t MemoryManager::GetSizeClassKey(uint64_t& size, uint64_t& alignment)
+    {
+        // Slots are at least as aligned as memory returned by new, and are a multiple of their
+        // alignment in size, so that every slot in a slab is aligned. Size and alignment are
+        // rounded to those of the slot.
+        alignment = (std::max)(alignment, static_cast<uint64_t>(alignof(std::max_align_t)));
+        size = ((std::max)(size, static_cast<uint64_t>(1)) + alignment - 1) / alignment * alignment;
+
+        // Alignments are powers of two, so their log fits in the low bits of the key.
+        uint64_t log2Alignment = 0;
+        while ((static_cast<uint64_t>(1) << log2Alignment) < alignment)
+        {
+            ++log2Alignment;
+        }
+
+        return size << 6 | log2Alignment;
+    }
+
+    MemoryManager::SizeClass& MemoryManager::GetSizeClass(uint64_t size, uint64_t alignment)
+    {
+        uint64_t slotSize = size;
+        uint64_t slotAlignment = alignment;
+        uint64_t key = GetSizeClassKey(slotSize, slotAlignment);
+
+        SizeClass& sizeClass = m_SizeClassesByKey[key];
+        if (sizeClass.slotSize == 0)
+        {
+            sizeClass.key = key;
+            sizeClass.slotSize = slotSize;
+            sizeClass.alignment = slotAlignment;
+        }
+
+        return sizeClass;
+    }
+
+    void MemoryManager::AddSlab(SizeClass& sizeClass)
+    {
+        // Over-allocate so that the first slot can be aligned.
+        uint64_t allocationSize = (std::max)(m_SlabSize, sizeClass.slotSize) + sizeClass.alignment - 1;
+
+        std::unique_ptr<Slab> pSlab(new Slab());
+        pSlab->pSizeClass = &sizeClass;
+        pSlab->pAllocation = m_AllocateCb(allocationSize);
+
+        uintptr_t begin = reinterpret_cast<uintptr_t>(pSlab->pAllocation);
+        begin = (begin + sizeClass.alignment - 1) & ~static_cast<uintptr_t>(sizeClass.alignment - 1);
+
+        uint64_t padding = begin - reinterpret_cast<uintptr_t>(pSlab->pAllocation);
+        uint64_t nSlots = (allocationSize - padding) / sizeClass.slotSize;
+
+        pSlab->pBegin = reinterpret_cast<uint8_t*>(begin);
+        pSlab->pEnd = pSlab->pBegin + nSlots * sizeClass.slotSize;
+        pSlab->blockBySlot.resize(static_cast<size_t>(nSlots), static_cast<uint64_t>(IMemoryManager::INVALID_ID));
+
+        // Push slots in reverse, so that they are handed out in order of address.
+        for (uint64_t iSlot = nSlots; iSlot-- > 0;)
+        {
+            Slot slot;
+            slot.pMemory = pSlab->pBegin + iSlot * sizeClass.slotSize;
+            slot.pSlab = pSlab.get();
+
+            sizeClass.freeSlots.push_back(slot);
+        }
+
+        m_SlabsByEnd[reinterpret_cast<uintptr_t>(pSlab->pEnd)] = pSlab.get();
+        m_Slabs.push_back(std::move(pSlab));
+    }
+
+    void MemoryManager::SortFreeSlots(SizeClass& sizeClass)
+    {
+        // Slots are taken from the back of the list, so sort by descending address.
+        std::sort(sizeClass.freeSlots.begin(), sizeClass.freeSlots.end(), [](const Slot& lhs, const Slot& rhs) {
+            return lhs.pMemory > rhs.pMemory;
+        });
+    }
+
+    void MemoryManager::ReleaseEmptySlabs()
+    {
+        for (auto& key__sizeClass : m_SizeClassesByKey)
+        {
+            std::vector<Slot>& freeSlots = key__sizeClass.second.freeSlots;
+            freeSlots.erase(std::remove_if(freeSlots.begin(), freeSlots.end(), [](const Slot& slot) {
+                return slot.pSlab->nUsedSlots == 0;
+            }), freeSlots.end());
+        }
+
+        auto emptyBegin = std::partition(m_Slabs.begin(), m_Slabs.end(), [](const std::unique_ptr<Slab>& pSlab) {
+            return pSlab->nUsedSlots > 0;
+        });
+
+        for (auto it = emptyBegin; it != m_Slabs.end(); ++it)
+        {
+            m_SlabsByEnd.erase(reinterpret_cast<uintptr_t>((*it)->pEnd));
+            m_FreeCb((*it)->pAllocation);
+        }
+
+        m_Slabs.erase(emptyBegin, m_Slabs.end());
+    }
+
+    MemoryManager::Slab* MemoryManager::FindSlab(const uint8_t* pMemory)
+    {
+        // Find the first slab ending after pMemory, and check that it begins before pMemory.
+        auto it = m_SlabsByEnd.upper_bound(reinterpret_cast<uintptr_t>(pMemory));
+        if (it == m_SlabsByEnd.end() || pMemory < it->second->pBegin)
+        {
+            return nullptr;
+        }
+
+        return it->second;
+    }
+
+    void MemoryManager::FreeBlockMemory(uint64_t iBlock)
+    {
+        Block& block = GetBlock(iBlock);
+        if (block.pSlab != nullptr)
+        {
+            // Return the slot to its size class. Empty slabs are kept until compacted, or until the
+            // MemoryManager is destroyed.
+            Slot slot;
+            slot.pMemory = block.pMemory;
+            slot.pSlab = block.pSlab;
+            block.pSlab->pSizeClass->freeSlots.push_back(slot);
+            block.pSlab->nUsedSlots--;
+
+            block.pMemory = nullptr;
+            block.pSlab = nullptr;
+            return;
+        }
+
+        FreeBlockAllocation(iBlock);
+    }
+
+    void MemoryManager::FreeBlockAllocation(uint64_t iBlock)
+    {
+        BlockHeader* pBlockHeader = reinterpret_cast<BlockHeader*>(GetBlock(iBlock).pMemory - sizeof(BlockHeader));
+        ChunkHeader* pChunk = pBlockHeader->pChunk;
+
+        if (pChunk == nullptr)
+        {
+            m_FreeCb(pBlockHeader->pAllocation);
+        }
+        else if (--pChunk->nBlocks == 0)
+        {
+            // This was the last Block in use within its chunk.
+            m_FreeCb(reinterpret_cast<uint8_t*>(pChunk));
+        }
+
+        GetBlock(iBlock).pMemory = nullptr;
+    }
+
+    void MemoryManager::FreeCachedBlock(uint64_t iBlock)
+    {
+        ThreadCache& cache = GetThreadCache();
+        Block& block = GetBlock(iBlock);
+
+        std::vector<Slot>* pFreeSlots = nullptr;
+        if (block.pSlab != nullptr)
+        {
+            // The slot remains counted as used by its slab until it is flushed.
+            Slot slot;
+            slot.pMemory = block.pMemory;
+            slot.pSlab = block.pSlab;
+
+            pFreeSlots = &cache.freeSlotsByKey[block.pSlab->pSizeClass->key];
+            pFreeSlots->push_back(slot);
+
+            block.pMemory = nullptr;
+            block.pSlab = nullptr;
+        }
+        else
+        {
+            FreeBlockAllocation(iBlock);
+        }
+
+        // The id may now be reused by another object. Invalidate WeakRefs to this one.
+        block.generation++;
+        block.nSharedRefs = 0;
+
+        cache.freeBlocks.push_back(iBlock);
+        cache.nFreeBlocks.store(cache.freeBlocks.size(), std::memory_order_relaxed);
+
+        if (cache.freeBlocks.size() >= 2 * CACHE_BATCH_SIZE
+            || (pFreeSlots != nullptr && pFreeSlots->size() >= 2 * CACHE_BATCH_SIZE))
+        {
+            std::unique_lock<std::mutex> lock = Lock();
+            FlushThreadCache(cache, CACHE_BATCH_SIZE);
+        }
     }
 
     uint64_t MemoryManager::ReserveFirstFreeBlock()
+    {
+        if (!m_bThreadSafe)
+        {
+            return ReserveBlock();
+        }
+
+        ThreadCache& cache = GetThreadCache();
+        if (cache.freeBlocks.empty())
+        {
+            std::unique_lock<std::mutex> lock = Lock();
+            for (size_t i = 0; i < CACHE_BATCH_SIZE; ++i)
+            {
+                cache.freeBlocks.push_back(ReserveBlock());
+            }
+
+            // Hand out Blocks in the order they were reserved.
+            std::reverse(cache.freeBlocks.begin(), cache.freeBlocks.end());
+            cache.nFreeBlocks.store(cache.freeBlocks.size(), std::memory_order_relaxed);
+        }
+
+        uint64_t iBlock = cache.freeBlocks.back();
+        cache.freeBlocks.pop_back();
+        cache.nFreeBlocks.store(cache.freeBlocks.size(), std::memory_order_relaxed);
+
+        return iBlock;
+    }
+
+    uint64_t MemoryManager::ReserveBlock()
     {
         if (m_iFreeBlocksBegin == m_FreeBlockIndices.size())
         {
             // No free blocks remain, push back a new one.
             m_FreeBlockIndices.push_back(m_iFreeBlocksBegin);
             m_FreeBlockIndexByBlock.push_back(m_iFreeBlocksBegin);
-            m_Blocks.push_back(Block());
+            uint64_t iInSegment = 0;
+            size_t iSegment = GetSegment(m_nBlocks, iInSegment);
+            if (iInSegment == 0)
+            {
+                m_BlockSegments[iSegment].reset(new Block[FIRST_SEGMENT_SIZE << iSegment]);
+            }
+
+            ++m_nBlocks;
         }
 
         m_iFreeBlocksBegin++;
         return m_FreeBlockIndices.at(m_iFreeBlocksBegin - 1);
     }
 
+    void MemoryManager::ReleaseBlock(uint64_t iBlock)
+    {
+        // Get the index of the last Block that is not free, in the free Block list.
+        size_t iLastUsedBlock = m_FreeBlockIndices.at(m_iFreeBlocksBegin - 1);
+
+        // Map the Block index to the free Block list.
+        size_t iFreeBlock = m_FreeBlockIndexByBlock.at(iBlock);
+
+        // Swap freed Block with last taken Block before the free Blocks. Since the number of free
+        // Blocks will be decremented, this will push the freed Block into the free list.
+        std::swap(m_FreeBlockIndices.at(iFreeBlock), m_FreeBlockIndices.at(m_iFreeBlocksBegin - 1));
+
+        // Update the free Block list mapping.
+        std::swap(m_FreeBlockIndexByBlock.at(iBlock), m_FreeBlockIndexByBlock.at(iLastUsedBlock));
+
+        m_iFreeBlocksBegin--;
+    }
+
+    MemoryManager::Block& MemoryManager::GetBlock(uint64_t iBlock)
+    {
+        uint64_t iInSegment = 0;
+        size_t iSegment = GetSegment(iBlock, iInSegment);
+
+        return m_BlockSegments[iSegment][iInSegment];
+    }
+
+    size_t MemoryManager::GetSegment(uint64_t iBlock, uint64_t& iInSegment)
+    {
+        // Segment k begins at Block FIRST_SEGMENT_SIZE * (2^k - 1).
+        uint64_t n = iBlock / FIRST_SEGMENT_SIZE + 1;
+
+        size_t iSegment = 0;
+        while (n > 1)
+        {
+            n >>= 1;
+            ++iSegment;
+        }
+
+        iInSegment = iBlock - FIRST_SEGMENT_SIZE * ((static_cast<uint64_t>(1) << iSegment) - 1);
+        return iSegment;
+    }
+
+    std::unique_lock<std::mutex> MemoryManager::Lock() const
+    {
+        if (m_bThreadSafe)
+        {
+            return std::unique_lock<std::mutex>(m_Mutex);
+        }
+
+        return std::unique_lock<std::mutex>();
+    }
+
+    MemoryManager::ThreadCache& MemoryManager::GetThreadCache()
+    {
+        // Caches used by this thread, by MemoryManager instance. Instance ids are never reused, so
+        // the caches of destroyed MemoryManagers are never found again.
+        struct ThreadCaches
+        {
+            std::vector<std::pair<uint64_t, std::shared_ptr<ThreadCache>>> cachesByInstance;
+
+            ~ThreadCaches()
+            {
+                // Let the next thread to use each MemoryManager adopt this thread's cache.
+                for (auto& instance__pCache : cachesByInstance)
+                {
+                    instance__pCache.second->bOwned.store(false, std::memory_order_release);
+                }
+            }
+        };
+
+        static thread_local ThreadCaches t_Caches;
+
+        for (auto& instance__pCache : t_Caches.cachesByInstance)
+        {
+            if (instance__pCache.first == m_InstanceId)
+            {
+                return *instance__pCache.second;
+            }
+        }
+
+        // A cache no longer shared with its MemoryManager belongs to one that has been destroyed.
+        auto& cachesByInstance = t_Caches.cachesByInstance;
+        cachesByInstance.erase(std::remove_if(cachesByInstance.begin(), cachesByInstance.end(),
+            [](const std::pair<uint64_t, std::shared_ptr<ThreadCache>>& instance__pCache) {
+                return instance__pCache.second.use_count() == 1;
+            }), cachesByInstance.end());
+
+        std::shared_ptr<ThreadCache> pCache;
+        {
+            std::unique_lock<std::mutex> lock = Lock();
+
+            // Adopt the cache of a thread that has exited, so that its Blocks and slots are reused.
+            for (const auto& pThreadCache : m_ThreadCaches)
+            {
+                bool bOwned = false;
+                if (pThreadCache->bOwned.compare_exchange_strong(bOwned, true, std::memory_order_acquire))
+                {
+                    pCache = pThreadCache;
+                    break;
+                }
+            }
+
+            if (pCache == nullptr)
+            {
+                pCache = std::make_shared<ThreadCache>();
+                m_ThreadCaches.push_back(pCache);
+            }
+        }
+
+        cachesByInstance.emplace_back(m_InstanceId, pCache);
+        return *pCache;
+    }
+
+    void MemoryManager::FlushThreadCache(ThreadCache& cache, size_t nMaxCached)
+    {
+        while (cache.freeBlocks.size() > nMaxCached)
+        {
+            ReleaseBlock(cache.freeBlocks.back());
+            cache.freeBlocks.pop_back();
+        }
+
+        cache.nFreeBlocks.store(cache.freeBlocks.size(), std::memory_order_relaxed);
+
+        for (auto& key__freeSlots : cache.freeSlotsByKey)
+        {
+            std::vector<Slot>& freeSlots = key__freeSlots.second;
+            while (freeSlots.size() > nMaxCached)
+            {
+                Slot& slot = freeSlots.back();
+                slot.pSlab->pSizeClass->freeSlots.push_back(slot);
+                slot.pSlab->nUsedSlots--;
+
+                freeSlots.pop_back();
+            }
+        }
+    }
+
     MemoryManager::Config::Config()
     {
         AllocateCb = [](uint64_t size) {
@@ -24,6 +24,16 @@ namespace hscpp
         std::chrono::milliseconds latency = std::chrono::milliseconds(100);
     };
 
+    struct RuntimeSwapConfig
+    {
+        // If non-zero, instances are swapped incrementally, spending at most this long swapping
+        // per call to Hotswapper::Update. Otherwise, every instance is swapped at once.
+        std::chrono::microseconds budget = std::chrono::microseconds(0);
+
+        // Number of instances swapped between checks of the budget.
+        size_t batchSize = 256;
+    };
+
     struct Config
     {
         enum class Flag : uint64_t
@@ -37,6 +47,7 @@ namespace hscpp
 
         CompilerConfig compiler;
         FileWatcherConfig fileWatcher;
+        RuntimeSwapConfig runtimeSwap;
 
         Flag flags = Flag::None;
     };
@@ -18,6 +18,16 @@ namespace hscpp
         // Do not automatically trigger compilation on file changes. User must call the
         // hscpp::Hotswapper's TriggerManualBuild method.
         ManualCompilationOnly,
+
+        // Only swap instances of tracked classes whose code may have changed. A class is assumed
+        // unchanged if neither the file declaring it, nor any compiled file including it, had
+        // semantic changes. Requires DependentCompilation.
+        SkipUnchangedTypes,
+
+        // Unload modules once no constructor or tracked instance refers to them. Only tracked
+        // objects are considered, so any other pointer into a module (ex. a function pointer, an
+        // untracked polymorphic object, or a string literal) must not outlive its swap.
+        UnloadModules,
     };
 
     class FeatureHasher
@@ -4,6 +4,8 @@
 #include <vector>
 #include <unordered_set>
 #include <map>
+#include <functional>
+#include <future>
 
 #include "hscpp/Platform.h"
 #include "hscpp/file-watcher/IFileWatcher.h"
@@ -31,6 +33,8 @@ namespace hscpp
             Idle,
             Compiling,
             StartedCompiling,
+            LoadingModule,
+            Swapping,
             PerformedSwap,
             FailedSwap,
         };
@@ -44,6 +48,10 @@ namespace hscpp
 
         AllocationResolver* GetAllocationResolver();
 
+        // Dependency graph used to find files to recompile, for analyzing rebuild costs. Returns
+        // nullptr when hscpp is disabled.
+        DependencyGraph* GetDependencyGraph();
+
         void SetAllocator(IAllocator* pAllocator);
         void SetGlobalUserData(void* pGlobalUserData);
 
@@ -55,6 +63,17 @@ namespace hscpp
 
         UpdateResult Update();
         bool IsCompiling();
+        bool IsSwapping();
+
+        // Log every loaded module still referenced by a constructor or tracked instance. With
+        // Feature::UnloadModules, superseded modules in this list have leaked instances.
+        void LogPinnedModules();
+
+        // Save the state of tracked objects before restarting the process, and restore it after.
+        // Only items that are trivially copyable are saved. Swap handlers can check
+        // SwapInfo::IsSnapshot() to save pointer-free state, and to register restored objects.
+        bool SaveSnapshot(const fs::path& filePath);
+        bool RestoreSnapshot(const fs::path& filePath);
         bool IsCompilerInitialized();
 
         void SetCallbacks(const Callbacks& callbacks);
@@ -152,6 +171,15 @@ namespace hscpp
         std::unique_ptr<ICompiler> m_pCompiler;
         std::unique_ptr<IPreprocessor> m_pPreprocessor;
 
+        // Files with semantic changes since the last successful swap, used to skip swapping
+        // unchanged classes. Manual builds do not track changes, so they swap all classes.
+        std::unordered_set<fs::path, FsPathHasher> m_ChangedFilePaths;
+        bool m_bCompilingFileChanges = false;
+
+        // Compiled module being loaded on a background thread. The swap is performed on the first
+        // Update after loading finishes.
+        std::future<ModuleManager::LoadedModule> m_LoadingModule;
+
         ModuleManager m_ModuleManager;
         FeatureManager m_FeatureManager;
 
@@ -166,7 +194,11 @@ namespace hscpp
         bool Preprocess(ICompiler::Input& compilerInput);
         void Deduplicate(ICompiler::Input& input);
 
-        bool PerformRuntimeSwap();
+        void StartLoadingModule();
+        UpdateResult PerformRuntimeSwap(const ModuleManager::LoadedModule& module);
+        UpdateResult ContinueRuntimeSwap();
+        UpdateResult FinishRuntimeSwap(bool bResult);
+        std::function<bool(const fs::path&)> CreateIsClassUnchangedCb();
 
         bool CreateHscppTempDirectory();
         bool CreateBuildDirectory();
@@ -1,7 +1,12 @@
 #pragma once
 
+#include <string>
 #include <unordered_map>
 #include <memory>
+#include <functional>
+#include <unordered_set>
+#include <chrono>
+#include <mutex>
 
 #include "hscpp/Platform.h"
 #include "hscpp/module/ITracker.h"
@@ -15,25 +20,113 @@ namespace hscpp
     class ModuleManager
     {
     public:
+        // Module loaded by LoadModule. If loading failed, pModule is nullptr and error describes why.
+        struct LoadedModule
+        {
+            fs::path modulePath;
+            void* pModule = nullptr;
+            std::string error;
+        };
+
+        // A loaded module, and the number of references to it found by UnloadUnusedModules.
+        struct ModuleReport
+        {
+            fs::path modulePath;
+            size_t nConstructors = 0;
+            size_t nInstances = 0;
+        };
 
         ModuleManager();
+        ~ModuleManager();
+
+        // Load a module, running its static initializers and resolving its symbols. This does not
+        // touch the ModuleManager's state, so it is safe to call from a background thread.
+        static LoadedModule LoadModule(const fs::path& modulePath);
 
         void SetAllocator(IAllocator* pAllocator);
         void SetGlobalUserData(void* pGlobalUserData);
 
-        bool PerformRuntimeSwap(const fs::path& modulePath);
+        // If isClassUnchangedCb is set, it is called with the file declaring each tracked class in
+        // the module. Instances of classes for which it returns true are not swapped.
+        bool PerformRuntimeSwap(const fs::path& modulePath,
+                const std::function<bool(const fs::path& classFilePath)>& isClassUnchangedCb = nullptr);
+        bool PerformRuntimeSwap(const LoadedModule& module,
+                const std::function<bool(const fs::path& classFilePath)>& isClassUnchangedCb = nullptr);
+
+        // Load a module and patch its constructors, but defer swapping instances to
+        // ContinueIncrementalRuntimeSwap. Hscpp_IsSwapping() returns true until every instance
+        // has been swapped.
+        bool BeginIncrementalRuntimeSwap(const fs::path& modulePath,
+                const std::function<bool(const fs::path& classFilePath)>& isClassUnchangedCb = nullptr);
+        bool BeginIncrementalRuntimeSwap(const LoadedModule& module,
+                const std::function<bool(const fs::path& classFilePath)>& isClassUnchangedCb = nullptr);
+
+        // Swap instances in batches of batchSize, until the budget is spent. At least one batch is
+        // swapped per call. Returns true once every instance has been swapped.
+        bool ContinueIncrementalRuntimeSwap(std::chrono::microseconds budget, size_t batchSize);
+
+        bool IsSwapping();
+
+        // Unload modules that no constructor or tracked instance refers to, returning the number of
+        // modules unloaded. Nothing is unloaded during an incremental swap.
+        size_t UnloadUnusedModules();
+
+        // Loaded modules that are still referenced. Superseded modules in this list are pinned,
+        // as some instance was constructed by them and has not been swapped.
+        std::vector<ModuleReport> GetPinnedModules();
+
+        // Save the state of every tracked object to a snapshot file, or construct objects from a
+        // snapshot saved by a previous run of the process. See Snapshot.
+        bool SaveSnapshot(const fs::path& filePath);
+        bool RestoreSnapshot(const fs::path& filePath);
 
     private:
         bool m_bSwapping = false;
-        std::unordered_map<std::string, std::vector<ITracker*>> m_TrackersByKey;
-        
+        std::unordered_map<uint64_t, std::vector<ITracker*>> m_TrackersByKey;
+        std::unordered_map<uint64_t, std::vector<ITracker*>> m_PendingTrackersByKey;
+        std::unordered_map<uint64_t, CompactTrackerTable> m_CompactTrackersByKey;
+
+        // Held while swapping or reading the tables above, so that other threads can create and
+        // destroy tracked objects. See ModuleSharedState::s_pTrackerMutex.
+        std::recursive_mutex m_TrackerMutex;
+
         // The library user owns this memory.
         IAllocator* m_pAllocator = nullptr;
         void* m_pGlobalUserData = nullptr;
 
-        std::unordered_map<std::string, IConstructor*> m_ConstructorsByKey;
+        std::unordered_map<uint64_t, IConstructor*> m_ConstructorsByKey;
+
+        // Changed whenever m_ConstructorsByKey is patched, invalidating the constructors cached by
+        // AllocationResolver.
+        uint64_t m_ConstructorsGeneration = 0;
+
+        // Keys of every loaded module, used to detect distinct keys with the same hash.
+        std::unordered_map<uint64_t, std::string> m_KeysByHash;
+
+        // Module performing an incremental swap. Modules are not unloaded while an incremental swap
+        // is in progress, so the old modules' code remains available to destroy instances that have
+        // not yet been swapped.
+        ModuleInterface* m_pSwappingModuleInterface = nullptr;
+
+        struct Module
+        {
+            fs::path modulePath;
+            void* pModule = nullptr;
+            void* pBase = nullptr;
+        };
+
+        // Modules loaded by this ModuleManager, in load order. The executable is not included.
+        std::vector<Module> m_Modules;
+
+        std::vector<ModuleReport> CountModuleReferences();
+        void UpdateConstructorsGeneration();
+
+        ModuleInterface* GetModuleInterface(const LoadedModule& module);
+        std::unordered_set<uint64_t> GetUnchangedKeyHashes(ModuleInterface* pModuleInterface,
+                const std::function<bool(const fs::path& classFilePath)>& isClassUnchangedCb);
 
         void WarnDuplicateKeys(ModuleInterface* pModuleInterface);
+        bool DetectKeyCollisions(ModuleInterface* pModuleInterface);
     };
 
 }
\ No newline at end of file
@@ -63,6 +63,14 @@ typedef int TOsError;
 
         std::string GetSharedLibraryExtension();
         void* LoadModule(const fs::path& modulePath);
+        bool UnloadModule(void* pModule);
+
+        // Base address of the loaded module containing pAddress, or nullptr if no module contains it.
+        void* GetModuleBase(const void* pAddress);
+
+        // Map a file into memory as read-only. Returns nullptr on failure, or if the file is empty.
+        const uint8_t* MapFile(const fs::path& filePath, size_t& size);
+        bool UnmapFile(const uint8_t* pMemory, size_t size);
 
         template <typename TSignature>
         std::function<TSignature> GetModuleFunction(void* pModule, const std::string& name)
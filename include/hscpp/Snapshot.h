@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+
+#include "hscpp/Platform.h"
+#include "hscpp/module/ModuleInterface.h"
+
+namespace hscpp
+{
+
+    // Persists the state of tracked objects across a restart of the process. On Save, the swap
+    // handler of each tracked object is called with SwapInfo::IsSnapshot() set, and the trivially
+    // copyable items it saved are written to a file. On Restore, the file is memory-mapped and each
+    // object is constructed anew, with its swap handler reading items directly from the mapping.
+    class Snapshot
+    {
+    public:
+        static bool Save(ModuleInterface* pModuleInterface, const fs::path& filePath);
+        static bool Restore(ModuleInterface* pModuleInterface, const fs::path& filePath);
+
+    private:
+        static const char MAGIC[8];
+        static const uint32_t VERSION = 1;
+
+        // Item values are padded to this alignment, so they can be read in place from the mapping.
+        static const size_t ALIGNMENT = 16;
+
+        static void Write(std::ofstream& ofs, const void* pData, size_t size);
+        static void WritePadding(std::ofstream& ofs, size_t offset);
+
+        static bool Read(const uint8_t* pBegin, size_t size, size_t& offset, void* pData, size_t dataSize);
+    };
+
+}
\ No newline at end of file
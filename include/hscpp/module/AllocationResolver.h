@@ -55,13 +55,14 @@ namespace hscpp
         Allocate(AllocationInfo& info)
         {
             // This type has an hscpp_ClassTracker member, and it is assumed it has been registered
-            // with HSCPP_TRACK. Allocate it using an hscpp Constructor.
-            const char* pKey = decltype(T::hscpp_ClassKey)().ToString();
-
-            auto constructorIt = ModuleSharedState::s_pConstructorsByKey->find(pKey);
-            if (constructorIt != ModuleSharedState::s_pConstructorsByKey->end())
+            // with HSCPP_TRACK. Allocate it using an hscpp Constructor. The tracker lock is held
+            // until the object is registered, so that a runtime swap on another thread either
+            // constructs it with the new module, or finds it registered and swaps it.
+            std::unique_lock<std::recursive_mutex> lock = ModuleSharedState::LockTrackers();
+            IConstructor* pConstructor = GetConstructor<T>();
+            if (pConstructor != nullptr)
             {
-                info = constructorIt->second->Allocate();
+                info = pConstructor->Allocate();
             }
             else
             {
@@ -78,7 +79,7 @@ namespace hscpp
             {
                 uint64_t size = sizeof(typename std::aligned_storage<sizeof(T)>::type);
 
-                info = ModuleSharedState::s_pAllocator->Hscpp_Allocate(size);
+                info = ModuleSharedState::s_pAllocator->Hscpp_AllocateAligned(size, alignof(T));
                 new (info.pMemory) T;
             }
             else
@@ -96,6 +97,38 @@ namespace hscpp
 
             return reinterpret_cast<T*>(info.pMemory);
         }
+
+    private:
+        struct ConstructorSlot
+        {
+            uint64_t generation = 0;
+            IConstructor* pConstructor = nullptr;
+        };
+
+        // The constructor of each type is cached, to avoid a map lookup on every allocation. The
+        // cache is refreshed when the generation changes, which happens whenever a runtime swap
+        // patches the constructors, so that new objects are constructed by the newest module.
+        // Called with the tracker lock held, which also guards the cache.
+        template <typename T>
+        static IConstructor* GetConstructor()
+        {
+            static ConstructorSlot slot;
+
+            const uint64_t* pGeneration = ModuleSharedState::s_pConstructorsGeneration;
+            if (pGeneration != nullptr && *pGeneration != 0 && slot.generation == *pGeneration)
+            {
+                return slot.pConstructor;
+            }
+
+            uint64_t keyHash = decltype(T::hscpp_ClassKey)::hash;
+
+            auto constructorIt = ModuleSharedState::s_pConstructorsByKey->find(keyHash);
+            slot.pConstructor = (constructorIt != ModuleSharedState::s_pConstructorsByKey->end())
+                ? constructorIt->second : nullptr;
+            slot.generation = (pGeneration != nullptr) ? *pGeneration : 0;
+
+            return slot.pConstructor;
+        }
     };
 
 }
\ No newline at end of file
@@ -13,6 +13,26 @@ namespace hscpp { namespace compile_time {
         static constexpr int len = Len;
     };
 
+    // 64-bit FNV-1a, used to key registries on an integer rather than a string.
+    constexpr uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+    constexpr uint64_t FNV_PRIME = 1099511628211ull;
+
+    // Hash the bytes of a String segment, stopping at the null terminator.
+    constexpr uint64_t HashSegment(uint64_t hash, uint64_t segment, unsigned iByte = 0)
+    {
+        return (iByte >= 8 || ((segment >> (iByte * 8u)) & 0xFF) == 0)
+            ? hash
+            : HashSegment((hash ^ ((segment >> (iByte * 8u)) & 0xFF)) * FNV_PRIME, segment, iByte + 1);
+    }
+
+    // Hash a key at runtime. Produces the same value as String::hash for the same key.
+    constexpr uint64_t HashKey(const char* pKey, uint64_t hash = FNV_OFFSET_BASIS)
+    {
+        return (*pKey == 0)
+            ? hash
+            : HashKey(pKey + 1, (hash ^ static_cast<uint8_t>(*pKey)) * FNV_PRIME);
+    }
+
     // String stored in integrals; each byte in each uint64_t corresponds to a char.
     // Maximum key length is capped at 128 (16 * sizeof(uint64_t)).
     template <uint64_t S1, uint64_t S2, uint64_t S3, uint64_t S4, uint64_t S5, uint64_t S6, uint64_t S7, uint64_t S8,
@@ -25,6 +45,13 @@ namespace hscpp { namespace compile_time {
             S1, S2, S3, S4, S5, S6, S7, S8, S9, S10, S11, S12, S13, S14, S15, S16, 0
         };
 
+        // Hash of the string, computed once at compile time.
+        constexpr static uint64_t hash =
+            HashSegment(HashSegment(HashSegment(HashSegment(HashSegment(HashSegment(HashSegment(HashSegment(
+            HashSegment(HashSegment(HashSegment(HashSegment(HashSegment(HashSegment(HashSegment(HashSegment(
+                FNV_OFFSET_BASIS, S1), S2), S3), S4), S5), S6), S7), S8),
+                S9), S10), S11), S12), S13), S14), S15), S16);
+
         const char* ToString() const
         {
             return reinterpret_cast<const char*>(raw.data());
@@ -38,6 +65,10 @@ namespace hscpp { namespace compile_time {
             uint64_t S9, uint64_t S10, uint64_t S11, uint64_t S12, uint64_t S13, uint64_t S14, uint64_t S15, uint64_t S16>
     constexpr std::array<uint64_t, 17> String<S1, S2, S3, S4, S5, S6, S7, S8, S9, S10, S11, S12, S13, S14, S15, S16>::raw;
 
+    template <uint64_t S1, uint64_t S2, uint64_t S3, uint64_t S4,uint64_t S5, uint64_t S6, uint64_t S7, uint64_t S8,
+            uint64_t S9, uint64_t S10, uint64_t S11, uint64_t S12, uint64_t S13, uint64_t S14, uint64_t S15, uint64_t S16>
+    constexpr uint64_t String<S1, S2, S3, S4, S5, S6, S7, S8, S9, S10, S11, S12, S13, S14, S15, S16>::hash;
+
     constexpr int Strlen(const char* pStr)
     {
         return (*pStr == 0)
@@ -11,6 +11,7 @@
 
 #include "hscpp/module/IAllocator.h"
 #include "hscpp/module/ModuleSharedState.h"
+#include "hscpp/module/Layout.h"
 
 namespace hscpp
 {
@@ -24,6 +25,19 @@ namespace hscpp
         virtual ~IConstructor() = default;
         virtual AllocationInfo Allocate() = 0;
         virtual AllocationInfo AllocateSwap(uint64_t id) = 0;
+
+        // Construct an object to replace each swapped object, in the order of ids.
+        virtual void AllocateSwapBatch(const std::vector<uint64_t>& ids) = 0;
+
+        virtual LayoutInfo GetLayoutInfo() = 0;
+
+        // Construct an object in the memory of an object that was swapped in place, moving in the
+        // fields that were moved out of the old object.
+        virtual void ConstructInPlace(uint8_t* pMemory, uint8_t* pFields) = 0;
+
+        // Address within the module that registered the constructor, used to find the modules
+        // that are still in use.
+        virtual const void* GetModuleAddress() = 0;
     };
 
     //============================================================================
@@ -36,36 +50,82 @@ namespace hscpp
     public:
         AllocationInfo Allocate() override
         {
-            return Allocate([](uint64_t size) {
-                return ModuleSharedState::s_pAllocator->Hscpp_Allocate(size);
-                });
+            if (ModuleSharedState::s_pAllocator == nullptr)
+            {
+                return New();
+            }
+
+            return Construct(ModuleSharedState::s_pAllocator->Hscpp_AllocateAligned(GetSize(), alignof(T)));
         }
 
         AllocationInfo AllocateSwap(uint64_t id) override
         {
-            return Allocate([id](uint64_t size) {
-                return ModuleSharedState::s_pAllocator->Hscpp_AllocateSwap(id, size);
-                });
+            if (ModuleSharedState::s_pAllocator == nullptr)
+            {
+                return New();
+            }
+
+            return Construct(ModuleSharedState::s_pAllocator->Hscpp_AllocateSwapAligned(id, GetSize(), alignof(T)));
         }
 
-    private:
-        AllocationInfo Allocate(const std::function<AllocationInfo(uint64_t size)>& allocatorCb)
+        void AllocateSwapBatch(const std::vector<uint64_t>& ids) override
         {
             if (ModuleSharedState::s_pAllocator == nullptr)
             {
-                AllocationInfo info;
-                info.pMemory = reinterpret_cast<uint8_t*>(new T());
-                return info;
+                for (size_t i = 0; i < ids.size(); ++i)
+                {
+                    new T();
+                }
+
+                return;
             }
-            else
+
+            std::vector<AllocationInfo> infos(ids.size());
+            ModuleSharedState::s_pAllocator->Hscpp_AllocateSwapBatch(
+                ids.data(), ids.size(), GetSize(), alignof(T), infos.data());
+
+            for (const auto& info : infos)
             {
-                uint64_t size = sizeof(typename std::aligned_storage<sizeof(T)>::type);
-                AllocationInfo info = allocatorCb(size);
                 new (info.pMemory) T;
-
-                return info;
             }
         }
+
+        LayoutInfo GetLayoutInfo() override
+        {
+            return Layout::GetLayoutInfo<T>();
+        }
+
+        void ConstructInPlace(uint8_t* pMemory, uint8_t* pFields) override
+        {
+            T* pObject = new (pMemory) T;
+            Layout::MoveFieldsIn(pObject, pFields);
+        }
+
+        const void* GetModuleAddress() override
+        {
+            // Constructors are allocated on the heap, so refer to a static within the module.
+            static const char s_ModuleAddress = 0;
+            return &s_ModuleAddress;
+        }
+
+    private:
+        static uint64_t GetSize()
+        {
+            return sizeof(typename std::aligned_storage<sizeof(T)>::type);
+        }
+
+        static AllocationInfo New()
+        {
+            AllocationInfo info;
+            info.pMemory = reinterpret_cast<uint8_t*>(new T());
+            return info;
+        }
+
+        static AllocationInfo Construct(const AllocationInfo& info)
+        {
+            new (info.pMemory) T;
+            return info;
+        }
     };
 
     //============================================================================
@@ -83,33 +143,72 @@ namespace hscpp
             std::string type;
         };
 
+        // Distinct keys whose hashes are equal. These cannot be told apart by the registries.
+        struct KeyCollision
+        {
+            std::string key;
+            std::string otherKey;
+        };
+
         template <typename T>
-        static void RegisterConstructor(const std::string& key)
+        static void RegisterConstructor(const std::string& key, uint64_t keyHash, const std::string& classFilePath)
         {
-            TypesByKey()[key].insert(std::type_index(typeid(T)));
+            TypesByKeyHash()[keyHash].insert(std::type_index(typeid(T)));
+            GetClassFilePathsByKeyHash()[keyHash] = classFilePath;
 
-            GetConstructorKeys().push_back(key);
+            auto keyIt = GetKeysByHash().find(keyHash);
+            if (keyIt == GetKeysByHash().end())
+            {
+                GetKeysByHash()[keyHash] = key;
+            }
+            else if (keyIt->second != key)
+            {
+                KeyCollision collision;
+                collision.key = key;
+                collision.otherKey = keyIt->second;
+
+                GetCollisions().push_back(collision);
+            }
+
+            GetConstructorKeyHashes().push_back(keyHash);
 
             GetConstructors().push_back(std::unique_ptr<Constructor<T>>(new Constructor<T>()));
             size_t iConstructor = GetConstructors().size() - 1;
 
-            GetConstructorsByKey()[key] = iConstructor;
+            GetConstructorsByKeyHash()[keyHash] = iConstructor;
         }
 
         static size_t GetNumberOfKeys()
         {
-            return GetConstructorKeys().size();
+            return GetConstructorKeyHashes().size();
+        }
+
+        static uint64_t GetKeyHash(size_t iKey)
+        {
+            return GetConstructorKeyHashes().at(iKey);
         }
 
         static std::string GetKey(size_t iKey)
         {
-            return GetConstructorKeys().at(iKey);
+            return GetKeysByHash().at(GetKeyHash(iKey));
+        }
+
+        // File in which the class was declared with HSCPP_TRACK, or empty if unknown.
+        static std::string GetClassFilePath(uint64_t keyHash)
+        {
+            auto filePathIt = GetClassFilePathsByKeyHash().find(keyHash);
+            if (filePathIt != GetClassFilePathsByKeyHash().end())
+            {
+                return filePathIt->second;
+            }
+
+            return "";
         }
 
-        static IConstructor* GetConstructor(const std::string& key)
+        static IConstructor* GetConstructor(uint64_t keyHash)
         {
-            auto constructorIt = GetConstructorsByKey().find(key);
-            if (constructorIt != GetConstructorsByKey().end())
+            auto constructorIt = GetConstructorsByKeyHash().find(keyHash);
+            if (constructorIt != GetConstructorsByKeyHash().end())
             {
                 return GetConstructors().at(constructorIt->second).get();
             }
@@ -121,14 +220,14 @@ namespace hscpp
         {
             std::vector<DuplicateKey> duplicates;
 
-            for (const auto& key__types : TypesByKey())
+            for (const auto& keyHash__types : TypesByKeyHash())
             {
-                if (key__types.second.size() > 1)
+                if (keyHash__types.second.size() > 1)
                 {
-                    for (const auto& type : key__types.second)
+                    for (const auto& type : keyHash__types.second)
                     {
                         DuplicateKey duplicate;
-                        duplicate.key = key__types.first;
+                        duplicate.key = GetKeysByHash().at(keyHash__types.first);
                         duplicate.type = type.name();
 
                         duplicates.push_back(duplicate);
@@ -139,12 +238,17 @@ namespace hscpp
             return duplicates;
         }
 
+        static std::vector<KeyCollision> GetKeyCollisions()
+        {
+            return GetCollisions();
+        }
+
     private:
         // Avoid static initialization order issues by placing static variables within functions.
-        static std::vector<std::string>& GetConstructorKeys()
+        static std::vector<uint64_t>& GetConstructorKeyHashes()
         {
-            static std::vector<std::string> keys;
-            return keys;
+            static std::vector<uint64_t> keyHashes;
+            return keyHashes;
         }
 
         static std::vector<std::unique_ptr<IConstructor>>& GetConstructors()
@@ -153,16 +257,34 @@ namespace hscpp
             return constructors;
         }
 
-        static std::unordered_map<std::string, size_t>& GetConstructorsByKey()
+        static std::unordered_map<uint64_t, size_t>& GetConstructorsByKeyHash()
+        {
+            static std::unordered_map<uint64_t, size_t> iConstructorByKeyHash;
+            return iConstructorByKeyHash;
+        }
+
+        static std::unordered_map<uint64_t, std::string>& GetKeysByHash()
+        {
+            static std::unordered_map<uint64_t, std::string> keysByHash;
+            return keysByHash;
+        }
+
+        static std::unordered_map<uint64_t, std::string>& GetClassFilePathsByKeyHash()
+        {
+            static std::unordered_map<uint64_t, std::string> classFilePathsByKeyHash;
+            return classFilePathsByKeyHash;
+        }
+
+        static std::vector<KeyCollision>& GetCollisions()
         {
-            static std::unordered_map<std::string, size_t> iConstructorByKey;
-            return iConstructorByKey;
+            static std::vector<KeyCollision> collisions;
+            return collisions;
         }
 
-        static std::unordered_map<std::string, std::unordered_set<std::type_index>>& TypesByKey()
+        static std::unordered_map<uint64_t, std::unordered_set<std::type_index>>& TypesByKeyHash()
         {
-            static std::unordered_map<std::string, std::unordered_set<std::type_index>> typeByKey;
-            return typeByKey;
+            static std::unordered_map<uint64_t, std::unordered_set<std::type_index>> typesByKeyHash;
+            return typesByKeyHash;
         }
     };
 
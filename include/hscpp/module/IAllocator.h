@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <limits>
 
@@ -23,6 +24,33 @@ namespace hscpp
         // to replace an old implementation.
         virtual AllocationInfo Hscpp_AllocateSwap(uint64_t previousId, uint64_t size) = 0;
 
+        // Called in place of Hscpp_Allocate and Hscpp_AllocateSwap, with the alignment required by
+        // the object. By default, the alignment is ignored, so these should be overridden to
+        // support types aligned beyond what Hscpp_Allocate guarantees.
+        virtual AllocationInfo Hscpp_AllocateAligned(uint64_t size, uint64_t alignment)
+        {
+            (void)alignment;
+            return Hscpp_Allocate(size);
+        }
+
+        virtual AllocationInfo Hscpp_AllocateSwapAligned(uint64_t previousId, uint64_t size, uint64_t alignment)
+        {
+            (void)alignment;
+            return Hscpp_AllocateSwap(previousId, size);
+        }
+
+        // Called when every instance of a class is swapped at once, with the previous id of each
+        // instance. pInfos must be filled with nInstances allocations, in the same order. Overriding
+        // this allows the new instances to be placed in contiguous memory.
+        virtual void Hscpp_AllocateSwapBatch(const uint64_t* pPreviousIds, size_t nInstances,
+            uint64_t size, uint64_t alignment, AllocationInfo* pInfos)
+        {
+            for (size_t i = 0; i < nInstances; ++i)
+            {
+                pInfos[i] = Hscpp_AllocateSwapAligned(pPreviousIds[i], size, alignment);
+            }
+        }
+
         // Called when an object is freed during a runtime swap, and should return the old object's id.
         virtual uint64_t Hscpp_FreeSwap(uint8_t* pMemory) = 0;
     };
@@ -1,11 +1,17 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 #include "hscpp/module/SwapInfo.h"
 
 namespace hscpp
 {
+    template <typename T, typename CompileTimeKey>
+    class Tracker;
+
+    class ModuleInterface;
+
     // Required to be in it's own file to avoid circular dependency with Tracker and ModuleInterface.
     class ITracker
     {
@@ -13,5 +19,63 @@ namespace hscpp
         virtual uint64_t FreeTrackedObject() = 0;
         virtual std::string GetKey() = 0;
         virtual void CallSwapHandler(SwapInfo& info) = 0;
+
+        // Fingerprint of the tracked object's layout, or zero if it cannot be swapped in place.
+        virtual uint64_t GetLayoutFingerprint() = 0;
+
+        // Objects with a swap handler are never swapped in place, as the handler may migrate state
+        // or set an init callback.
+        virtual bool HasSwapHandler() = 0;
+
+        // Move the tracked object's fields into pFields and destroy it, without freeing its memory.
+        // Returns the memory of the destroyed object.
+        virtual uint8_t* RelocateTrackedObject(uint8_t* pFields) = 0;
+
+        // Address within the module that constructed the tracked object, used to find the modules
+        // that are still in use.
+        virtual const void* GetModuleAddress() = 0;
+
+    private:
+        template <typename T, typename CompileTimeKey>
+        friend class Tracker;
+        friend class ModuleInterface;
+
+        // Registry containing this tracker, and its index within that registry, so that it can be
+        // removed in constant time. During an incremental swap, trackers waiting to be swapped are
+        // moved to a separate registry.
+        std::vector<ITracker*>* m_pTrackers = nullptr;
+        size_t m_iSlot = 0;
+    };
+
+    // Operations on the objects of a type tracked with HSCPP_TRACK_COMPACT. Objects only store their
+    // index into a CompactTrackerTable, so these are implemented once per type rather than per object.
+    class ICompactTrackerOps
+    {
+    public:
+        virtual uint64_t FreeTrackedObject(void* pObject) = 0;
+        virtual void CallSwapHandler(void* pObject, SwapInfo& info) = 0;
+
+        virtual uint64_t GetLayoutFingerprint() = 0;
+        virtual bool HasSwapHandler() = 0;
+        virtual uint8_t* RelocateTrackedObject(void* pObject, uint8_t* pFields) = 0;
+    };
+
+    // Densely packed registry of the objects of a type tracked with HSCPP_TRACK_COMPACT.
+    struct CompactTrackerTable
+    {
+        struct Entry
+        {
+            void* pObject = nullptr;
+            uint32_t* piSlot = nullptr; // Index of this entry, stored within the tracked object.
+
+            // Ops of the module that constructed the object. Objects of the same type may have been
+            // constructed by different modules, for example when unchanged types are not swapped.
+            ICompactTrackerOps* pOps = nullptr;
+        };
+
+        std::vector<Entry> entries;
+
+        // Objects waiting to be swapped during an incremental swap.
+        std::vector<Entry> pendingEntries;
     };
 }
\ No newline at end of file
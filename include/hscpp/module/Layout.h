@@ -0,0 +1,452 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <string>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+#include <type_traits>
+
+#include "hscpp/module/CompileTimeString.h"
+#include "hscpp/module/SwapInfo.h"
+
+namespace hscpp
+{
+
+    // Layout of a tracked type, used to decide whether instances can be swapped in place.
+    struct LayoutInfo
+    {
+        uint64_t fingerprint = 0; // Zero if the type cannot be swapped in place.
+        size_t size = 0;
+        size_t alignment = 0;
+        size_t fieldsSize = 0; // Size of the buffer holding the listed fields during an in-place swap.
+    };
+
+    // Types of the fields listed with HSCPP_FIELDS, so that they can be visited without an object.
+    template <typename... Fields>
+    struct FieldTypes
+    {};
+
+    // Only used within decltype, to deduce the types of fields named in a static member function.
+    template <typename... Fields>
+    FieldTypes<Fields...> DeduceFieldTypes(const Fields&...);
+
+    // Types that declare their fields with HSCPP_FIELDS can be swapped in place, when the new
+    // type's layout matches the old type's layout. Rather than serializing state and reallocating,
+    // each field is moved out of the old object, the old object is destroyed, and the new object
+    // is default constructed in the same memory before its fields are moved back in. Fields are
+    // moved through a buffer where they are packed in the order they are listed, so the layout
+    // only depends on the types of the listed fields, and not on their offsets.
+    //
+    // If the layout has changed, listed fields are instead saved by name during a regular swap, and
+    // loaded into the fields of the new type with the same name and type. Fields that were added
+    // keep their default value, and fields that were removed are discarded.
+    class Layout
+    {
+    public:
+        template <typename T>
+        static LayoutInfo GetLayoutInfo()
+        {
+            // Computed once per module.
+            static const LayoutInfo info = CreateLayoutInfo<T>();
+            return info;
+        }
+
+        // Move each field of pObject into pFields, packed in the order they are listed.
+        template <typename T>
+        static void MoveFieldsOut(T* pObject, uint8_t* pFields)
+        {
+            MoveOutVisitor visitor;
+            visitor.pFields = pFields;
+
+            VisitFields(pObject, visitor, 0);
+        }
+
+        // Move each field in pFields into pObject, destroying the moved-from fields.
+        template <typename T>
+        static void MoveFieldsIn(T* pObject, uint8_t* pFields)
+        {
+            MoveInVisitor visitor;
+            visitor.pFields = pFields;
+
+            VisitFields(pObject, visitor, 0);
+        }
+
+        // Save each field to info, moving it out of pObject. For snapshots, trivially copyable
+        // fields are copied instead, and other fields are skipped.
+        template <typename T>
+        static void SaveFields(T* pObject, SwapInfo& info)
+        {
+            SaveVisitor visitor;
+            visitor.pSerializer = &info.m_Serializer;
+            visitor.bSnapshot = info.IsSnapshot();
+
+            VisitFields(pObject, visitor, 0);
+        }
+
+        // Load each field saved with the same name and type by SaveFields.
+        template <typename T>
+        static void LoadFields(T* pObject, SwapInfo& info)
+        {
+            LoadVisitor visitor;
+            visitor.pSerializer = &info.m_Serializer;
+
+            VisitFields(pObject, visitor, 0);
+        }
+
+    private:
+        static ptrdiff_t GetOffset(const void* pObject, const void* pField)
+        {
+            return reinterpret_cast<const uint8_t*>(pField) - reinterpret_cast<const uint8_t*>(pObject);
+        }
+
+        // Offset of the next field of type Field within the fields buffer.
+        template <typename Field>
+        static size_t AlignFieldsOffset(size_t offset)
+        {
+            return (offset + alignof(Field) - 1) / alignof(Field) * alignof(Field);
+        }
+
+        // Range of trivially copyable fields that are adjacent in both the object and the fields
+        // buffer, which are copied with a single memcpy.
+        struct FieldRun
+        {
+            uint8_t* pObject = nullptr;
+            uint8_t* pFields = nullptr;
+            bool bMoveOut = false;
+
+            ptrdiff_t objectBegin = 0;
+            ptrdiff_t objectEnd = 0;
+            size_t fieldsBegin = 0;
+
+            void Add(ptrdiff_t objectOffset, size_t fieldsOffset, size_t size)
+            {
+                if (objectOffset != objectEnd
+                    || fieldsOffset != fieldsBegin + static_cast<size_t>(objectEnd - objectBegin))
+                {
+                    Copy();
+                    objectBegin = objectOffset;
+                    objectEnd = objectOffset;
+                    fieldsBegin = fieldsOffset;
+                }
+
+                objectEnd += static_cast<ptrdiff_t>(size);
+            }
+
+            void Copy()
+            {
+                size_t size = static_cast<size_t>(objectEnd - objectBegin);
+                if (bMoveOut)
+                {
+                    std::memcpy(pFields + fieldsBegin, pObject + objectBegin, size);
+                }
+                else
+                {
+                    std::memcpy(pObject + objectBegin, pFields + fieldsBegin, size);
+                }
+
+                objectBegin = objectEnd;
+                fieldsBegin += size;
+            }
+        };
+
+        // Visits the types of the listed fields, rather than the fields of an object, so that the
+        // layout can be computed before any object exists.
+        struct FingerprintVisitor
+        {
+            uint64_t hash = compile_time::FNV_OFFSET_BASIS;
+            size_t fieldsSize = 0;
+
+            void Combine(uint64_t value)
+            {
+                hash = (hash ^ value) * compile_time::FNV_PRIME;
+            }
+
+            template <typename... Fields>
+            void operator()(FieldTypes<Fields...>)
+            {
+                int expand[] = { 0, (Visit<Fields>(), 0)... };
+                (void)expand;
+            }
+
+            template <typename Field>
+            void Visit()
+            {
+                fieldsSize = AlignFieldsOffset<Field>(fieldsSize) + sizeof(Field);
+
+                Combine(sizeof(Field));
+                Combine(alignof(Field));
+                Combine(compile_time::HashKey(typeid(Field).name()));
+            }
+        };
+
+        struct MoveOutVisitor
+        {
+            uint8_t* pFields = nullptr;
+            size_t fieldsOffset = 0;
+            FieldRun run;
+
+            template <typename T, typename... Fields>
+            void operator()(T& object, const char*, Fields&... fields)
+            {
+                run.pObject = reinterpret_cast<uint8_t*>(&object);
+                run.pFields = pFields;
+                run.bMoveOut = true;
+
+                int expand[] = { 0, (Visit(object, fields, std::is_trivially_copyable<Fields>()), 0)... };
+                (void)expand;
+
+                run.Copy();
+            }
+
+            template <typename T, typename Field>
+            void Visit(T& object, Field& field, std::true_type)
+            {
+                fieldsOffset = AlignFieldsOffset<Field>(fieldsOffset);
+                run.Add(GetOffset(&object, &field), fieldsOffset, sizeof(Field));
+                fieldsOffset += sizeof(Field);
+            }
+
+            template <typename T, typename Field>
+            void Visit(T&, Field& field, std::false_type)
+            {
+                fieldsOffset = AlignFieldsOffset<Field>(fieldsOffset);
+                new (pFields + fieldsOffset) Field(std::move(field));
+                fieldsOffset += sizeof(Field);
+            }
+        };
+
+        struct MoveInVisitor
+        {
+            uint8_t* pFields = nullptr;
+            size_t fieldsOffset = 0;
+            FieldRun run;
+
+            template <typename T, typename... Fields>
+            void operator()(T& object, const char*, Fields&... fields)
+            {
+                run.pObject = reinterpret_cast<uint8_t*>(&object);
+                run.pFields = pFields;
+                run.bMoveOut = false;
+
+                int expand[] = { 0, (Visit(object, fields, std::is_trivially_copyable<Fields>()), 0)... };
+                (void)expand;
+
+                run.Copy();
+            }
+
+            // Trivially copyable fields have trivial destructors, so they need not be destroyed.
+            template <typename T, typename Field>
+            void Visit(T& object, Field& field, std::true_type)
+            {
+                fieldsOffset = AlignFieldsOffset<Field>(fieldsOffset);
+                run.Add(GetOffset(&object, &field), fieldsOffset, sizeof(Field));
+                fieldsOffset += sizeof(Field);
+            }
+
+            template <typename T, typename Field>
+            void Visit(T&, Field& field, std::false_type)
+            {
+                fieldsOffset = AlignFieldsOffset<Field>(fieldsOffset);
+                Field* pField = reinterpret_cast<Field*>(pFields + fieldsOffset);
+                fieldsOffset += sizeof(Field);
+
+                field = std::move(*pField);
+                pField->~Field();
+            }
+        };
+
+        struct SaveVisitor
+        {
+            Serializer* pSerializer = nullptr;
+            bool bSnapshot = false;
+
+            const std::vector<uint64_t>* pNameHashes = nullptr;
+            size_t iField = 0;
+
+            template <typename T, typename... Fields>
+            void operator()(T&, const char* pNames, Fields&... fields)
+            {
+                pNameHashes = &GetFieldNameHashes<T>(pNames);
+
+                int expand[] = { 0, (Visit(fields, std::is_trivially_copyable<Fields>()), 0)... };
+                (void)expand;
+            }
+
+            template <typename Field>
+            void Visit(Field& field, std::true_type)
+            {
+                if (iField < pNameHashes->size())
+                {
+                    pSerializer->SerializeCopy(pNameHashes->at(iField), field);
+                }
+
+                ++iField;
+            }
+
+            template <typename Field>
+            void Visit(Field& field, std::false_type)
+            {
+                // Objects are not modified when saving a snapshot, and only trivially copyable
+                // values are kept.
+                if (iField < pNameHashes->size())
+                {
+                    if (bSnapshot)
+                    {
+                        pSerializer->SkipProperty();
+                    }
+                    else
+                    {
+                        pSerializer->SerializeMove(pNameHashes->at(iField), std::move(field));
+                    }
+                }
+
+                ++iField;
+            }
+        };
+
+        struct LoadVisitor
+        {
+            Serializer* pSerializer = nullptr;
+
+            const std::vector<uint64_t>* pNameHashes = nullptr;
+            size_t iField = 0;
+
+            template <typename T, typename... Fields>
+            void operator()(T&, const char* pNames, Fields&... fields)
+            {
+                pNameHashes = &GetFieldNameHashes<T>(pNames);
+
+                int expand[] = { 0, (Visit(fields), 0)... };
+                (void)expand;
+            }
+
+            template <typename Field>
+            void Visit(Field& field)
+            {
+                if (iField < pNameHashes->size())
+                {
+                    pSerializer->UnserializeMove(pNameHashes->at(iField), field);
+                }
+
+                ++iField;
+            }
+        };
+
+        // Hashes of the names of T's fields, parsed from the stringified arguments of HSCPP_FIELDS.
+        template <typename T>
+        static const std::vector<uint64_t>& GetFieldNameHashes(const char* pNames)
+        {
+            static const std::vector<uint64_t> nameHashes = ParseFieldNameHashes(pNames);
+            return nameHashes;
+        }
+
+        static std::vector<uint64_t> ParseFieldNameHashes(const char* pNames)
+        {
+            std::vector<uint64_t> nameHashes;
+
+            std::string name;
+            for (const char* pChar = pNames; ; ++pChar)
+            {
+                if (*pChar == ',' || *pChar == '\0')
+                {
+                    nameHashes.push_back(Serializer::GetNameHash(name));
+                    name.clear();
+                }
+                else if (*pChar != ' ' && *pChar != '\t' && *pChar != '\n' && *pChar != '\r')
+                {
+                    name.push_back(*pChar);
+                }
+
+                if (*pChar == '\0')
+                {
+                    break;
+                }
+            }
+
+            return nameHashes;
+        }
+
+        template <typename T>
+        static LayoutInfo CreateLayoutInfo()
+        {
+            LayoutInfo info;
+            info.size = sizeof(T);
+            info.alignment = alignof(T);
+
+            FingerprintVisitor visitor;
+            visitor.Combine(compile_time::HashKey(typeid(T).name()));
+            visitor.Combine(sizeof(T));
+            visitor.Combine(alignof(T));
+
+            if (VisitFieldTypes<T>(visitor, 0))
+            {
+                // Zero is reserved for types that cannot be swapped in place.
+                info.fingerprint = (visitor.hash == 0) ? 1 : visitor.hash;
+                info.fieldsSize = visitor.fieldsSize;
+            }
+
+            return info;
+        }
+
+        // Call T::Hscpp_VisitFieldTypes if it exists, returning false otherwise.
+        template <typename T, typename Visitor>
+        static auto VisitFieldTypes(Visitor& visitor, int)
+            -> decltype(T::Hscpp_VisitFieldTypes(visitor), bool())
+        {
+            T::Hscpp_VisitFieldTypes(visitor);
+            return true;
+        }
+
+        template <typename T, typename Visitor>
+        static bool VisitFieldTypes(Visitor&, long)
+        {
+            return false;
+        }
+
+        // Call T::Hscpp_VisitFields if it exists, returning false otherwise.
+        template <typename T, typename Visitor>
+        static auto VisitFields(T* pObject, Visitor& visitor, int)
+            -> decltype(pObject->Hscpp_VisitFields(visitor), bool())
+        {
+            pObject->Hscpp_VisitFields(visitor);
+            return true;
+        }
+
+        template <typename T, typename Visitor>
+        static bool VisitFields(T*, Visitor&, long)
+        {
+            return false;
+        }
+    };
+
+}
+
+#ifndef HSCPP_DISABLE
+
+// List the fields of a tracked class, allowing it to be swapped in place when its layout does not
+// change, and migrating fields by name when it does. Fields that are not listed are default
+// constructed on a swap.
+#define HSCPP_FIELDS(...) \
+friend class hscpp::Layout; \
+template <typename Visitor> \
+void Hscpp_VisitFields(Visitor& visitor) \
+{ \
+    visitor(*this, #__VA_ARGS__, __VA_ARGS__); \
+} \
+\
+/* Fields are only named within decltype, so no object is needed. */ \
+template <typename Visitor> \
+static void Hscpp_VisitFieldTypes(Visitor& visitor) \
+{ \
+    visitor(decltype(hscpp::DeduceFieldTypes(__VA_ARGS__))()); \
+}
+
+#else
+
+#define HSCPP_FIELDS(...)
+
+#endif
\ No newline at end of file
@@ -1,7 +1,10 @@
 #pragma once
 
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
+#include <memory>
+#include <functional>
 #include <assert.h>
 
 #include "hscpp/module/ModuleSharedState.h"
@@ -33,16 +36,32 @@ namespace hscpp
         }
 
         virtual void SetTrackersByKey(
-            std::unordered_map<std::string, std::vector<ITracker*>>* pTrackersByKey)
+            std::unordered_map<uint64_t, std::vector<ITracker*>>* pTrackersByKey)
         {
             ModuleSharedState::s_pTrackersByKey = pTrackersByKey;
         }
 
-        virtual void SetConstructorsByKey(std::unordered_map<std::string, IConstructor*>* pConstructorsByKey)
+        virtual void SetCompactTrackersByKey(
+            std::unordered_map<uint64_t, CompactTrackerTable>* pCompactTrackersByKey)
+        {
+            ModuleSharedState::s_pCompactTrackersByKey = pCompactTrackersByKey;
+        }
+
+        virtual void SetTrackerMutex(std::recursive_mutex* pTrackerMutex)
+        {
+            ModuleSharedState::s_pTrackerMutex = pTrackerMutex;
+        }
+
+        virtual void SetConstructorsByKey(std::unordered_map<uint64_t, IConstructor*>* pConstructorsByKey)
         {
             ModuleSharedState::s_pConstructorsByKey = pConstructorsByKey;
         }
 
+        virtual void SetConstructorsGeneration(const uint64_t* pGeneration)
+        {
+            ModuleSharedState::s_pConstructorsGeneration = pGeneration;
+        }
+
         virtual void SetAllocator(IAllocator* pAllocator)
         {
             ModuleSharedState::s_pAllocator = pAllocator;
@@ -53,21 +72,23 @@ namespace hscpp
             GlobalUserData::s_pData = pGlobalUserData;
         }
 
-        virtual std::unordered_map<std::string, IConstructor*> GetModuleConstructorsByKey()
+        virtual std::unordered_map<uint64_t, IConstructor*> GetModuleConstructorsByKey()
         {
-            std::unordered_map<std::string, IConstructor*> constructorsByKey;
+            std::unordered_map<uint64_t, IConstructor*> constructorsByKey;
 
             size_t nConstructorKeys = Constructors::GetNumberOfKeys();
             for (size_t iKey = 0; iKey < nConstructorKeys; ++iKey)
             {
-                std::string key = Constructors::GetKey(iKey);
-                constructorsByKey[key] = Constructors::GetConstructor(key);
+                uint64_t keyHash = Constructors::GetKeyHash(iKey);
+                constructorsByKey[keyHash] = Constructors::GetConstructor(keyHash);
             }
 
             return constructorsByKey;
         }
 
-        virtual void PerformRuntimeSwap()
+        // Instances of classes in unchangedKeyHashes are not swapped, though their constructors are
+        // still patched.
+        virtual void PerformRuntimeSwap(const std::unordered_set<uint64_t>& unchangedKeyHashes)
         {
             *ModuleSharedState::s_pbSwapping = true;
 
@@ -75,67 +96,507 @@ namespace hscpp
             size_t nConstructorKeys = Constructors::GetNumberOfKeys();
             for (size_t iKey = 0; iKey < nConstructorKeys; ++iKey)
             {
-                std::string key = Constructors::GetKey(iKey);
+                uint64_t keyHash = Constructors::GetKeyHash(iKey);
+                IConstructor* pConstructor = Constructors::GetConstructor(keyHash);
 
                 // Patch our global constructors to include the new constructors from this module.
-                (*ModuleSharedState::s_pConstructorsByKey)[key] = Constructors::GetConstructor(key);
+                (*ModuleSharedState::s_pConstructorsByKey)[keyHash] = pConstructor;
+
+                if (unchangedKeyHashes.find(keyHash) != unchangedKeyHashes.end())
+                {
+                    continue;
+                }
 
                 // Find tracked objects corresponding to this constructor. If not found, this must
                 // be a new class, so no instances have been created yet.
-                auto trackersIt = ModuleSharedState::s_pTrackersByKey->find(key);
+                auto trackersIt = ModuleSharedState::s_pTrackersByKey->find(keyHash);
                 if (trackersIt != ModuleSharedState::s_pTrackersByKey->end())
                 {
-                    // Get tracked objects, and make a copy. As objects are freed, their tracker
-                    // will be erased from the trackedObjects vector.
-                    std::vector<ITracker*>& trackedObjects = trackersIt->second;
-                    std::vector<ITracker*> oldTrackedObjects = trackedObjects;
+                    if (!PerformInPlaceRuntimeSwap(trackersIt->second, pConstructor))
+                    {
+                        PerformTrackerRuntimeSwap(trackersIt->second, pConstructor);
+                    }
+                }
+
+                // Objects tracked with HSCPP_TRACK_COMPACT are stored in a separate table.
+                auto compactTrackersIt = ModuleSharedState::s_pCompactTrackersByKey->find(keyHash);
+                if (compactTrackersIt != ModuleSharedState::s_pCompactTrackersByKey->end()
+                    && !compactTrackersIt->second.entries.empty())
+                {
+                    if (!PerformInPlaceCompactRuntimeSwap(compactTrackersIt->second, pConstructor))
+                    {
+                        PerformCompactRuntimeSwap(compactTrackersIt->second, pConstructor);
+                    }
+                }
+            }
 
-                    size_t nInstances = trackedObjects.size();
+            *ModuleSharedState::s_pbSwapping = false;
+        }
 
-                    std::vector<SwapInfo> swapInfos(nInstances);
-                    std::vector<uint64_t> memoryIds(nInstances);
+        // Patch constructors as in PerformRuntimeSwap, but rather than swapping instances, move them
+        // into pending registries to be swapped by PerformRuntimeSwapBatch. Objects tracked with
+        // HSCPP_TRACK_COMPACT are moved into their table's pending entries.
+        virtual void BeginIncrementalRuntimeSwap(const std::unordered_set<uint64_t>& unchangedKeyHashes,
+            std::unordered_map<uint64_t, std::vector<ITracker*>>& pendingTrackersByKey)
+        {
+            *ModuleSharedState::s_pbSwapping = true;
 
-                    // Free the old objects; they will be swapped out with new instances.
-                    for (size_t i = 0; i < nInstances; ++i)
-                    {
-                        swapInfos.at(i).m_Id = i;
-                        swapInfos.at(i).m_Phase = SwapPhase::BeforeSwap;
+            size_t nConstructorKeys = Constructors::GetNumberOfKeys();
+            for (size_t iKey = 0; iKey < nConstructorKeys; ++iKey)
+            {
+                uint64_t keyHash = Constructors::GetKeyHash(iKey);
+                (*ModuleSharedState::s_pConstructorsByKey)[keyHash] = Constructors::GetConstructor(keyHash);
 
-                        ITracker* pTracker = oldTrackedObjects.at(i);
+                if (unchangedKeyHashes.find(keyHash) != unchangedKeyHashes.end())
+                {
+                    continue;
+                }
+
+                auto trackersIt = ModuleSharedState::s_pTrackersByKey->find(keyHash);
+                if (trackersIt != ModuleSharedState::s_pTrackersByKey->end() && !trackersIt->second.empty())
+                {
+                    std::vector<ITracker*>& pendingTrackers = pendingTrackersByKey[keyHash];
+                    assert(pendingTrackers.empty());
 
-                        pTracker->CallSwapHandler(swapInfos.at(i));
-                        memoryIds.at(i) = pTracker->FreeTrackedObject();
+                    // Trackers keep their slot, but must be pointed to their new registry.
+                    pendingTrackers.swap(trackersIt->second);
+                    for (ITracker* pTracker : pendingTrackers)
+                    {
+                        pTracker->m_pTrackers = &pendingTrackers;
                     }
+                }
+
+                auto compactTrackersIt = ModuleSharedState::s_pCompactTrackersByKey->find(keyHash);
+                if (compactTrackersIt != ModuleSharedState::s_pCompactTrackersByKey->end()
+                    && !compactTrackersIt->second.entries.empty())
+                {
+                    CompactTrackerTable& table = compactTrackersIt->second;
+                    assert(table.pendingEntries.empty());
+
+                    table.pendingEntries.swap(table.entries);
+                }
+            }
+        }
+
+        // Swap up to nMaxInstances pending instances, returning the number of instances still
+        // waiting to be swapped. Instances are swapped one at a time, so only a single SwapInfo
+        // is alive at once.
+        virtual size_t PerformRuntimeSwapBatch(
+            std::unordered_map<uint64_t, std::vector<ITracker*>>& pendingTrackersByKey, size_t nMaxInstances)
+        {
+            size_t nSwapped = 0;
+            size_t nRemaining = 0;
 
-                    // Freeing the tracked objects should have also deleted their tracker, so this
-                    // list should now be empty.
-                    assert(trackedObjects.empty());
+            // Only one instance is swapped at a time, so the arena is reused for each instance.
+            SerializerArena arena;
+
+            for (auto& keyHash__pendingTrackers : pendingTrackersByKey)
+            {
+                std::vector<ITracker*>& pendingTrackers = keyHash__pendingTrackers.second;
+                if (nSwapped < nMaxInstances && !pendingTrackers.empty())
+                {
+                    IConstructor* pConstructor = ModuleSharedState::s_pConstructorsByKey->at(keyHash__pendingTrackers.first);
+                    std::vector<ITracker*>& trackedObjects = (*ModuleSharedState::s_pTrackersByKey)[keyHash__pendingTrackers.first];
 
-                    // Create new instances from the new constructors. These will have automatically
-                    // registered themselves into the m_pTrackersByKey map.
-                    IConstructor* pConstructor = Constructors::GetConstructor(key);
+                    LayoutInfo layout = pConstructor->GetLayoutInfo();
 
-                    for (size_t i = 0; i < nInstances; ++i)
+                    std::vector<uint8_t> buffer;
+                    uint8_t* pFields = GetFieldsBuffer(layout, buffer);
+
+                    // Swapping an object frees its old tracker, which removes it from the back of
+                    // the pending trackers.
+                    for (; nSwapped < nMaxInstances && !pendingTrackers.empty(); ++nSwapped)
                     {
-                        pConstructor->AllocateSwap(memoryIds.at(i));
+                        PerformPendingTrackerSwap(pendingTrackers, trackedObjects, pConstructor, layout, pFields, arena);
+                        arena.Reset();
+                    }
+                }
 
-                        // After construction, a new tracker should have been added to trackedObjects.
-                        ITracker* pTracker = trackedObjects.at(i);
+                nRemaining += pendingTrackers.size();
+            }
 
-                        swapInfos.at(i).m_Phase = SwapPhase::AfterSwap;
-                        pTracker->CallSwapHandler(swapInfos.at(i));
-                        swapInfos.at(i).TriggerInitCb();
+            for (auto& keyHash__table : *ModuleSharedState::s_pCompactTrackersByKey)
+            {
+                CompactTrackerTable& table = keyHash__table.second;
+                if (nSwapped < nMaxInstances && !table.pendingEntries.empty())
+                {
+                    IConstructor* pConstructor = ModuleSharedState::s_pConstructorsByKey->at(keyHash__table.first);
+                    LayoutInfo layout = pConstructor->GetLayoutInfo();
+
+                    std::vector<uint8_t> buffer;
+                    uint8_t* pFields = GetFieldsBuffer(layout, buffer);
+
+                    for (; nSwapped < nMaxInstances && !table.pendingEntries.empty(); ++nSwapped)
+                    {
+                        PerformPendingCompactSwap(table, pConstructor, layout, pFields, arena);
+                        arena.Reset();
                     }
                 }
+
+                nRemaining += table.pendingEntries.size();
             }
 
-            *ModuleSharedState::s_pbSwapping = false;
+            return nRemaining;
+        }
+
+        virtual void PerformTrackerRuntimeSwap(std::vector<ITracker*>& trackedObjects, IConstructor* pConstructor)
+        {
+            // Make a copy of the tracked objects. As objects are freed, their tracker will be
+            // removed from the trackedObjects vector, which may reorder it. The copy preserves the
+            // original order, so that SwapInfo ids match between the old and new instances.
+            std::vector<ITracker*> oldTrackedObjects = trackedObjects;
+
+            size_t nInstances = trackedObjects.size();
+
+            // Saved fields of every instance are allocated from a single arena.
+            SerializerArena arena;
+            std::vector<SwapInfo> swapInfos(nInstances);
+            std::vector<uint64_t> memoryIds(nInstances);
+
+            // Free the old objects; they will be swapped out with new instances.
+            for (size_t i = 0; i < nInstances; ++i)
+            {
+                swapInfos.at(i).m_Serializer.SetArena(&arena);
+                swapInfos.at(i).m_Id = i;
+                swapInfos.at(i).m_Phase = SwapPhase::BeforeSwap;
+
+                ITracker* pTracker = oldTrackedObjects.at(i);
+
+                pTracker->CallSwapHandler(swapInfos.at(i));
+                memoryIds.at(i) = pTracker->FreeTrackedObject();
+            }
+
+            // Freeing the tracked objects should have also deleted their tracker, so this list
+            // should now be empty.
+            assert(trackedObjects.empty());
+
+            // Create new instances from the new constructors. These will have automatically
+            // registered themselves into the m_pTrackersByKey map. Instances are allocated in a
+            // single batch, so that the allocator can place them contiguously.
+            pConstructor->AllocateSwapBatch(memoryIds);
+
+            for (size_t i = 0; i < nInstances; ++i)
+            {
+                // After construction, a new tracker should have been added to trackedObjects.
+                ITracker* pTracker = trackedObjects.at(i);
+
+                swapInfos.at(i).m_Phase = SwapPhase::AfterSwap;
+                pTracker->CallSwapHandler(swapInfos.at(i));
+                swapInfos.at(i).TriggerInitCb();
+            }
+        }
+
+        virtual bool PerformInPlaceRuntimeSwap(std::vector<ITracker*>& trackedObjects, IConstructor* pConstructor)
+        {
+            // If every old object has the same layout as the new type, objects are reconstructed in
+            // their own memory, moving their fields across. Objects with a swap handler must go
+            // through a regular swap, so that the handler is called.
+            LayoutInfo layout = pConstructor->GetLayoutInfo();
+            if (layout.fingerprint == 0)
+            {
+                return false;
+            }
+
+            for (ITracker* pTracker : trackedObjects)
+            {
+                if (pTracker->GetLayoutFingerprint() != layout.fingerprint || pTracker->HasSwapHandler())
+                {
+                    return false;
+                }
+            }
+
+            std::vector<uint8_t> buffer;
+            uint8_t* pFields = GetFieldsBuffer(layout, buffer);
+
+            std::vector<ITracker*> oldTrackedObjects = trackedObjects;
+            for (ITracker* pTracker : oldTrackedObjects)
+            {
+                uint8_t* pMemory = pTracker->RelocateTrackedObject(pFields);
+                pConstructor->ConstructInPlace(pMemory, pFields);
+            }
+
+            return true;
+        }
+
+        virtual bool PerformInPlaceCompactRuntimeSwap(CompactTrackerTable& table, IConstructor* pConstructor)
+        {
+            LayoutInfo layout = pConstructor->GetLayoutInfo();
+            if (layout.fingerprint == 0)
+            {
+                return false;
+            }
+
+            for (const auto& entry : table.entries)
+            {
+                if (entry.pOps->GetLayoutFingerprint() != layout.fingerprint || entry.pOps->HasSwapHandler())
+                {
+                    return false;
+                }
+            }
+
+            std::vector<uint8_t> buffer;
+            uint8_t* pFields = GetFieldsBuffer(layout, buffer);
+
+            std::vector<CompactTrackerTable::Entry> oldEntries = table.entries;
+            for (const auto& entry : oldEntries)
+            {
+                uint8_t* pMemory = entry.pOps->RelocateTrackedObject(entry.pObject, pFields);
+                pConstructor->ConstructInPlace(pMemory, pFields);
+            }
+
+            return true;
+        }
+
+        virtual void PerformCompactRuntimeSwap(CompactTrackerTable& table, IConstructor* pConstructor)
+        {
+            // Same as a regular swap, but the swap handler and destructor are called through each
+            // entry's ops, which belong to the module that constructed the old object.
+            std::vector<CompactTrackerTable::Entry> oldEntries = table.entries;
+
+            size_t nInstances = oldEntries.size();
+
+            SerializerArena arena;
+            std::vector<SwapInfo> swapInfos(nInstances);
+            std::vector<uint64_t> memoryIds(nInstances);
+
+            for (size_t i = 0; i < nInstances; ++i)
+            {
+                swapInfos.at(i).m_Serializer.SetArena(&arena);
+                swapInfos.at(i).m_Id = i;
+                swapInfos.at(i).m_Phase = SwapPhase::BeforeSwap;
+
+                const CompactTrackerTable::Entry& entry = oldEntries.at(i);
+
+                entry.pOps->CallSwapHandler(entry.pObject, swapInfos.at(i));
+                memoryIds.at(i) = entry.pOps->FreeTrackedObject(entry.pObject);
+            }
+
+            assert(table.entries.empty());
+
+            pConstructor->AllocateSwapBatch(memoryIds);
+
+            for (size_t i = 0; i < nInstances; ++i)
+            {
+                // Constructing the object added it to the table, along with this module's ops.
+                const CompactTrackerTable::Entry& entry = table.entries.at(i);
+
+                swapInfos.at(i).m_Phase = SwapPhase::AfterSwap;
+                entry.pOps->CallSwapHandler(entry.pObject, swapInfos.at(i));
+                swapInfos.at(i).TriggerInitCb();
+            }
+        }
+
+        // Call the swap handler of every tracked object, as though it were about to be swapped, and
+        // pass the state it saved to cb. Objects are not modified.
+        virtual void SaveTrackedObjects(const std::function<void(uint64_t keyHash, const Serializer& serializer)>& cb)
+        {
+            SerializerArena arena;
+
+            for (auto& keyHash__trackers : *ModuleSharedState::s_pTrackersByKey)
+            {
+                uint64_t id = 0;
+                for (ITracker* pTracker : keyHash__trackers.second)
+                {
+                    SwapInfo swapInfo;
+                    swapInfo.m_Serializer.SetArena(&arena);
+                    swapInfo.m_Id = id++;
+                    swapInfo.m_Phase = SwapPhase::BeforeSwap;
+                    swapInfo.m_bSnapshot = true;
+
+                    pTracker->CallSwapHandler(swapInfo);
+                    cb(keyHash__trackers.first, swapInfo.m_Serializer);
+                }
+
+                arena.Reset();
+            }
+
+            for (auto& keyHash__table : *ModuleSharedState::s_pCompactTrackersByKey)
+            {
+                uint64_t id = 0;
+                for (const auto& entry : keyHash__table.second.entries)
+                {
+                    SwapInfo swapInfo;
+                    swapInfo.m_Serializer.SetArena(&arena);
+                    swapInfo.m_Id = id++;
+                    swapInfo.m_Phase = SwapPhase::BeforeSwap;
+                    swapInfo.m_bSnapshot = true;
+
+                    entry.pOps->CallSwapHandler(entry.pObject, swapInfo);
+                    cb(keyHash__table.first, swapInfo.m_Serializer);
+                }
+
+                arena.Reset();
+            }
+        }
+
+        // Construct an object of the class with the given key, and call its swap handler as though it
+        // had just been swapped, with the state added by restoreCb. Returns false if no class has
+        // the given key.
+        virtual bool RestoreTrackedObject(uint64_t keyHash, uint64_t id,
+            const std::function<void(Serializer& serializer)>& restoreCb)
+        {
+            auto constructorIt = ModuleSharedState::s_pConstructorsByKey->find(keyHash);
+            if (constructorIt == ModuleSharedState::s_pConstructorsByKey->end())
+            {
+                return false;
+            }
+
+            size_t nTrackers = GetNumberOfTrackedObjects(keyHash);
+            constructorIt->second->Allocate();
+
+            SwapInfo swapInfo;
+            swapInfo.m_Id = id;
+            swapInfo.m_Phase = SwapPhase::AfterSwap;
+            swapInfo.m_bSnapshot = true;
+            restoreCb(swapInfo.m_Serializer);
+
+            // Constructing the object registered it with either its tracker or its table.
+            if (GetNumberOfTrackedObjects(keyHash) > nTrackers)
+            {
+                auto trackersIt = ModuleSharedState::s_pTrackersByKey->find(keyHash);
+                auto compactTrackersIt = ModuleSharedState::s_pCompactTrackersByKey->find(keyHash);
+
+                if (trackersIt != ModuleSharedState::s_pTrackersByKey->end() && !trackersIt->second.empty())
+                {
+                    trackersIt->second.back()->CallSwapHandler(swapInfo);
+                }
+                else if (compactTrackersIt != ModuleSharedState::s_pCompactTrackersByKey->end())
+                {
+                    CompactTrackerTable& table = compactTrackersIt->second;
+                    table.entries.back().pOps->CallSwapHandler(table.entries.back().pObject, swapInfo);
+                }
+            }
+
+            swapInfo.TriggerInitCb();
+            return true;
         }
 
         virtual std::vector<Constructors::DuplicateKey> GetDuplicateKeys()
         {
             return Constructors::GetDuplicateKeys();
         }
+
+        virtual std::vector<Constructors::KeyCollision> GetKeyCollisions()
+        {
+            return Constructors::GetKeyCollisions();
+        }
+
+        virtual std::unordered_map<uint64_t, std::string> GetClassFilePathsByKey()
+        {
+            std::unordered_map<uint64_t, std::string> classFilePathsByKey;
+
+            size_t nConstructorKeys = Constructors::GetNumberOfKeys();
+            for (size_t iKey = 0; iKey < nConstructorKeys; ++iKey)
+            {
+                uint64_t keyHash = Constructors::GetKeyHash(iKey);
+                classFilePathsByKey[keyHash] = Constructors::GetClassFilePath(keyHash);
+            }
+
+            return classFilePathsByKey;
+        }
+
+        virtual std::vector<std::string> GetKeys()
+        {
+            std::vector<std::string> keys;
+
+            size_t nConstructorKeys = Constructors::GetNumberOfKeys();
+            for (size_t iKey = 0; iKey < nConstructorKeys; ++iKey)
+            {
+                keys.push_back(Constructors::GetKey(iKey));
+            }
+
+            return keys;
+        }
+
+    private:
+        static size_t GetNumberOfTrackedObjects(uint64_t keyHash)
+        {
+            size_t nTrackedObjects = 0;
+
+            auto trackersIt = ModuleSharedState::s_pTrackersByKey->find(keyHash);
+            if (trackersIt != ModuleSharedState::s_pTrackersByKey->end())
+            {
+                nTrackedObjects += trackersIt->second.size();
+            }
+
+            auto compactTrackersIt = ModuleSharedState::s_pCompactTrackersByKey->find(keyHash);
+            if (compactTrackersIt != ModuleSharedState::s_pCompactTrackersByKey->end())
+            {
+                nTrackedObjects += compactTrackersIt->second.entries.size();
+            }
+
+            return nTrackedObjects;
+        }
+
+        static void PerformPendingTrackerSwap(std::vector<ITracker*>& pendingTrackers,
+            std::vector<ITracker*>& trackedObjects, IConstructor* pConstructor, const LayoutInfo& layout, uint8_t* pFields,
+            SerializerArena& arena)
+        {
+            ITracker* pTracker = pendingTrackers.back();
+
+            if (layout.fingerprint != 0 && pTracker->GetLayoutFingerprint() == layout.fingerprint
+                && !pTracker->HasSwapHandler())
+            {
+                uint8_t* pMemory = pTracker->RelocateTrackedObject(pFields);
+                pConstructor->ConstructInPlace(pMemory, pFields);
+                return;
+            }
+
+            SwapInfo swapInfo;
+            swapInfo.m_Serializer.SetArena(&arena);
+            swapInfo.m_Id = pendingTrackers.size() - 1;
+            swapInfo.m_Phase = SwapPhase::BeforeSwap;
+
+            pTracker->CallSwapHandler(swapInfo);
+            uint64_t memoryId = pTracker->FreeTrackedObject();
+
+            // Constructing the new object adds its tracker to the back of trackedObjects.
+            pConstructor->AllocateSwap(memoryId);
+
+            swapInfo.m_Phase = SwapPhase::AfterSwap;
+            trackedObjects.back()->CallSwapHandler(swapInfo);
+            swapInfo.TriggerInitCb();
+        }
+
+        static void PerformPendingCompactSwap(CompactTrackerTable& table,
+            IConstructor* pConstructor, const LayoutInfo& layout, uint8_t* pFields, SerializerArena& arena)
+        {
+            void* pObject = table.pendingEntries.back().pObject;
+            ICompactTrackerOps* pOldOps = table.pendingEntries.back().pOps;
+
+            if (layout.fingerprint != 0 && pOldOps->GetLayoutFingerprint() == layout.fingerprint
+                && !pOldOps->HasSwapHandler())
+            {
+                uint8_t* pMemory = pOldOps->RelocateTrackedObject(pObject, pFields);
+                pConstructor->ConstructInPlace(pMemory, pFields);
+                return;
+            }
+
+            SwapInfo swapInfo;
+            swapInfo.m_Serializer.SetArena(&arena);
+            swapInfo.m_Id = table.pendingEntries.size() - 1;
+            swapInfo.m_Phase = SwapPhase::BeforeSwap;
+
+            pOldOps->CallSwapHandler(pObject, swapInfo);
+            uint64_t memoryId = pOldOps->FreeTrackedObject(pObject);
+
+            pConstructor->AllocateSwap(memoryId);
+
+            swapInfo.m_Phase = SwapPhase::AfterSwap;
+            table.entries.back().pOps->CallSwapHandler(table.entries.back().pObject, swapInfo);
+            swapInfo.TriggerInitCb();
+        }
+
+        // Temporary storage for the fields of an object being swapped in place.
+        static uint8_t* GetFieldsBuffer(const LayoutInfo& layout, std::vector<uint8_t>& buffer)
+        {
+            buffer.resize(layout.fieldsSize + layout.alignment);
+
+            void* pFields = buffer.data();
+            size_t space = buffer.size();
+
+            return static_cast<uint8_t*>(std::align(layout.alignment, layout.fieldsSize, pFields, space));
+        }
     };
 }
 
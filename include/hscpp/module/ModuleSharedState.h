@@ -1,7 +1,9 @@
 #pragma once
 
 #include <unordered_map>
-#include <string>
+#include <vector>
+#include <cstdint>
+#include <mutex>
 
 #include "hscpp/module/IAllocator.h"
 
@@ -10,15 +12,34 @@ namespace hscpp
 
     class ITracker;
     class IConstructor;
+    struct CompactTrackerTable;
 
     class ModuleSharedState
     {
     public:
         // Internal global state required by hscpp. Modify at your own peril.
         static bool* s_pbSwapping;
-        static std::unordered_map<std::string, std::vector<ITracker*>>* s_pTrackersByKey;
-        static std::unordered_map<std::string, IConstructor*>* s_pConstructorsByKey;
+        static std::unordered_map<uint64_t, std::vector<ITracker*>>* s_pTrackersByKey;
+        static std::unordered_map<uint64_t, CompactTrackerTable>* s_pCompactTrackersByKey;
+        static std::unordered_map<uint64_t, IConstructor*>* s_pConstructorsByKey;
+        static const uint64_t* s_pConstructorsGeneration; // Changes whenever constructors are patched.
         static IAllocator* s_pAllocator;
+
+        // Guards the tracker and constructor tables, so that tracked objects can be created and
+        // destroyed on several threads. Runtime swaps hold it while walking the tables. It is
+        // recursive, as swaps construct and destroy tracked objects. nullptr when hscpp is not
+        // managing the tables, in which case nothing is locked.
+        static std::recursive_mutex* s_pTrackerMutex;
+
+        static std::unique_lock<std::recursive_mutex> LockTrackers()
+        {
+            if (s_pTrackerMutex == nullptr)
+            {
+                return std::unique_lock<std::recursive_mutex>();
+            }
+
+            return std::unique_lock<std::recursive_mutex>(*s_pTrackerMutex);
+        }
     };
 
 }
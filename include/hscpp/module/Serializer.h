@@ -1,29 +1,89 @@
 #pragma once
 
-#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
 #include <memory>
+#include <new>
 #include <string>
+#include <typeinfo>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "hscpp/module/CompileTimeString.h"
 
 namespace hscpp
 {
 
-    struct ISerializedProperty
+    // Bump allocator for serialized properties. A single arena is shared by every SwapInfo in a
+    // swap, so that saving a field does not allocate. Memory is released when the arena is
+    // destroyed, or reused after Reset.
+    class SerializerArena
     {
-        virtual ~ISerializedProperty() = default;
-    };
+    public:
+        explicit SerializerArena(size_t blockSize = 4096)
+            : m_BlockSize(blockSize)
+        {}
 
-    template <typename T>
-    struct SerializedCopyProperty : public ISerializedProperty
-    {
-        T value = T();
-    };
+        SerializerArena(const SerializerArena& rhs) = delete;
+        SerializerArena& operator=(const SerializerArena& rhs) = delete;
 
-    template <typename T>
-    struct SerializedMoveProperty : public ISerializedProperty
-    {
-        std::unique_ptr<T> value;
+        uint8_t* Allocate(size_t size, size_t alignment)
+        {
+            while (m_iBlock < m_Blocks.size())
+            {
+                Block& block = m_Blocks.at(m_iBlock);
+
+                uintptr_t start = reinterpret_cast<uintptr_t>(block.pMemory.get());
+                uintptr_t aligned = (start + m_Offset + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+
+                if (aligned + size <= start + block.size)
+                {
+                    m_Offset = static_cast<size_t>(aligned + size - start);
+                    return reinterpret_cast<uint8_t*>(aligned);
+                }
+
+                ++m_iBlock;
+                m_Offset = 0;
+            }
+
+            Block block;
+            block.size = (std::max)(m_BlockSize, size + alignment);
+            block.pMemory = std::unique_ptr<uint8_t[]>(new uint8_t[block.size]);
+
+            m_Blocks.push_back(std::move(block));
+            m_iBlock = m_Blocks.size() - 1;
+
+            return Allocate(size, alignment);
+        }
+
+        // Reuse memory for the next allocations. Previously allocated memory must no longer be used.
+        void Reset()
+        {
+            m_iBlock = 0;
+            m_Offset = 0;
+        }
+
+    private:
+        struct Block
+        {
+            std::unique_ptr<uint8_t[]> pMemory;
+            size_t size = 0;
+        };
+
+        size_t m_BlockSize = 0;
+
+        std::vector<Block> m_Blocks;
+        size_t m_iBlock = 0;
+        size_t m_Offset = 0;
     };
 
+    // Stores properties by the hash of their name, and checks the hash of their type when they are
+    // read back, such that reading a property as a different type fails rather than reinterpreting
+    // its memory. Hashes are computed the same way in every module, so properties written by the old
+    // module can be read by the new module. Trivially copyable values are copied with memcpy.
     class Serializer
     {
     public:
@@ -31,58 +91,295 @@ namespace hscpp
         Serializer(const Serializer& rhs) = delete;
         Serializer& operator=(const Serializer& rhs) = delete;
 
+        ~Serializer()
+        {
+            for (uint32_t i = 0; i < m_Capacity; ++i)
+            {
+                Property& property = m_pProperties[i];
+                if (property.pDestroy != nullptr)
+                {
+                    property.pDestroy(property.pValue);
+                }
+            }
+        }
+
+        // Allocate properties from pArena, which must outlive this Serializer. If no arena is set,
+        // the Serializer creates its own.
+        void SetArena(SerializerArena* pArena)
+        {
+            m_pArena = pArena;
+        }
+
         template <typename T>
         void SerializeCopy(const std::string& name, const T& val)
         {
-           auto pProperty = std::unique_ptr<SerializedCopyProperty<T>>(
-               new SerializedCopyProperty<T>());
-           pProperty->value = val;
-
-            m_Properties[name] = std::move(pProperty);
+            SerializeCopy(GetNameHash(name), val);
         }
 
         template <typename T>
         bool UnserializeCopy(const std::string& name, T& val)
         {
-            auto propertyIt = m_Properties.find(name);
-            if (propertyIt != m_Properties.end())
+            Property* pProperty = FindProperty<T>(GetNameHash(name));
+            if (pProperty == nullptr)
             {
-                ISerializedProperty* pProperty = propertyIt->second.get();
-                val = static_cast<SerializedCopyProperty<T>*>(pProperty)->value;
-
-                return true;
+                return false;
             }
 
-            return false;
+            Assign(val, *static_cast<T*>(pProperty->pValue));
+            return true;
         }
 
         template <typename T>
         void SerializeMove(const std::string& name, T&& val)
         {
-            auto pProperty = std::unique_ptr<SerializedMoveProperty<T>>(
-                new SerializedMoveProperty<T>());
-            pProperty->value = std::unique_ptr<T>(new T(std::move(val)));
-
-            m_Properties[name] = std::move(pProperty);
+            SerializeMove(GetNameHash(name), std::move(val));
         }
 
         template <typename T>
         bool UnserializeMove(const std::string& name, T& val)
         {
-            auto propertyIt = m_Properties.find(name);
-            if (propertyIt != m_Properties.end())
-            {
-                ISerializedProperty* pProperty = propertyIt->second.get();
-                val = std::move(*static_cast<SerializedMoveProperty<T>*>(pProperty)->value);
+            return UnserializeMove(GetNameHash(name), val);
+        }
 
-                return true;
+        // Call cb with the bytes of each trivially copyable property. Used to write snapshots.
+        void EnumerateTriviallyCopyableProperties(const std::function<void(uint64_t nameHash,
+            uint64_t typeHash, const uint8_t* pValue, size_t size)>& cb) const
+        {
+            for (uint32_t i = 0; i < m_Capacity; ++i)
+            {
+                const Property& property = m_pProperties[i];
+                if (property.nameHash != 0 && property.bTriviallyCopyable)
+                {
+                    cb(property.nameHash, property.typeHash, static_cast<const uint8_t*>(property.pValue), property.size);
+                }
             }
+        }
+
+        // Add a trivially copyable property whose bytes are stored in pValue. The property refers to
+        // pValue rather than copying it, so pValue must outlive this Serializer. Used to read snapshots.
+        void AddTriviallyCopyableProperty(uint64_t nameHash, uint64_t typeHash, const uint8_t* pValue, size_t size)
+        {
+            Property* pProperty = AddProperty(nameHash, typeHash, size, nullptr);
+            pProperty->pValue = const_cast<uint8_t*>(pValue);
+            pProperty->bTriviallyCopyable = true;
+        }
 
-            return false;
+        size_t GetNumberOfProperties() const
+        {
+            return m_nProperties;
+        }
+
+        // Record a property that was not saved to a snapshot, as it is not trivially copyable.
+        void SkipProperty()
+        {
+            ++m_nSkippedProperties;
+        }
+
+        size_t GetNumberOfSkippedProperties() const
+        {
+            return m_nSkippedProperties;
         }
 
     private:
-        std::unordered_map<std::string, std::unique_ptr<ISerializedProperty>> m_Properties;
+        // Layout saves fields by precomputed name hashes.
+        friend class Layout;
+
+        struct Property
+        {
+            uint64_t nameHash = 0; // Zero marks an empty slot.
+            uint64_t typeHash = 0;
+            void* pValue = nullptr;
+            void (*pDestroy)(void* pValue) = nullptr;
+            size_t size = 0;
+            bool bTriviallyCopyable = false;
+        };
+
+        SerializerArena* m_pArena = nullptr;
+        std::unique_ptr<SerializerArena> m_pOwnedArena;
+
+        // Open-addressed table, allocated from the arena. When grown, the old table is abandoned.
+        Property* m_pProperties = nullptr;
+        uint32_t m_Capacity = 0;
+        uint32_t m_nProperties = 0;
+        uint32_t m_nSkippedProperties = 0;
+
+        template <typename T>
+        static uint64_t GetTypeHash()
+        {
+            static const uint64_t hash = compile_time::HashKey(typeid(T).name());
+            return hash;
+        }
+
+        static uint64_t GetNameHash(const std::string& name)
+        {
+            uint64_t hash = compile_time::HashKey(name.c_str());
+            return (hash == 0) ? 1 : hash;
+        }
+
+        template <typename T>
+        static void Destroy(void* pValue)
+        {
+            static_cast<T*>(pValue)->~T();
+        }
+
+        template <typename T>
+        static void Construct(void* pValue, const T& val,
+            typename std::enable_if<std::is_trivially_copyable<T>::value>::type* = nullptr)
+        {
+            std::memcpy(pValue, &val, sizeof(T));
+        }
+
+        template <typename T>
+        static void Construct(void* pValue, const T& val,
+            typename std::enable_if<!std::is_trivially_copyable<T>::value>::type* = nullptr)
+        {
+            new (pValue) T(val);
+        }
+
+        template <typename T>
+        static void Assign(T& val, const T& serializedVal,
+            typename std::enable_if<std::is_trivially_copyable<T>::value>::type* = nullptr)
+        {
+            std::memcpy(&val, &serializedVal, sizeof(T));
+        }
+
+        template <typename T>
+        static void Assign(T& val, const T& serializedVal,
+            typename std::enable_if<!std::is_trivially_copyable<T>::value>::type* = nullptr)
+        {
+            val = serializedVal;
+        }
+
+        template <typename T>
+        void SerializeCopy(uint64_t nameHash, const T& val)
+        {
+            Property* pProperty = AddProperty<T>(nameHash);
+            Construct<T>(pProperty->pValue, val);
+        }
+
+        template <typename T>
+        void SerializeMove(uint64_t nameHash, T&& val)
+        {
+            typedef typename std::decay<T>::type Value;
+
+            Property* pProperty = AddProperty<Value>(nameHash);
+            new (pProperty->pValue) Value(std::move(val));
+        }
+
+        template <typename T>
+        bool UnserializeMove(uint64_t nameHash, T& val)
+        {
+            Property* pProperty = FindProperty<T>(nameHash);
+            if (pProperty == nullptr)
+            {
+                return false;
+            }
+
+            val = std::move(*static_cast<T*>(pProperty->pValue));
+            return true;
+        }
+
+        template <typename T>
+        Property* AddProperty(uint64_t nameHash)
+        {
+            Property* pProperty = AddProperty(nameHash, GetTypeHash<T>(), sizeof(T),
+                std::is_trivially_destructible<T>::value ? nullptr : &Destroy<T>);
+
+            pProperty->pValue = GetArena()->Allocate(sizeof(T), alignof(T));
+            pProperty->bTriviallyCopyable = std::is_trivially_copyable<T>::value;
+
+            return pProperty;
+        }
+
+        Property* AddProperty(uint64_t nameHash, uint64_t typeHash, size_t size, void (*pDestroy)(void* pValue))
+        {
+            if (m_nProperties >= m_Capacity / 2)
+            {
+                Grow();
+            }
+
+            Property* pProperty = FindSlot(nameHash);
+            if (pProperty->nameHash == 0)
+            {
+                ++m_nProperties;
+            }
+            else if (pProperty->pDestroy != nullptr)
+            {
+                // Overwrite the previous value with the same name.
+                pProperty->pDestroy(pProperty->pValue);
+            }
+
+            pProperty->nameHash = nameHash;
+            pProperty->typeHash = typeHash;
+            pProperty->size = size;
+            pProperty->pDestroy = pDestroy;
+
+            return pProperty;
+        }
+
+        template <typename T>
+        Property* FindProperty(uint64_t nameHash)
+        {
+            if (m_Capacity == 0)
+            {
+                return nullptr;
+            }
+
+            // The size is checked as well, in case a property restored from a snapshot was saved
+            // by a type with the same name but a different layout.
+            Property* pProperty = FindSlot(nameHash);
+            if (pProperty->nameHash == 0 || pProperty->typeHash != GetTypeHash<T>() || pProperty->size != sizeof(T))
+            {
+                return nullptr;
+            }
+
+            return pProperty;
+        }
+
+        Property* FindSlot(uint64_t nameHash)
+        {
+            uint32_t iSlot = static_cast<uint32_t>(nameHash) & (m_Capacity - 1);
+            while (m_pProperties[iSlot].nameHash != 0 && m_pProperties[iSlot].nameHash != nameHash)
+            {
+                iSlot = (iSlot + 1) & (m_Capacity - 1);
+            }
+
+            return &m_pProperties[iSlot];
+        }
+
+        void Grow()
+        {
+            Property* pOldProperties = m_pProperties;
+            uint32_t oldCapacity = m_Capacity;
+
+            m_Capacity = (m_Capacity == 0) ? 8 : m_Capacity * 2;
+            m_pProperties = reinterpret_cast<Property*>(
+                GetArena()->Allocate(sizeof(Property) * m_Capacity, alignof(Property)));
+
+            for (uint32_t i = 0; i < m_Capacity; ++i)
+            {
+                new (&m_pProperties[i]) Property();
+            }
+
+            for (uint32_t i = 0; i < oldCapacity; ++i)
+            {
+                if (pOldProperties[i].nameHash != 0)
+                {
+                    *FindSlot(pOldProperties[i].nameHash) = pOldProperties[i];
+                }
+            }
+        }
+
+        SerializerArena* GetArena()
+        {
+            if (m_pArena == nullptr)
+            {
+                m_pOwnedArena = std::unique_ptr<SerializerArena>(new SerializerArena(1024));
+                m_pArena = m_pOwnedArena.get();
+            }
+
+            return m_pArena;
+        }
     };
 
 }
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include <assert.h>
 #include <limits>
 #include <functional>
+#include <type_traits>
 
 #include "hscpp/module/Serializer.h"
 
@@ -28,6 +29,13 @@ namespace hscpp
             return m_Id;
         }
 
+        // True if state is being saved to a snapshot, or restored from one in a new process. Only
+        // trivially copyable items are kept in a snapshot, and pointers will not be valid.
+        bool IsSnapshot() const
+        {
+            return m_bSnapshot;
+        }
+
         void SetInitCb(const std::function<void()>& cb)
         {
             m_InitCb = cb;
@@ -71,7 +79,7 @@ namespace hscpp
                     SerializeMove(name, std::move(val));
                     break;
                 case SwapPhase::AfterSwap:
-                    Unserialize(name, val);
+                    UnserializeMove(name, val);
                     break;
                 default:
                     assert(false);
@@ -79,10 +87,19 @@ namespace hscpp
             }
         }
 
+        // When saving a snapshot, objects are not modified. Trivially copyable values are copied
+        // instead, and other values are skipped.
         template <typename T>
         void SerializeMove(const std::string& name, T&& val)
         {
-            m_Serializer.SerializeMove(name, std::move(val));
+            if (m_bSnapshot)
+            {
+                SerializeSnapshot(name, val, std::is_trivially_copyable<typename std::decay<T>::type>());
+            }
+            else
+            {
+                m_Serializer.SerializeMove(name, std::move(val));
+            }
         }
 
         template <typename T>
@@ -92,14 +109,30 @@ namespace hscpp
         }
 
     private:
-        // m_Id and m_Phase are set in ModuleInterface during swapping.
+        // m_Id, m_Phase, and m_bSnapshot are set in ModuleInterface during swapping.
         friend class ModuleInterface;
 
+        // Layout saves fields listed with HSCPP_FIELDS directly to the serializer.
+        friend class Layout;
+
         SwapPhase m_Phase = {};
         uint64_t m_Id = (std::numeric_limits<uint64_t>::max)();
+        bool m_bSnapshot = false;
         Serializer m_Serializer;
         std::function<void()> m_InitCb;
 
+        template <typename T>
+        void SerializeSnapshot(const std::string& name, const T& val, std::true_type)
+        {
+            m_Serializer.SerializeCopy(name, val);
+        }
+
+        template <typename T>
+        void SerializeSnapshot(const std::string&, const T&, std::false_type)
+        {
+            m_Serializer.SkipProperty();
+        }
+
         // ModuleInterface will call this on newly created class.
         void TriggerInitCb()
         {
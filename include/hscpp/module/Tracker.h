@@ -2,11 +2,13 @@
 
 #include <functional>
 #include <algorithm>
+#include <utility>
 
 #include "hscpp/module/CompileTimeString.h"
 #include "hscpp/module/Constructors.h"
 #include "hscpp/module/ModuleSharedState.h"
 #include "hscpp/module/SwapInfo.h"
+#include "hscpp/module/Layout.h"
 #include "hscpp/module/ModuleInterface.h" // Added so it is included in module build.
 #include "hscpp/module/PreprocessorMacros.h" // Added so macros are available when using a tracked class.
 
@@ -25,13 +27,27 @@ namespace hscpp
         {
             // This will be executed on module load.
             const char* pKey = CompileTimeKey().ToString();
-            hscpp::Constructors::RegisterConstructor<T>(pKey);
+            hscpp::Constructors::RegisterConstructor<T>(pKey, CompileTimeKey::hash, GetClassFilePath<T>(0));
         }
 
         // Unused static may be optimized out. Explicitly call this function to ensure that Register
         // gets initialized.
         void ForceInitialization()
         {}
+
+    private:
+        // File in which HSCPP_TRACK was used, if available.
+        template <typename U>
+        static auto GetClassFilePath(int) -> decltype(U::Hscpp_GetClassFilePath())
+        {
+            return U::Hscpp_GetClassFilePath();
+        }
+
+        template <typename U>
+        static const char* GetClassFilePath(long)
+        {
+            return "";
+        }
     };
 
     //============================================================================
@@ -55,21 +71,29 @@ namespace hscpp
             // Pointer to the instance we are tracking.
             m_pTrackedObj = pTrackedObj;
 
-            // Register self.
-            const char* pKey = CompileTimeKey().ToString();
-            (*ModuleSharedState::s_pTrackersByKey)[pKey].push_back(this);
+            // Register self. Keys are hashed at compile time, so this does not allocate a string.
+            // Registries are stored in an unordered_map, so their addresses are stable.
+            std::unique_lock<std::recursive_mutex> lock = ModuleSharedState::LockTrackers();
+            m_pTrackers = &(*ModuleSharedState::s_pTrackersByKey)[CompileTimeKey::hash];
+
+            m_iSlot = m_pTrackers->size();
+            m_pTrackers->push_back(this);
         }
 
         ~Tracker()
         {
-            // Unregister self.
-            const char* pKey = CompileTimeKey().ToString();
-            std::vector<ITracker*>& trackers = (*ModuleSharedState::s_pTrackersByKey)[pKey];
+            // Unregister self, by moving the last tracker into this tracker's slot.
+            std::unique_lock<std::recursive_mutex> lock = ModuleSharedState::LockTrackers();
+            std::vector<ITracker*>& trackers = *m_pTrackers;
 
-            auto trackerIt = std::find(trackers.begin(), trackers.end(), this);
-            if (trackerIt != trackers.end())
+            if (m_iSlot < trackers.size() && trackers.at(m_iSlot) == this)
             {
-                trackers.erase(trackerIt);
+                ITracker* pLastTracker = trackers.back();
+
+                trackers.at(m_iSlot) = pLastTracker;
+                pLastTracker->m_iSlot = m_iSlot;
+
+                trackers.pop_back();
             }
         }
 
@@ -90,10 +114,22 @@ namespace hscpp
 
         void CallSwapHandler(SwapInfo& info) override
         {
+            // Fields listed with HSCPP_FIELDS are loaded before the swap handler and saved after it,
+            // so that the swap handler sees them intact.
+            if (info.Phase() == SwapPhase::AfterSwap)
+            {
+                Layout::LoadFields(m_pTrackedObj, info);
+            }
+
             if (SwapHandler != nullptr)
             {
                 SwapHandler(info);
             }
+
+            if (info.Phase() == SwapPhase::BeforeSwap)
+            {
+                Layout::SaveFields(m_pTrackedObj, info);
+            }
         }
 
         std::string GetKey() override
@@ -101,6 +137,32 @@ namespace hscpp
             return CompileTimeKey().ToString();
         }
 
+        uint64_t GetLayoutFingerprint() override
+        {
+            return Layout::GetLayoutInfo<T>().fingerprint;
+        }
+
+        bool HasSwapHandler() override
+        {
+            return SwapHandler != nullptr;
+        }
+
+        uint8_t* RelocateTrackedObject(uint8_t* pFields) override
+        {
+            // Destroying the tracked object will also destroy this tracker.
+            T* pTrackedObj = m_pTrackedObj;
+
+            Layout::MoveFieldsOut(pTrackedObj, pFields);
+            pTrackedObj->~T();
+
+            return reinterpret_cast<uint8_t*>(pTrackedObj);
+        }
+
+        const void* GetModuleAddress() override
+        {
+            return &s_Register;
+        }
+
     private:
         static Register<T, CompileTimeKey> s_Register;
         T* m_pTrackedObj = nullptr;
@@ -109,6 +171,168 @@ namespace hscpp
     template <typename T, typename CompileTimeKey>
     Register<T, CompileTimeKey> Tracker<T, CompileTimeKey>::s_Register;
 
+    //============================================================================
+    // CompactTracker
+    //============================================================================
+
+    // Tracker used by HSCPP_TRACK_COMPACT. Rather than being registered individually, objects are
+    // stored in a densely packed table per type, and only hold their index into that table. The
+    // swap handler is shared by all objects of the type, and is given by defining a static member
+    // function with the signature:
+    //     static void Hscpp_SwapHandler(T* pObject, hscpp::SwapInfo& info);
+    template <typename T, typename CompileTimeKey>
+    class CompactTracker
+    {
+    public:
+        CompactTracker(const CompactTracker& rhs) = delete;
+        CompactTracker& operator=(const CompactTracker& rhs) = delete;
+
+        CompactTracker(T* pTrackedObj)
+        {
+            s_Register.ForceInitialization();
+
+            std::unique_lock<std::recursive_mutex> lock = ModuleSharedState::LockTrackers();
+            CompactTrackerTable& table = (*ModuleSharedState::s_pCompactTrackersByKey)[CompileTimeKey::hash];
+
+            CompactTrackerTable::Entry entry;
+            entry.pObject = pTrackedObj;
+            entry.piSlot = &m_iSlot;
+            entry.pOps = &s_Ops;
+
+            m_iSlot = static_cast<uint32_t>(table.entries.size());
+            table.entries.push_back(entry);
+        }
+
+        ~CompactTracker()
+        {
+            // Unregister self, by moving the last entry into this object's slot.
+            std::unique_lock<std::recursive_mutex> lock = ModuleSharedState::LockTrackers();
+            auto tableIt = ModuleSharedState::s_pCompactTrackersByKey->find(CompileTimeKey::hash);
+            if (tableIt == ModuleSharedState::s_pCompactTrackersByKey->end())
+            {
+                return;
+            }
+
+            // Objects waiting to be swapped during an incremental swap are in the pending entries.
+            if (!RemoveEntry(tableIt->second.entries))
+            {
+                RemoveEntry(tableIt->second.pendingEntries);
+            }
+        }
+
+    private:
+        class Ops : public ICompactTrackerOps
+        {
+        public:
+            uint64_t FreeTrackedObject(void* pObject) override
+            {
+                return CompactTracker::FreeTrackedObject(static_cast<T*>(pObject));
+            }
+
+            void CallSwapHandler(void* pObject, SwapInfo& info) override
+            {
+                T* pTrackedObj = static_cast<T*>(pObject);
+
+                if (info.Phase() == SwapPhase::AfterSwap)
+                {
+                    Layout::LoadFields(pTrackedObj, info);
+                }
+
+                CompactTracker::CallSwapHandler<T>(pTrackedObj, info, 0);
+
+                if (info.Phase() == SwapPhase::BeforeSwap)
+                {
+                    Layout::SaveFields(pTrackedObj, info);
+                }
+            }
+
+            uint64_t GetLayoutFingerprint() override
+            {
+                return Layout::GetLayoutInfo<T>().fingerprint;
+            }
+
+            bool HasSwapHandler() override
+            {
+                return CompactTracker::HasSwapHandler<T>(0);
+            }
+
+            uint8_t* RelocateTrackedObject(void* pObject, uint8_t* pFields) override
+            {
+                T* pTrackedObj = static_cast<T*>(pObject);
+
+                Layout::MoveFieldsOut(pTrackedObj, pFields);
+                pTrackedObj->~T();
+
+                return reinterpret_cast<uint8_t*>(pTrackedObj);
+            }
+        };
+
+        static Register<T, CompileTimeKey> s_Register;
+        static Ops s_Ops;
+
+        uint32_t m_iSlot = 0;
+
+        bool RemoveEntry(std::vector<CompactTrackerTable::Entry>& entries)
+        {
+            if (m_iSlot < entries.size() && entries.at(m_iSlot).piSlot == &m_iSlot)
+            {
+                entries.at(m_iSlot) = entries.back();
+                *entries.at(m_iSlot).piSlot = m_iSlot;
+
+                entries.pop_back();
+                return true;
+            }
+
+            return false;
+        }
+
+        static uint64_t FreeTrackedObject(T* pTrackedObj)
+        {
+            // Destroying the tracked object will also destroy the tracker it owns.
+            if (ModuleSharedState::s_pAllocator == nullptr)
+            {
+                delete pTrackedObj;
+                return 0;
+            }
+            else
+            {
+                pTrackedObj->~T();
+                return ModuleSharedState::s_pAllocator->Hscpp_FreeSwap(reinterpret_cast<uint8_t*>(pTrackedObj));
+            }
+        }
+
+        // Call T::Hscpp_SwapHandler if it exists. The int overload is preferred when both are viable.
+        template <typename U>
+        static auto CallSwapHandler(U* pTrackedObj, SwapInfo& info, int)
+            -> decltype(U::Hscpp_SwapHandler(pTrackedObj, info), void())
+        {
+            U::Hscpp_SwapHandler(pTrackedObj, info);
+        }
+
+        template <typename U>
+        static void CallSwapHandler(U*, SwapInfo&, long)
+        {}
+
+        template <typename U>
+        static auto HasSwapHandler(int)
+            -> decltype(U::Hscpp_SwapHandler(std::declval<U*>(), std::declval<SwapInfo&>()), bool())
+        {
+            return true;
+        }
+
+        template <typename U>
+        static bool HasSwapHandler(long)
+        {
+            return false;
+        }
+    };
+
+    template <typename T, typename CompileTimeKey>
+    Register<T, CompileTimeKey> CompactTracker<T, CompileTimeKey>::s_Register;
+
+    template <typename T, typename CompileTimeKey>
+    typename CompactTracker<T, CompileTimeKey>::Ops CompactTracker<T, CompileTimeKey>::s_Ops;
+
 }
 
 // Forward declare AllocationResolver.
@@ -124,6 +348,26 @@ namespace hscpp
  * as user may call HSCPP_TRACK in the private area of the class.*/ \
 friend class hscpp::AllocationResolver; \
 \
+HSCPP_CLASS_KEY(key) \
+\
+/* Create Tracker to track instance of this class. */ \
+hscpp::Tracker<type, decltype(hscpp_ClassKey)> hscpp_ClassTracker = { this };
+
+/* Track instances of this class in a per-type table, to minimize the memory used by each instance.
+ * Instances store only an index, and share a static Hscpp_SwapHandler. See CompactTracker. */
+#define HSCPP_TRACK_COMPACT(type, key) \
+friend class hscpp::AllocationResolver; \
+template <typename, typename> friend class hscpp::CompactTracker; \
+\
+HSCPP_CLASS_KEY(key) \
+\
+hscpp::CompactTracker<type, decltype(hscpp_ClassKey)> hscpp_ClassTracker = { this };
+
+#define HSCPP_CLASS_KEY(key) \
+/* Record the file declaring the class, used to decide whether the class changed on a swap. */ \
+template <typename, typename> friend class hscpp::Register; \
+static const char* Hscpp_GetClassFilePath() { return __FILE__; } \
+\
 /* Cache key length to avoid repeated calls to constexpr method slowing down compilation. This also
  * validates that the key length is <= 128 bytes. */ \
 static constexpr hscpp::compile_time::KeylenCache<hscpp::compile_time::Strlen(key)> hscpp_KeylenCache = {}; \
@@ -145,10 +389,7 @@ static constexpr hscpp::compile_time::String<
     hscpp::compile_time::StringSegmentToIntegral(key, 12, decltype(hscpp_KeylenCache)::len), \
     hscpp::compile_time::StringSegmentToIntegral(key, 13, decltype(hscpp_KeylenCache)::len), \
     hscpp::compile_time::StringSegmentToIntegral(key, 14, decltype(hscpp_KeylenCache)::len), \
-    hscpp::compile_time::StringSegmentToIntegral(key, 15, decltype(hscpp_KeylenCache)::len)> hscpp_ClassKey = {}; \
-\
-/* Create Tracker to track instance of this class. */ \
-hscpp::Tracker<type, decltype(hscpp_ClassKey)> hscpp_ClassTracker = { this };
+    hscpp::compile_time::StringSegmentToIntegral(key, 15, decltype(hscpp_KeylenCache)::len)> hscpp_ClassKey = {};
 
 #define Hscpp_SetSwapHandler(cb) \
 hscpp_ClassTracker.SwapHandler = cb;
@@ -160,6 +401,7 @@ hscpp_ClassTracker.SwapHandler = cb;
 #else
 
 #define HSCPP_TRACK(type, key)
+#define HSCPP_TRACK_COMPACT(type, key)
 #define Hscpp_SetSwapHandler(cb) (void)cb
 #define Hscpp_IsSwapping() false
 #define hscpp_virtual
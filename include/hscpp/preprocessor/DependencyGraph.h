@@ -2,9 +2,9 @@
 
 #include <vector>
 #include <string>
+#include <cstdint>
+#include <ostream>
 #include <unordered_map>
-#include <unordered_set>
-#include <functional>
 
 #include "hscpp/Platform.h"
 #include "hscpp/FsPathHasher.h"
@@ -15,52 +15,178 @@ namespace hscpp
     class DependencyGraph
     {
     public:
+        // A link in the chain explaining why a file was resolved.
+        struct Link
+        {
+            enum class Type
+            {
+                Root,       // The file being resolved.
+                Dependent,  // The file includes the previous file in the chain.
+                Dependency, // The file is included by the previous file in the chain.
+                Module,     // The file shares an hscpp_module with the previous file in the chain.
+            };
+
+            Type type = Type::Root;
+            fs::path filePath;
+            std::string module;
+        };
+
+        struct FileStats
+        {
+            fs::path filePath;
+
+            size_t nDirectDependents = 0; // Number of files that directly include this file.
+            size_t nResolvedFiles = 0; // Number of source files compiled when this file changes.
+
+            // Estimated seconds spent compiling when this file changes, based on durations passed to
+            // RecordCompileDuration. Files without a recorded duration are assumed to take the
+            // average time, so the cost is zero until durations are recorded.
+            double rebuildCost = 0;
+        };
+
         std::vector<fs::path> ResolveGraph(const fs::path& filePath);
 
+        // Resolve the graph of several files at once. The result is the union of calling ResolveGraph
+        // on each file, without duplicates.
+        std::vector<fs::path> ResolveGraph(const std::vector<fs::path>& filePaths);
+
         void SetLinkedModules(const fs::path& filePath, const std::vector<std::string>& modules);
         void SetFileDependencies(const fs::path& filePath, const std::vector<fs::path>& dependencies);
         void RemoveFile(const fs::path& filePath);
 
         void Clear();
-        
+
+        //============================================================================
+        // Introspection
+        //============================================================================
+
+        // Explain why resolvedFilePath is part of ResolveGraph(rootFilePath). On success, chain
+        // begins with rootFilePath and ends with resolvedFilePath.
+        bool Explain(const fs::path& rootFilePath, const fs::path& resolvedFilePath, std::vector<Link>& chain);
+
+        // Files not in the graph have empty stats.
+        FileStats GetFileStats(const fs::path& filePath);
+
+        // Stats of all header files in the graph, ordered by rebuild cost, then by the number of
+        // files they rebuild.
+        std::vector<FileStats> GetHeaderStats();
+
+        // Record how long a source file took to compile on its own. hscpp builds a module with a
+        // single compiler invocation and cannot time each file, so durations must come from a build
+        // that does, such as a build system's per-file timings. Durations are kept when the graph
+        // is cleared.
+        void RecordCompileDuration(const fs::path& sourceFilePath, double seconds);
+
+        void WriteJson(std::ostream& os);
+        void WriteDot(std::ostream& os);
+
     private:
+        // Edges stored in compressed sparse row form, where the edges of handle i are stored in
+        // edges[offsets[i]..offsets[i + 1]]. Since the graph changes a few files at a time, edits
+        // are stored in an overlay which replaces the edges of a handle, and are merged into the
+        // compressed arrays when the overlay grows large.
+        class Adjacency
+        {
+        public:
+            struct Range
+            {
+                const int* pBegin = nullptr;
+                const int* pEnd = nullptr;
+
+                const int* begin() const { return pBegin; }
+                const int* end() const { return pEnd; }
+            };
+
+            Range Get(int handle) const;
+
+            void Set(int handle, const std::vector<int>& edges);
+            void Add(int handle, int edge);
+            void Remove(int handle, int edge);
+
+            size_t GetOverlaySize() const;
+            void Compact(size_t nHandles);
+
+            void Clear();
+
+        private:
+            std::vector<uint32_t> m_Offsets;
+            std::vector<int> m_Edges;
+
+            std::unordered_map<int, std::vector<int>> m_OverlayEdgesByHandle;
+
+            std::vector<int>& GetOverlay(int handle);
+        };
+
         // Map integers to filepaths to avoid storing a large number of duplicated paths, and to
-        // increase the speed of lookups.
-        struct Node
+        // increase the speed of lookups. Handles are dense, so per-file data is stored in vectors
+        // indexed by handle.
+        std::unordered_map<fs::path, int, FsPathHasher> m_HandleByFilePath;
+        std::vector<fs::path> m_FilePaths;
+        std::vector<bool> m_bSourceFiles;
+        std::vector<bool> m_bInGraph; // False for removed files, and files only passed to ResolveGraph.
+
+        // Resolved graphs are cached per root handle, along with every handle whose edges or modules
+        // were read while resolving. A cached graph is invalidated when one of these handles changes.
+        struct ResolvedGraph
         {
-            std::unordered_set<int> dependencyHandles;
-            std::unordered_set<int> dependentHandles;
+            std::vector<int> resolvedHandles;
+            std::vector<int> sortedTouchedHandles;
+            uint64_t generation = 0;
         };
 
-        std::unordered_map<std::string, std::unordered_set<int>> m_HandlesByModule;
-        std::unordered_map<int, std::unordered_set<std::string>> m_ModulesByHandle;
+        // Roots whose cached graph touched a handle, stored per handle, so that a change only visits
+        // the graphs it affects. Entries of graphs invalidated through another handle are skipped by
+        // comparing generations, and pruned once they outnumber the live entries.
+        struct CachedRoot
+        {
+            int rootHandle;
+            uint64_t generation;
+        };
 
-        std::unordered_map<int, fs::path> m_FilePathByHandle;
-        std::unordered_map<fs::path, int, FsPathHasher> m_HandleByFilePath;
+        Adjacency m_Dependencies;
+        Adjacency m_Dependents;
+
+        std::unordered_map<int, ResolvedGraph> m_ResolvedGraphByHandle;
+        std::vector<std::vector<CachedRoot>> m_CachedRootsByHandle;
+        uint64_t m_ResolvedGraphGeneration = 0;
+        size_t m_nCachedTouchedHandles = 0; // Touched handles of every cached graph.
+        size_t m_nCachedRoots = 0; // Entries in m_CachedRootsByHandle, including stale entries.
+
+        // Module names are interned, so that each handle only stores the ids of its modules.
+        std::unordered_map<std::string, int> m_ModuleIdByName;
+        std::vector<std::string> m_ModuleNames;
+        std::vector<std::vector<int>> m_HandlesByModuleId;
+        std::vector<std::vector<int>> m_ModuleIdsByHandle;
 
-        std::unordered_map<int, std::unique_ptr<Node>> m_NodeByHandle;
+        std::unordered_map<fs::path, double, FsPathHasher> m_CompileDurationByFilePath;
 
-        int m_NextHandle = 0;
+        const ResolvedGraph& GetResolvedGraph(int rootHandle);
+        void Resolve(const std::vector<int>& rootHandles,
+                std::vector<int>& resolvedHandles, std::vector<int>& sortedTouchedHandles);
+        void Invalidate(const std::vector<int>& changedHandles);
+        void ClearResolvedGraphs();
+        void PruneCachedRoots();
 
-        void Collect(int handle, std::unordered_set<int>& collectedHandles, const std::function<void(Node*)>& cb);
-        void CollectDependencies(int handle, std::unordered_set<int>& collectedHandles);
-        void CollectDependents(int handle, std::unordered_set<int>& collectedHandles);
+        void Collect(const Adjacency& adjacency,
+                const std::vector<int>& rootHandles, std::vector<int>& collectedHandles);
 
         bool IsModule(int handle);
-        std::vector<int> GetLinkedModuleHandles(int handle);
-        void RemoveLinkedModule(int handle);
+        void AppendLinkedModuleHandles(int handle, std::vector<int>& linkedHandles);
+        void RemoveLinkedModules(int handle);
+        void RemoveEdges(int handle);
 
-        int CreateHandle(const fs::path& filePath);
-        int GetHandle(const fs::path& filePath);
+        void CompactIfNeeded();
 
-        Node* CreateNode(const fs::path& filePath);
-        Node* CreateNode(int handle);
-        Node* GetNode(int handle);
+        FileStats GetFileStats(int handle, double defaultCompileDuration);
+        double GetAverageCompileDuration();
 
-        fs::path GetFilepath(int handle);
+        int GetModuleId(const std::string& module);
 
-        std::unordered_set<int> AsHandleSet(const std::vector<fs::path>& paths);
+        int CreateHandle(const fs::path& filePath);
+        int GetHandle(const fs::path& filePath);
+        bool FindHandle(const fs::path& filePath, int& handle);
 
+        std::vector<int> AsHandles(const std::vector<fs::path>& paths);
     };
 
 }
\ No newline at end of file
@@ -5,6 +5,7 @@
 
 #include "hscpp/Platform.h"
 #include "hscpp/preprocessor/Variant.h"
+#include "hscpp/preprocessor/DependencyGraph.h"
 
 namespace hscpp
 {
@@ -32,6 +33,16 @@ namespace hscpp
         virtual void UpdateDependencyGraph(const std::vector<fs::path>& canonicalModifiedFiles,
                 const std::vector<fs::path>& canonicalRemovedFiles,
                 const std::vector<fs::path>& includeDirectories) = 0;
+
+        // Whether a file passed to the last call of UpdateDependencyGraph had changes other than to
+        // its comments or whitespace. Other files are assumed to have changed.
+        virtual bool HasSemanticChanges(const fs::path& canonicalFilePath) = 0;
+
+        // Called once the changes passed to UpdateDependencyGraph have been built and swapped in.
+        // Until then, files are compared against the contents of the last successful build.
+        virtual void CommitSemanticHashes() = 0;
+
+        virtual DependencyGraph* GetDependencyGraph() = 0;
     };
 
 }
\ No newline at end of file
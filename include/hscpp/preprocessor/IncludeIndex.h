@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "hscpp/Platform.h"
+
+namespace hscpp
+{
+
+    // In-memory index of the files within each include directory, used to resolve #include paths
+    // without touching the filesystem. The index is built once per set of include directories, and
+    // is then kept up to date incrementally via AddFile and RemoveFile as file events arrive.
+    class IncludeIndex
+    {
+    public:
+        void SetIncludeDirectories(const std::vector<fs::path>& includeDirectoryPaths);
+
+        void AddFile(const fs::path& canonicalFilePath);
+        void RemoveFile(const fs::path& canonicalFilePath);
+
+        void Resolve(const std::string& include, std::vector<fs::path>& canonicalIncludePaths);
+
+        void Clear();
+
+    private:
+        struct Directory
+        {
+            fs::path path;
+            fs::path canonicalPath;
+
+            // Map from a normalized path relative to the include directory, to the canonical path
+            // of the file.
+            std::unordered_map<std::string, fs::path> canonicalFilePathByRelativePath;
+        };
+
+        bool m_bIndexed = false;
+        std::vector<Directory> m_Directories;
+
+        // Includes that did not resolve to a file in any include directory (ex. <vector>). These
+        // are removed when a matching file is added.
+        std::unordered_set<std::string> m_UnresolvedIncludes;
+
+        void Index(Directory& directory);
+        bool GetRelativePath(const Directory& directory, const fs::path& canonicalFilePath, std::string& relativePath);
+
+        static bool IsOutsideDirectory(const fs::path& normalizedRelativePath);
+        std::string Normalize(const fs::path& path);
+    };
+
+}
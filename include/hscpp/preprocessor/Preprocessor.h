@@ -1,9 +1,13 @@
 #pragma once
 
 #include <unordered_set>
+#include <unordered_map>
+#include <memory>
 
 #include "hscpp/preprocessor/IPreprocessor.h"
 #include "hscpp/preprocessor/DependencyGraph.h"
+#include "hscpp/preprocessor/IncludeIndex.h"
+#include "hscpp/preprocessor/SemanticHasher.h"
 #include "hscpp/preprocessor/VarStore.h"
 #include "hscpp/preprocessor/Token.h"
 #include "hscpp/preprocessor/Lexer.h"
@@ -29,16 +33,47 @@ namespace hscpp
                 const std::vector<fs::path>& canonicalRemovedFilePaths,
                 const std::vector<fs::path>& includeDirectoryPaths) override;
 
+        bool HasSemanticChanges(const fs::path& canonicalFilePath) override;
+        void CommitSemanticHashes() override;
+        DependencyGraph* GetDependencyGraph() override;
+
     private:
-        std::vector<Token> m_Tokens;
+        // Files within a round are independent, so each is processed on a worker thread. Each worker
+        // owns its own Lexer, Parser and Interpreter, while the VarStore is shared read-only.
+        struct Worker
+        {
+            std::vector<Token> tokens;
+
+            Lexer lexer;
+            Parser parser;
+            Interpreter interpreter;
+            SemanticHasher semanticHasher;
+        };
+
+        struct FileResult
+        {
+            bool bSuccess = false;
+            Interpreter::Result result;
+            uint64_t semanticHash = 0;
 
-        Lexer m_Lexer;
-        Parser m_Parser;
-        Interpreter m_Interpreter;
+            // Logged by the calling thread once all workers have joined, so that messages from
+            // different workers do not interleave.
+            std::vector<std::string> errors;
+        };
+
+        std::vector<std::unique_ptr<Worker>> m_Workers;
 
         DependencyGraph m_DependencyGraph;
+        IncludeIndex m_IncludeIndex;
         VarStore m_VarStore;
 
+        // Hash of each file's contents, ignoring comments and whitespace. Headers whose hash did not
+        // change in the last call to UpdateDependencyGraph do not cause their dependents to be
+        // recompiled.
+        std::unordered_map<fs::path, uint64_t, FsPathHasher> m_SemanticHashByFilePath;
+        std::unordered_map<fs::path, uint64_t, FsPathHasher> m_PendingSemanticHashByFilePath;
+        std::unordered_set<fs::path, FsPathHasher> m_SemanticallyUnchangedFilePaths;
+
         std::unordered_set<fs::path, FsPathHasher> m_SourceFilePaths;
         std::unordered_set<fs::path, FsPathHasher> m_IncludeDirectoryPaths;
         std::unordered_set<fs::path, FsPathHasher> m_LibraryPaths;
@@ -51,7 +86,8 @@ namespace hscpp
         void AddDependentFilePaths(std::unordered_set<fs::path, FsPathHasher>& filePaths);
 
         bool Preprocess(const std::unordered_set<fs::path, FsPathHasher>& filePaths);
-        bool Process(const fs::path& filePath, Interpreter::Result& result);
+        void ProcessAll(const std::vector<fs::path>& filePaths, std::vector<FileResult>& fileResults);
+        bool Process(const fs::path& filePath, Worker& worker, FileResult& fileResult);
 
         bool AddHscppRequire(const fs::path& sourceFilePath, const HscppRequire& hscppRequire);
     };
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+namespace hscpp
+{
+
+    // Hashes the content of a source file, ignoring comments and formatting. Runs of whitespace and
+    // comments are reduced to a single separator, which is a newline if the run spanned multiple lines.
+    // This keeps the structure of preprocessor directives, while ignoring reindentation, blank lines
+    // and comment edits. String and character literals are hashed verbatim.
+    class SemanticHasher
+    {
+    public:
+        uint64_t Hash(const std::string& content);
+
+    private:
+        const std::string* m_pContent = nullptr;
+        size_t m_iChar = 0;
+
+        uint64_t m_Hash = 0;
+        char m_PendingSeparator = 0;
+        bool m_bHashedChar = false;
+
+        void Reset(const std::string& content);
+
+        void SkipLineComment();
+        void SkipBlockComment();
+
+        void HashLiteral(char endChar);
+        bool HashRawString();
+
+        bool IsDigitSeparator();
+        std::string GetPrecedingIdentifier();
+
+        void HashChar(char c);
+        void AddSeparator(char separator);
+
+        bool IsAtEnd();
+        char Peek();
+        char PeekNext();
+    };
+
+}
\ No newline at end of file
@@ -20,6 +20,11 @@ namespace hscpp
         return &m_AllocationResolver;
     }
 
+    DependencyGraph* Hotswapper::GetDependencyGraph()
+    {
+        return nullptr;
+    }
+
     void Hotswapper::SetAllocator(IAllocator* pAllocator)
     {
         m_ModuleManager.SetAllocator(pAllocator);
@@ -54,6 +59,24 @@ namespace hscpp
         return false;
     }
 
+    bool Hotswapper::IsSwapping()
+    {
+        return false;
+    }
+
+    void Hotswapper::LogPinnedModules()
+    {}
+
+    bool Hotswapper::SaveSnapshot(const fs::path&)
+    {
+        return false;
+    }
+
+    bool Hotswapper::RestoreSnapshot(const fs::path&)
+    {
+        return false;
+    }
+
     bool Hotswapper::IsCompilerInitialized()
     {
         // Return true, so that if user waits on compiler initialization, it will immediately succeed
@@ -4,6 +4,8 @@
 #include <chrono>
 #include <assert.h>
 #include <functional>
+#include <memory>
+#include <limits>
 
 #include "hscpp/Hotswapper.h"
 #include "hscpp/Log.h"
@@ -92,6 +94,11 @@ namespace hscpp
         return &m_AllocationResolver;
     }
 
+    DependencyGraph* Hotswapper::GetDependencyGraph()
+    {
+        return m_pPreprocessor->GetDependencyGraph();
+    }
+
     void Hotswapper::SetAllocator(IAllocator* pAllocator)
     {
         m_ModuleManager.SetAllocator(pAllocator);
@@ -119,11 +126,25 @@ namespace hscpp
 
     void Hotswapper::TriggerManualBuild()
     {
+        // Finish any pending swap, so that the new module is swapped over a consistent state.
+        if (m_LoadingModule.valid())
+        {
+            PerformRuntimeSwap(m_LoadingModule.get());
+        }
+
+        if (m_ModuleManager.IsSwapping())
+        {
+            m_ModuleManager.ContinueIncrementalRuntimeSwap(
+                std::chrono::microseconds(0), (std::numeric_limits<size_t>::max)());
+            FinishRuntimeSwap(true);
+        }
+
         if (CreateBuildDirectory())
         {
             ICompiler::Input compilerInput;
             if (CreateCompilerInput({}, compilerInput))
             {
+                m_bCompilingFileChanges = false;
                 if (StartCompile(compilerInput))
                 {
                     while (m_pCompiler->IsCompiling())
@@ -134,7 +155,7 @@ namespace hscpp
 
                     if (m_pCompiler->HasCompiledModule())
                     {
-                        PerformRuntimeSwap();
+                        PerformRuntimeSwap(ModuleManager::LoadModule(m_pCompiler->PopModule()));
                     }
                 }
             }
@@ -148,6 +169,22 @@ namespace hscpp
             RefreshDependencyGraph();
         }
 
+        if (m_LoadingModule.valid())
+        {
+            if (m_LoadingModule.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            {
+                return UpdateResult::LoadingModule;
+            }
+
+            return PerformRuntimeSwap(m_LoadingModule.get());
+        }
+
+        if (m_ModuleManager.IsSwapping())
+        {
+            // Let file changes queue up until every instance has been swapped.
+            return ContinueRuntimeSwap();
+        }
+
         m_pCompiler->Update();
         if (m_pCompiler->IsCompiling())
         {
@@ -158,14 +195,8 @@ namespace hscpp
 
         if (m_pCompiler->HasCompiledModule())
         {
-            if (PerformRuntimeSwap())
-            {
-                return UpdateResult::PerformedSwap;
-            }
-            else
-            {
-                return UpdateResult::FailedSwap;
-            }
+            StartLoadingModule();
+            return UpdateResult::LoadingModule;
         }
 
         if (!IsFeatureEnabled(Feature::ManualCompilationOnly))
@@ -183,11 +214,20 @@ namespace hscpp
                 util::SortFileEvents(m_FileEvents, canonicalModifiedFilePaths, canonicalRemovedFilePaths);
                 UpdateDependencyGraph(canonicalModifiedFilePaths, canonicalRemovedFilePaths);
 
+                for (const auto& filePath : canonicalModifiedFilePaths)
+                {
+                    if (m_pPreprocessor->HasSemanticChanges(filePath))
+                    {
+                        m_ChangedFilePaths.insert(filePath);
+                    }
+                }
+
                 if (!canonicalModifiedFilePaths.empty())
                 {
                     ICompiler::Input compilerInput;
                     if (CreateCompilerInput(canonicalModifiedFilePaths, compilerInput))
                     {
+                        m_bCompilingFileChanges = true;
                         if (StartCompile(compilerInput))
                         {
                             return UpdateResult::StartedCompiling;
@@ -205,6 +245,31 @@ namespace hscpp
         return m_pCompiler->IsCompiling();
     }
 
+    bool Hotswapper::IsSwapping()
+    {
+        return m_ModuleManager.IsSwapping();
+    }
+
+    void Hotswapper::LogPinnedModules()
+    {
+        for (const auto& report : m_ModuleManager.GetPinnedModules())
+        {
+            log::Info() << HSCPP_LOG_PREFIX << "Module " << report.modulePath << " is pinned by "
+                << report.nConstructors << " constructors and " << report.nInstances << " instances."
+                << log::End();
+        }
+    }
+
+    bool Hotswapper::SaveSnapshot(const fs::path& filePath)
+    {
+        return m_ModuleManager.SaveSnapshot(filePath);
+    }
+
+    bool Hotswapper::RestoreSnapshot(const fs::path& filePath)
+    {
+        return m_ModuleManager.RestoreSnapshot(filePath);
+    }
+
     bool Hotswapper::IsCompilerInitialized()
     {
         return m_pCompiler->IsInitialized();
@@ -551,21 +616,111 @@ namespace hscpp
         util::Deduplicate(input.linkOptions);
     }
 
-    bool Hotswapper::PerformRuntimeSwap()
+    void Hotswapper::StartLoadingModule()
+    {
+        // Loading runs the module's static initializers and processes its relocations, which can
+        // take a while for large modules. This only touches the new module's state, so it can be
+        // done off the main thread, leaving the main thread to patch constructors and swap.
+        m_LoadingModule = std::async(std::launch::async, &ModuleManager::LoadModule, m_pCompiler->PopModule());
+    }
+
+    Hotswapper::UpdateResult Hotswapper::PerformRuntimeSwap(const ModuleManager::LoadedModule& module)
     {
         if (m_Callbacks.BeforeSwap != nullptr)
         {
             m_Callbacks.BeforeSwap();
         }
 
-        bool bResult = m_ModuleManager.PerformRuntimeSwap(m_pCompiler->PopModule());
+        if (m_pConfig->runtimeSwap.budget.count() > 0)
+        {
+            if (!m_ModuleManager.BeginIncrementalRuntimeSwap(module, CreateIsClassUnchangedCb()))
+            {
+                return FinishRuntimeSwap(false);
+            }
+
+            return ContinueRuntimeSwap();
+        }
+
+        return FinishRuntimeSwap(m_ModuleManager.PerformRuntimeSwap(module, CreateIsClassUnchangedCb()));
+    }
+
+    Hotswapper::UpdateResult Hotswapper::ContinueRuntimeSwap()
+    {
+        if (!m_ModuleManager.ContinueIncrementalRuntimeSwap(
+            m_pConfig->runtimeSwap.budget, m_pConfig->runtimeSwap.batchSize))
+        {
+            return UpdateResult::Swapping;
+        }
+
+        return FinishRuntimeSwap(true);
+    }
+
+    Hotswapper::UpdateResult Hotswapper::FinishRuntimeSwap(bool bResult)
+    {
+        if (bResult)
+        {
+            // File changes are not processed while compiling, so every change is in this module.
+            m_ChangedFilePaths.clear();
+            m_pPreprocessor->CommitSemanticHashes();
+        }
+
+        if (IsFeatureEnabled(Feature::UnloadModules))
+        {
+            m_ModuleManager.UnloadUnusedModules();
+        }
 
         if (m_Callbacks.AfterSwap != nullptr)
         {
             m_Callbacks.AfterSwap();
         }
 
-        return bResult;
+        return bResult ? UpdateResult::PerformedSwap : UpdateResult::FailedSwap;
+    }
+
+    std::function<bool(const fs::path&)> Hotswapper::CreateIsClassUnchangedCb()
+    {
+        if (!IsFeatureEnabled(Feature::SkipUnchangedTypes)
+            || !IsFeatureEnabled(Feature::DependentCompilation)
+            || !m_bCompilingFileChanges)
+        {
+            return nullptr;
+        }
+
+        DependencyGraph* pDependencyGraph = m_pPreprocessor->GetDependencyGraph();
+        if (pDependencyGraph == nullptr)
+        {
+            return nullptr;
+        }
+
+        // A class's code can only be in files that include the file declaring it. Collect the
+        // changed files, and every file compiled because of them.
+        std::vector<fs::path> changedFilePaths(m_ChangedFilePaths.begin(), m_ChangedFilePaths.end());
+        std::vector<fs::path> dependentFilePaths = pDependencyGraph->ResolveGraph(changedFilePaths);
+
+        auto pDirtyFilePaths = std::make_shared<std::unordered_set<fs::path, FsPathHasher>>(
+                m_ChangedFilePaths.begin(), m_ChangedFilePaths.end());
+        pDirtyFilePaths->insert(dependentFilePaths.begin(), dependentFilePaths.end());
+
+        return [pDependencyGraph, pDirtyFilePaths](const fs::path& classFilePath) {
+            std::error_code error;
+            fs::path canonicalClassFilePath = fs::canonical(classFilePath, error);
+
+            if (error.value() != HSCPP_ERROR_SUCCESS
+                || pDirtyFilePaths->find(canonicalClassFilePath) != pDirtyFilePaths->end())
+            {
+                return false;
+            }
+
+            for (const auto& filePath : pDependencyGraph->ResolveGraph(canonicalClassFilePath))
+            {
+                if (pDirtyFilePaths->find(filePath) != pDirtyFilePaths->end())
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        };
     }
 
     bool Hotswapper::CreateHscppTempDirectory()
@@ -1,16 +1,32 @@
 #include "hscpp/ModuleManager.h"
 #include "hscpp/Log.h"
+#include "hscpp/Snapshot.h"
 #include "hscpp/Util.h"
 #include "hscpp/module/ModuleInterface.h"
+#include "hscpp/module/CompileTimeString.h"
 
 hscpp::ModuleManager::ModuleManager()
 {
     Hscpp_GetModuleInterface()->SetIsSwapping(&m_bSwapping);
     Hscpp_GetModuleInterface()->SetTrackersByKey(&m_TrackersByKey);
+    Hscpp_GetModuleInterface()->SetCompactTrackersByKey(&m_CompactTrackersByKey);
+    Hscpp_GetModuleInterface()->SetTrackerMutex(&m_TrackerMutex);
     Hscpp_GetModuleInterface()->SetConstructorsByKey(&m_ConstructorsByKey);
+    Hscpp_GetModuleInterface()->SetConstructorsGeneration(&m_ConstructorsGeneration);
 
     m_ConstructorsByKey = Hscpp_GetModuleInterface()->GetModuleConstructorsByKey();
+    UpdateConstructorsGeneration();
     WarnDuplicateKeys(Hscpp_GetModuleInterface());
+    DetectKeyCollisions(Hscpp_GetModuleInterface());
+}
+
+hscpp::ModuleManager::~ModuleManager()
+{
+    // Tracked objects may outlive this ModuleManager, and must not lock a destroyed mutex.
+    if (ModuleSharedState::s_pTrackerMutex == &m_TrackerMutex)
+    {
+        Hscpp_GetModuleInterface()->SetTrackerMutex(nullptr);
+    }
 }
 
 void hscpp::ModuleManager::SetAllocator(IAllocator* pAllocator)
@@ -25,44 +41,369 @@ void hscpp::ModuleManager::SetGlobalUserData(void* pGlobalUserData)
     Hscpp_GetModuleInterface()->SetGlobalUserData(m_pGlobalUserData);
 }
 
-bool hscpp::ModuleManager::PerformRuntimeSwap(const fs::path& modulePath)
+hscpp::ModuleManager::LoadedModule hscpp::ModuleManager::LoadModule(const fs::path& modulePath)
 {
-    void* pModule = platform::LoadModule(modulePath);
-    if (pModule == nullptr)
+    LoadedModule module;
+    module.modulePath = modulePath;
+    module.pModule = platform::LoadModule(modulePath);
+
+    if (module.pModule == nullptr)
+    {
+        // Error state is per-thread, so it must be read on the loading thread.
+        module.error = platform::GetLastErrorString();
+    }
+
+    return module;
+}
+
+bool hscpp::ModuleManager::PerformRuntimeSwap(const fs::path& modulePath,
+        const std::function<bool(const fs::path& classFilePath)>& isClassUnchangedCb)
+{
+    return PerformRuntimeSwap(LoadModule(modulePath), isClassUnchangedCb);
+}
+
+bool hscpp::ModuleManager::PerformRuntimeSwap(const LoadedModule& module,
+        const std::function<bool(const fs::path& classFilePath)>& isClassUnchangedCb)
+{
+    if (m_pSwappingModuleInterface != nullptr)
+    {
+        log::Error() << HSCPP_LOG_PREFIX << "Cannot swap module " << module.modulePath
+            << " while an incremental swap is in progress." << log::End();
+        return false;
+    }
+
+    ModuleInterface* pModuleInterface = GetModuleInterface(module);
+    if (pModuleInterface == nullptr)
+    {
+        return false;
+    }
+
+    std::unordered_set<uint64_t> unchangedKeyHashes = GetUnchangedKeyHashes(pModuleInterface, isClassUnchangedCb);
+
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_TrackerMutex);
+
+        pModuleInterface->PerformRuntimeSwap(unchangedKeyHashes);
+        UpdateConstructorsGeneration();
+    }
+
+    WarnDuplicateKeys(pModuleInterface);
+
+    log::Build() << HSCPP_LOG_PREFIX << "Successfully performed runtime swap." << log::End();
+
+    return true;
+}
+
+bool hscpp::ModuleManager::BeginIncrementalRuntimeSwap(const fs::path& modulePath,
+        const std::function<bool(const fs::path& classFilePath)>& isClassUnchangedCb)
+{
+    return BeginIncrementalRuntimeSwap(LoadModule(modulePath), isClassUnchangedCb);
+}
+
+bool hscpp::ModuleManager::BeginIncrementalRuntimeSwap(const LoadedModule& module,
+        const std::function<bool(const fs::path& classFilePath)>& isClassUnchangedCb)
+{
+    if (m_pSwappingModuleInterface != nullptr)
+    {
+        log::Error() << HSCPP_LOG_PREFIX << "Cannot swap module " << module.modulePath
+            << " while an incremental swap is in progress." << log::End();
+        return false;
+    }
+
+    ModuleInterface* pModuleInterface = GetModuleInterface(module);
+    if (pModuleInterface == nullptr)
     {
-        log::Error() << HSCPP_LOG_PREFIX << "Failed to load module "
-             << modulePath << ". " << log::LastOsError() << log::End();
         return false;
     }
 
+    std::unordered_set<uint64_t> unchangedKeyHashes = GetUnchangedKeyHashes(pModuleInterface, isClassUnchangedCb);
+
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_TrackerMutex);
+
+        pModuleInterface->BeginIncrementalRuntimeSwap(unchangedKeyHashes, m_PendingTrackersByKey);
+        UpdateConstructorsGeneration();
+    }
+
+    WarnDuplicateKeys(pModuleInterface);
+
+    m_pSwappingModuleInterface = pModuleInterface;
+    return true;
+}
+
+bool hscpp::ModuleManager::ContinueIncrementalRuntimeSwap(std::chrono::microseconds budget, size_t batchSize)
+{
+    if (m_pSwappingModuleInterface == nullptr)
+    {
+        return true;
+    }
+
+    std::lock_guard<std::recursive_mutex> lock(m_TrackerMutex);
+
+    auto startTime = std::chrono::steady_clock::now();
+
+    size_t nRemaining = 0;
+    do
+    {
+        nRemaining = m_pSwappingModuleInterface->PerformRuntimeSwapBatch(m_PendingTrackersByKey, batchSize);
+    } while (nRemaining > 0 && std::chrono::steady_clock::now() - startTime < budget);
+
+    if (nRemaining > 0)
+    {
+        return false;
+    }
+
+    m_PendingTrackersByKey.clear();
+    m_pSwappingModuleInterface = nullptr;
+    m_bSwapping = false;
+
+    log::Build() << HSCPP_LOG_PREFIX << "Successfully performed runtime swap." << log::End();
+
+    return true;
+}
+
+bool hscpp::ModuleManager::IsSwapping()
+{
+    return m_pSwappingModuleInterface != nullptr;
+}
+
+size_t hscpp::ModuleManager::UnloadUnusedModules()
+{
+    if (IsSwapping())
+    {
+        return 0;
+    }
+
+    std::lock_guard<std::recursive_mutex> lock(m_TrackerMutex);
+
+    std::vector<ModuleReport> reports = CountModuleReferences();
+
+    size_t nUnloaded = 0;
+    for (size_t i = m_Modules.size(); i-- > 0;)
+    {
+        if (reports.at(i).nConstructors > 0 || reports.at(i).nInstances > 0)
+        {
+            continue;
+        }
+
+        if (!platform::UnloadModule(m_Modules.at(i).pModule))
+        {
+            log::Warning() << HSCPP_LOG_PREFIX << "Failed to unload module "
+                << m_Modules.at(i).modulePath << ". " << log::LastOsError() << log::End();
+        }
+
+        m_Modules.erase(m_Modules.begin() + i);
+        ++nUnloaded;
+    }
+
+    if (nUnloaded > 0)
+    {
+        log::Info() << HSCPP_LOG_PREFIX << "Unloaded " << nUnloaded << " unused modules." << log::End();
+    }
+
+    return nUnloaded;
+}
+
+bool hscpp::ModuleManager::SaveSnapshot(const fs::path& filePath)
+{
+    if (IsSwapping())
+    {
+        log::Error() << HSCPP_LOG_PREFIX << "Cannot save snapshot while an incremental swap is in progress."
+            << log::End();
+        return false;
+    }
+
+    std::lock_guard<std::recursive_mutex> lock(m_TrackerMutex);
+    return Snapshot::Save(Hscpp_GetModuleInterface(), filePath);
+}
+
+bool hscpp::ModuleManager::RestoreSnapshot(const fs::path& filePath)
+{
+    if (IsSwapping())
+    {
+        log::Error() << HSCPP_LOG_PREFIX << "Cannot restore snapshot while an incremental swap is in progress."
+            << log::End();
+        return false;
+    }
+
+    std::lock_guard<std::recursive_mutex> lock(m_TrackerMutex);
+    return Snapshot::Restore(Hscpp_GetModuleInterface(), filePath);
+}
+
+std::vector<hscpp::ModuleManager::ModuleReport> hscpp::ModuleManager::GetPinnedModules()
+{
+    std::lock_guard<std::recursive_mutex> lock(m_TrackerMutex);
+
+    std::vector<ModuleReport> pinnedModules;
+    for (const auto& report : CountModuleReferences())
+    {
+        if (report.nConstructors > 0 || report.nInstances > 0)
+        {
+            pinnedModules.push_back(report);
+        }
+    }
+
+    return pinnedModules;
+}
+
+hscpp::ModuleInterface* hscpp::ModuleManager::GetModuleInterface(const LoadedModule& module)
+{
+    if (module.pModule == nullptr)
+    {
+        log::Error() << HSCPP_LOG_PREFIX << "Failed to load module "
+             << module.modulePath << ". [" << module.error << "]" << log::End();
+        return nullptr;
+    }
+
+    // Record the module even if the swap fails, so that it can be unloaded once unused.
+    Module loadedModule;
+    loadedModule.modulePath = module.modulePath;
+    loadedModule.pModule = module.pModule;
+    m_Modules.push_back(loadedModule);
+
     auto GetModuleInterface = platform::GetModuleFunction<ModuleInterface*()>(
-            pModule, "Hscpp_GetModuleInterface");
+            module.pModule, "Hscpp_GetModuleInterface");
     if (GetModuleInterface == nullptr)
     {
         log::Error() << HSCPP_LOG_PREFIX << "Failed to load Hscpp_GetModuleInterface procedure. "
             << log::LastOsError() << log::End();
-        return false;
+        return nullptr;
     }
 
     ModuleInterface* pModuleInterface = GetModuleInterface();
     if (pModuleInterface == nullptr)
     {
         log::Error() << HSCPP_LOG_PREFIX << "Failed to get pointer to module interface." << log::End();
-        return false;
+        return nullptr;
+    }
+
+    m_Modules.back().pBase = platform::GetModuleBase(pModuleInterface);
+
+    // Registries are keyed by hash, so a colliding key would swap objects of the wrong type.
+    if (!DetectKeyCollisions(pModuleInterface))
+    {
+        log::Error() << HSCPP_LOG_PREFIX << "Runtime swap will be skipped." << log::End();
+        return nullptr;
     }
 
     pModuleInterface->SetIsSwapping(&m_bSwapping);
     pModuleInterface->SetTrackersByKey(&m_TrackersByKey);
+    pModuleInterface->SetCompactTrackersByKey(&m_CompactTrackersByKey);
+    pModuleInterface->SetTrackerMutex(&m_TrackerMutex);
     pModuleInterface->SetConstructorsByKey(&m_ConstructorsByKey);
+    pModuleInterface->SetConstructorsGeneration(&m_ConstructorsGeneration);
     pModuleInterface->SetAllocator(m_pAllocator);
     pModuleInterface->SetGlobalUserData(m_pGlobalUserData);
-    pModuleInterface->PerformRuntimeSwap();
 
-    WarnDuplicateKeys(pModuleInterface);
+    return pModuleInterface;
+}
 
-    log::Build() << HSCPP_LOG_PREFIX << "Successfully performed runtime swap." << log::End();
+std::unordered_set<uint64_t> hscpp::ModuleManager::GetUnchangedKeyHashes(ModuleInterface* pModuleInterface,
+        const std::function<bool(const fs::path& classFilePath)>& isClassUnchangedCb)
+{
+    std::unordered_set<uint64_t> unchangedKeyHashes;
+    if (isClassUnchangedCb != nullptr)
+    {
+        for (const auto& keyHash__filePath : pModuleInterface->GetClassFilePathsByKey())
+        {
+            if (!keyHash__filePath.second.empty() && isClassUnchangedCb(keyHash__filePath.second))
+            {
+                unchangedKeyHashes.insert(keyHash__filePath.first);
+            }
+        }
 
-    return true;
+        if (!unchangedKeyHashes.empty())
+        {
+            log::Info() << HSCPP_LOG_PREFIX << "Skipping swap of " << unchangedKeyHashes.size()
+                << " unchanged classes." << log::End();
+        }
+    }
+
+    return unchangedKeyHashes;
+}
+
+std::vector<hscpp::ModuleManager::ModuleReport> hscpp::ModuleManager::CountModuleReferences()
+{
+    std::vector<ModuleReport> reports(m_Modules.size());
+
+    std::unordered_map<void*, ModuleReport*> reportsByBase;
+    for (size_t i = 0; i < m_Modules.size(); ++i)
+    {
+        reports.at(i).modulePath = m_Modules.at(i).modulePath;
+        if (m_Modules.at(i).pBase != nullptr)
+        {
+            reportsByBase[m_Modules.at(i).pBase] = &reports.at(i);
+        }
+    }
+
+    // Looking up a module by address is slow, but every instance of a type constructed by the same
+    // module returns the same module address.
+    std::unordered_map<const void*, ModuleReport*> reportsByAddress;
+    auto GetReport = [&](const void* pAddress) -> ModuleReport* {
+        auto reportIt = reportsByAddress.find(pAddress);
+        if (reportIt != reportsByAddress.end())
+        {
+            return reportIt->second;
+        }
+
+        ModuleReport* pReport = nullptr;
+
+        auto baseIt = reportsByBase.find(platform::GetModuleBase(pAddress));
+        if (baseIt != reportsByBase.end())
+        {
+            pReport = baseIt->second;
+        }
+
+        reportsByAddress[pAddress] = pReport;
+        return pReport;
+    };
+
+    for (const auto& keyHash__pConstructor : m_ConstructorsByKey)
+    {
+        if (ModuleReport* pReport = GetReport(keyHash__pConstructor.second->GetModuleAddress()))
+        {
+            ++pReport->nConstructors;
+        }
+    }
+
+    for (const auto* pTrackersByKey : { &m_TrackersByKey, &m_PendingTrackersByKey })
+    {
+        for (const auto& keyHash__trackers : *pTrackersByKey)
+        {
+            for (ITracker* pTracker : keyHash__trackers.second)
+            {
+                if (ModuleReport* pReport = GetReport(pTracker->GetModuleAddress()))
+                {
+                    ++pReport->nInstances;
+                }
+            }
+        }
+    }
+
+    // Compact objects are destroyed through the ops of the module that constructed them.
+    for (const auto& keyHash__table : m_CompactTrackersByKey)
+    {
+        for (const auto* pEntries : { &keyHash__table.second.entries, &keyHash__table.second.pendingEntries })
+        {
+            for (const auto& entry : *pEntries)
+            {
+                if (ModuleReport* pReport = GetReport(entry.pOps))
+                {
+                    ++pReport->nInstances;
+                }
+            }
+        }
+    }
+
+    return reports;
+}
+
+void hscpp::ModuleManager::UpdateConstructorsGeneration()
+{
+    // Generations are unique across ModuleManagers, so that constructors cached while one
+    // ModuleManager was active are never used with another.
+    static uint64_t s_LastConstructorsGeneration = 0;
+    m_ConstructorsGeneration = ++s_LastConstructorsGeneration;
 }
 
 void hscpp::ModuleManager::WarnDuplicateKeys(ModuleInterface* pModuleInterface)
@@ -74,3 +415,41 @@ void hscpp::ModuleManager::WarnDuplicateKeys(ModuleInterface* pModuleInterface)
             << duplicate.key << ", type=" << duplicate.type << log::End(").");
     }
 }
+
+bool hscpp::ModuleManager::DetectKeyCollisions(ModuleInterface* pModuleInterface)
+{
+    bool bSuccess = true;
+
+    for (const auto& collision : pModuleInterface->GetKeyCollisions())
+    {
+        log::Error() << HSCPP_LOG_PREFIX << "HSCPP_TRACK keys " << util::Quote(collision.key)
+            << " and " << util::Quote(collision.otherKey) << " have the same hash. Rename one of the keys."
+            << log::End();
+        bSuccess = false;
+    }
+
+    std::vector<std::string> keys = pModuleInterface->GetKeys();
+    for (const auto& key : keys)
+    {
+        uint64_t keyHash = compile_time::HashKey(key.c_str());
+
+        auto keyIt = m_KeysByHash.find(keyHash);
+        if (keyIt != m_KeysByHash.end() && keyIt->second != key)
+        {
+            log::Error() << HSCPP_LOG_PREFIX << "HSCPP_TRACK keys " << util::Quote(key)
+                << " and " << util::Quote(keyIt->second) << " have the same hash. Rename one of the keys."
+                << log::End();
+            bSuccess = false;
+        }
+    }
+
+    if (bSuccess)
+    {
+        for (const auto& key : keys)
+        {
+            m_KeysByHash[compile_time::HashKey(key.c_str())] = key;
+        }
+    }
+
+    return bSuccess;
+}
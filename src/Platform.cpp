@@ -8,6 +8,10 @@
     #include <Windows.h>
 #elif defined(HSCPP_PLATFORM_UNIX)
     #include <uuid/uuid.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
 #endif
 
 // Add includes for platform-specific hscpp classes.
@@ -318,4 +322,123 @@ namespace hscpp { namespace platform
 #endif
     }
 
+    bool UnloadModule(void* pModule)
+    {
+#if defined(HSCPP_PLATFORM_WIN32)
+        return FreeLibrary(static_cast<HMODULE>(pModule)) != 0;
+#elif defined(HSCPP_PLATFORM_UNIX)
+        return dlclose(pModule) == 0;
+#else
+        static_assert(false, "Unsupported platform.");
+        return false;
+#endif
+    }
+
+    void* GetModuleBase(const void* pAddress)
+    {
+#if defined(HSCPP_PLATFORM_WIN32)
+        HMODULE hModule = nullptr;
+        if (!GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+            static_cast<LPCWSTR>(pAddress), &hModule))
+        {
+            return nullptr;
+        }
+
+        // An HMODULE is the base address of the module.
+        return hModule;
+#elif defined(HSCPP_PLATFORM_UNIX)
+        Dl_info info;
+        if (dladdr(pAddress, &info) == 0)
+        {
+            return nullptr;
+        }
+
+        return info.dli_fbase;
+#else
+        static_assert(false, "Unsupported platform.");
+        return nullptr;
+#endif
+    }
+
+    const uint8_t* MapFile(const fs::path& filePath, size_t& size)
+    {
+        size = 0;
+
+#if defined(HSCPP_PLATFORM_WIN32)
+        HANDLE hFile = CreateFileW(filePath.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ,
+            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (hFile == INVALID_HANDLE_VALUE)
+        {
+            return nullptr;
+        }
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(hFile, &fileSize) || fileSize.QuadPart == 0)
+        {
+            CloseHandle(hFile);
+            return nullptr;
+        }
+
+        HANDLE hMapping = CreateFileMappingW(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(hFile);
+
+        if (hMapping == nullptr)
+        {
+            return nullptr;
+        }
+
+        // The view keeps the mapping alive after its handle is closed.
+        void* pMemory = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(hMapping);
+
+        if (pMemory == nullptr)
+        {
+            return nullptr;
+        }
+
+        size = static_cast<size_t>(fileSize.QuadPart);
+        return static_cast<const uint8_t*>(pMemory);
+#elif defined(HSCPP_PLATFORM_UNIX)
+        int fd = open(filePath.string().c_str(), O_RDONLY);
+        if (fd == -1)
+        {
+            return nullptr;
+        }
+
+        struct stat fileStat;
+        if (fstat(fd, &fileStat) == -1 || fileStat.st_size == 0)
+        {
+            close(fd);
+            return nullptr;
+        }
+
+        void* pMemory = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+
+        if (pMemory == MAP_FAILED)
+        {
+            return nullptr;
+        }
+
+        size = static_cast<size_t>(fileStat.st_size);
+        return static_cast<const uint8_t*>(pMemory);
+#else
+        static_assert(false, "Unsupported platform.");
+        return nullptr;
+#endif
+    }
+
+    bool UnmapFile(const uint8_t* pMemory, size_t size)
+    {
+#if defined(HSCPP_PLATFORM_WIN32)
+        HSCPP_UNUSED_PARAM(size);
+        return UnmapViewOfFile(pMemory) != 0;
+#elif defined(HSCPP_PLATFORM_UNIX)
+        return munmap(const_cast<uint8_t*>(pMemory), size) == 0;
+#else
+        static_assert(false, "Unsupported platform.");
+        return false;
+#endif
+    }
+
 }}
\ No newline at end of file
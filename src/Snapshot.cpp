@@ -0,0 +1,255 @@
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+#include "hscpp/Snapshot.h"
+#include "hscpp/Log.h"
+
+namespace hscpp
+{
+
+    const char Snapshot::MAGIC[8] = { 'H', 'S', 'C', 'P', 'P', 'S', 'N', 'P' };
+
+    // File layout, in native byte order:
+    //     Header: magic[8], uint32 version, uint32 reserved, uint64 nObjects.
+    //     Object: uint64 keyHash, uint32 nItems, uint32 reserved, followed by nItems items.
+    //     Item:   uint64 nameHash, uint64 typeHash, uint64 size, followed by the value padded to ALIGNMENT.
+    struct SnapshotItem
+    {
+        uint64_t nameHash = 0;
+        uint64_t typeHash = 0;
+        uint64_t size = 0;
+    };
+
+    // Object read from a snapshot, whose items are stored contiguously from iFirstItem.
+    struct SnapshotObject
+    {
+        uint64_t keyHash = 0;
+        size_t iFirstItem = 0;
+        size_t nItems = 0;
+    };
+
+    bool Snapshot::Save(ModuleInterface* pModuleInterface, const fs::path& filePath)
+    {
+        // Write to a temporary file, so that a failed save does not destroy a previous snapshot.
+        fs::path tmpFilePath = filePath;
+        tmpFilePath += ".tmp";
+
+        std::ofstream ofs(tmpFilePath.native().c_str(), std::ios_base::binary | std::ios_base::trunc);
+        if (!ofs.is_open())
+        {
+            log::Error() << HSCPP_LOG_PREFIX << "Failed to open snapshot file "
+                << tmpFilePath << " for writing." << log::End();
+            return false;
+        }
+
+        uint32_t version = VERSION;
+        uint32_t reserved = 0;
+        uint64_t nObjects = 0;
+
+        Write(ofs, MAGIC, sizeof(MAGIC));
+        Write(ofs, &version, sizeof(version));
+        Write(ofs, &reserved, sizeof(reserved));
+
+        std::streampos nObjectsPos = ofs.tellp();
+        Write(ofs, &nObjects, sizeof(nObjects));
+
+        size_t nSkippedItems = 0;
+        pModuleInterface->SaveTrackedObjects([&](uint64_t keyHash, const Serializer& serializer) {
+            uint32_t nItems = 0;
+            serializer.EnumerateTriviallyCopyableProperties([&](uint64_t, uint64_t, const uint8_t*, size_t) {
+                ++nItems;
+            });
+
+            nSkippedItems += serializer.GetNumberOfProperties() - nItems + serializer.GetNumberOfSkippedProperties();
+
+            Write(ofs, &keyHash, sizeof(keyHash));
+            Write(ofs, &nItems, sizeof(nItems));
+            Write(ofs, &reserved, sizeof(reserved));
+
+            serializer.EnumerateTriviallyCopyableProperties(
+                [&](uint64_t nameHash, uint64_t typeHash, const uint8_t* pValue, size_t size) {
+                    SnapshotItem item;
+                    item.nameHash = nameHash;
+                    item.typeHash = typeHash;
+                    item.size = size;
+
+                    Write(ofs, &item, sizeof(item));
+                    WritePadding(ofs, static_cast<size_t>(ofs.tellp()));
+                    Write(ofs, pValue, size);
+                    WritePadding(ofs, static_cast<size_t>(ofs.tellp()));
+                });
+
+            ++nObjects;
+        });
+
+        ofs.seekp(nObjectsPos);
+        Write(ofs, &nObjects, sizeof(nObjects));
+        ofs.close();
+
+        if (ofs.fail())
+        {
+            log::Error() << HSCPP_LOG_PREFIX << "Failed to write snapshot file " << tmpFilePath << "." << log::End();
+            return false;
+        }
+
+        std::error_code error;
+        fs::rename(tmpFilePath, filePath, error);
+        if (error.value() != HSCPP_ERROR_SUCCESS)
+        {
+            log::Error() << HSCPP_LOG_PREFIX << "Failed to move snapshot file " << tmpFilePath
+                << " to " << filePath << ". " << log::OsError(error) << log::End();
+            return false;
+        }
+
+        if (nSkippedItems > 0)
+        {
+            log::Warning() << HSCPP_LOG_PREFIX << "Skipped " << nSkippedItems
+                << " items that are not trivially copyable while saving snapshot." << log::End();
+        }
+
+        log::Info() << HSCPP_LOG_PREFIX << "Saved " << nObjects << " objects to snapshot "
+            << filePath << "." << log::End();
+
+        return true;
+    }
+
+    bool Snapshot::Restore(ModuleInterface* pModuleInterface, const fs::path& filePath)
+    {
+        size_t size = 0;
+        const uint8_t* pBegin = platform::MapFile(filePath, size);
+        if (pBegin == nullptr)
+        {
+            log::Error() << HSCPP_LOG_PREFIX << "Failed to map snapshot file " << filePath << "." << log::End();
+            return false;
+        }
+
+        size_t offset = 0;
+
+        char magic[sizeof(MAGIC)] = {};
+        uint32_t version = 0;
+        uint32_t reserved = 0;
+        uint64_t nObjects = 0;
+
+        bool bValid = Read(pBegin, size, offset, magic, sizeof(magic))
+            && Read(pBegin, size, offset, &version, sizeof(version))
+            && Read(pBegin, size, offset, &reserved, sizeof(reserved))
+            && Read(pBegin, size, offset, &nObjects, sizeof(nObjects))
+            && std::equal(std::begin(MAGIC), std::end(MAGIC), magic)
+            && version == VERSION;
+
+        // Validate the whole file before constructing any object, so that a truncated or corrupt
+        // file does not leave part of its objects restored.
+        std::vector<SnapshotObject> objects;
+        std::vector<std::pair<SnapshotItem, const uint8_t*>> items;
+
+        for (uint64_t i = 0; bValid && i < nObjects; ++i)
+        {
+            SnapshotObject object;
+            uint32_t nItems = 0;
+
+            bValid = Read(pBegin, size, offset, &object.keyHash, sizeof(object.keyHash))
+                && Read(pBegin, size, offset, &nItems, sizeof(nItems))
+                && Read(pBegin, size, offset, &reserved, sizeof(reserved));
+
+            object.iFirstItem = items.size();
+            object.nItems = nItems;
+
+            for (uint32_t iItem = 0; bValid && iItem < nItems; ++iItem)
+            {
+                SnapshotItem item;
+                bValid = Read(pBegin, size, offset, &item, sizeof(item));
+
+                offset += (ALIGNMENT - offset % ALIGNMENT) % ALIGNMENT;
+                if (bValid && (offset > size || item.size > size - offset))
+                {
+                    bValid = false;
+                }
+
+                if (bValid)
+                {
+                    items.emplace_back(item, pBegin + offset);
+
+                    offset += static_cast<size_t>(item.size);
+                    offset += (ALIGNMENT - offset % ALIGNMENT) % ALIGNMENT;
+                }
+            }
+
+            objects.push_back(object);
+        }
+
+        if (!bValid)
+        {
+            platform::UnmapFile(pBegin, size);
+
+            log::Error() << HSCPP_LOG_PREFIX << "Snapshot file " << filePath
+                << " is invalid or was written by a different version of hscpp." << log::End();
+            return false;
+        }
+
+        std::unordered_map<uint64_t, uint64_t> nRestoredByKey;
+        size_t nUnknownObjects = 0;
+
+        for (const SnapshotObject& object : objects)
+        {
+            // Objects are given new ids in the order they were saved.
+            uint64_t id = nRestoredByKey[object.keyHash];
+            bool bRestored = pModuleInterface->RestoreTrackedObject(object.keyHash, id, [&](Serializer& serializer) {
+                for (size_t iItem = object.iFirstItem; iItem < object.iFirstItem + object.nItems; ++iItem)
+                {
+                    const SnapshotItem& item = items.at(iItem).first;
+                    serializer.AddTriviallyCopyableProperty(item.nameHash, item.typeHash,
+                        items.at(iItem).second, static_cast<size_t>(item.size));
+                }
+            });
+
+            if (bRestored)
+            {
+                ++nRestoredByKey[object.keyHash];
+            }
+            else
+            {
+                ++nUnknownObjects;
+            }
+        }
+
+        platform::UnmapFile(pBegin, size);
+
+        if (nUnknownObjects > 0)
+        {
+            log::Warning() << HSCPP_LOG_PREFIX << "Skipped " << nUnknownObjects
+                << " objects in snapshot whose classes are no longer tracked." << log::End();
+        }
+
+        log::Info() << HSCPP_LOG_PREFIX << "Restored " << nObjects - nUnknownObjects << " objects from snapshot "
+            << filePath << "." << log::End();
+
+        return true;
+    }
+
+    void Snapshot::Write(std::ofstream& ofs, const void* pData, size_t size)
+    {
+        ofs.write(static_cast<const char*>(pData), static_cast<std::streamsize>(size));
+    }
+
+    void Snapshot::WritePadding(std::ofstream& ofs, size_t offset)
+    {
+        static const char PADDING[ALIGNMENT] = {};
+        Write(ofs, PADDING, (ALIGNMENT - offset % ALIGNMENT) % ALIGNMENT);
+    }
+
+    bool Snapshot::Read(const uint8_t* pBegin, size_t size, size_t& offset, void* pData, size_t dataSize)
+    {
+        if (offset > size || dataSize > size - offset)
+        {
+            return false;
+        }
+
+        std::memcpy(pData, pBegin + offset, dataSize);
+        offset += dataSize;
+
+        return true;
+    }
+
+}
\ No newline at end of file
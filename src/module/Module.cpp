@@ -15,9 +15,12 @@ namespace hscpp
     void* GlobalUserData::s_pData = nullptr;
 
     bool* ModuleSharedState::s_pbSwapping = nullptr;
-    std::unordered_map<std::string, std::vector<ITracker*>>* ModuleSharedState::s_pTrackersByKey = nullptr;
-    std::unordered_map<std::string, IConstructor*>* ModuleSharedState::s_pConstructorsByKey = nullptr;
+    std::unordered_map<uint64_t, std::vector<ITracker*>>* ModuleSharedState::s_pTrackersByKey = nullptr;
+    std::unordered_map<uint64_t, CompactTrackerTable>* ModuleSharedState::s_pCompactTrackersByKey = nullptr;
+    std::unordered_map<uint64_t, IConstructor*>* ModuleSharedState::s_pConstructorsByKey = nullptr;
+    const uint64_t* ModuleSharedState::s_pConstructorsGeneration = nullptr;
     IAllocator* ModuleSharedState::s_pAllocator = nullptr;
+    std::recursive_mutex* ModuleSharedState::s_pTrackerMutex = nullptr;
 
 }
 
@@ -6,305 +6,1026 @@
 namespace hscpp
 {
 
-    std::vector<hscpp::fs::path> DependencyGraph::ResolveGraph(const fs::path& filePath)
-    {
-        std::unordered_set<int> collectedDependentHandles;
-        std::unordered_set<int> collectedDependencyHandles;
+    // Edits are kept in the overlay until it holds this many handles, or a fraction of all handles,
+    // whichever is larger. Compacting rewrites the whole graph, so it should not happen often.
+    const static size_t MIN_OVERLAY_SIZE_BEFORE_COMPACT = 1024;
+    const static size_t OVERLAY_FRACTION_BEFORE_COMPACT = 8;
 
-        int fileHandle = GetHandle(filePath);
+    // Cached graphs are cleared once they hold this many touched handles in total, to bound the
+    // memory held by the cache. The cache refills with the graphs that are still queried.
+    const static size_t MAX_CACHED_TOUCHED_HANDLES = 1024 * 1024;
 
-        // When compiling a module, add dependents of that module must also be compiled.
-        if (IsModule(fileHandle))
-        {
-            CollectDependents(fileHandle, collectedDependentHandles);
-        }
+    // Stale entries in the reverse index are pruned once they outnumber live entries, and there are
+    // at least this many of them.
+    const static size_t MIN_CACHED_ROOTS_BEFORE_PRUNE = 1024;
 
-        // We want to compile all dependencies that are modules. If we have any dependents, their
-        // dependencies must also be added to the compilation list.
-        CollectDependencies(fileHandle, collectedDependencyHandles);
-        for (int collectedDependentHandle : collectedDependentHandles)
+    static std::string Quote(const std::string& str)
+    {
+        std::string escaped = "\"";
+        for (char c : str)
         {
-            CollectDependencies(collectedDependentHandle, collectedDependencyHandles);
+            switch (c)
+            {
+                case '"':
+                    escaped += "\\\"";
+                    break;
+                case '\\':
+                    escaped += "\\\\";
+                    break;
+                case '\n':
+                    escaped += "\\n";
+                    break;
+                default:
+                    escaped += c;
+                    break;
+            }
         }
 
-        std::unordered_set<int> collectedHandles;
-        collectedHandles.insert(collectedDependentHandles.begin(), collectedDependentHandles.end());
-        collectedHandles.insert(collectedDependencyHandles.begin(), collectedDependencyHandles.end());
-        
+        return escaped + "\"";
+    }
+
+    static bool IsBitSet(const std::vector<uint64_t>& bits, int handle)
+    {
+        return (bits.at(handle / 64) & (uint64_t(1) << (handle % 64))) != 0;
+    }
+
+    static void SetBit(std::vector<uint64_t>& bits, int handle)
+    {
+        bits.at(handle / 64) |= (uint64_t(1) << (handle % 64));
+    }
+
+    std::vector<hscpp::fs::path> DependencyGraph::ResolveGraph(const fs::path& filePath)
+    {
+        return ResolveGraph(std::vector<fs::path>{ filePath });
+    }
+
+    std::vector<fs::path> DependencyGraph::ResolveGraph(const std::vector<fs::path>& filePaths)
+    {
+        std::vector<int> rootHandles = AsHandles(filePaths);
+
         std::vector<fs::path> resolvedFilePaths;
-        for (const auto& collectedHandle : collectedHandles)
+        if (rootHandles.size() == 1)
         {
-            fs::path collectedFilePath = GetFilepath(collectedHandle);
-            if (util::IsSourceFile(collectedFilePath))
+            for (int resolvedHandle : GetResolvedGraph(rootHandles.front()).resolvedHandles)
             {
-                resolvedFilePaths.push_back(collectedFilePath);
+                resolvedFilePaths.push_back(m_FilePaths.at(resolvedHandle));
             }
+
+            return resolvedFilePaths;
         }
-            
+
+        // Resolve every root in a single traversal, so that shared subgraphs are only walked once.
+        std::vector<int> resolvedHandles;
+        std::vector<int> touchedHandles;
+        Resolve(rootHandles, resolvedHandles, touchedHandles);
+
+        for (int resolvedHandle : resolvedHandles)
+        {
+            resolvedFilePaths.push_back(m_FilePaths.at(resolvedHandle));
+        }
+
         return resolvedFilePaths;
     }
 
     void DependencyGraph::SetLinkedModules(const fs::path& filePath, const std::vector<std::string>& modules)
     {
         int handle = GetHandle(filePath);
+        m_bInGraph.at(handle) = true;
+
+        std::vector<int> newModuleIds;
+        for (const auto& module : modules)
+        {
+            newModuleIds.push_back(GetModuleId(module));
+        }
+
+        std::sort(newModuleIds.begin(), newModuleIds.end());
+        newModuleIds.erase(std::unique(newModuleIds.begin(), newModuleIds.end()), newModuleIds.end());
+
+        std::vector<int> oldModuleIds = m_ModuleIdsByHandle.at(handle);
+        std::sort(oldModuleIds.begin(), oldModuleIds.end());
+
+        if (newModuleIds == oldModuleIds)
+        {
+            // Avoid invalidating cached graphs when a file is saved without changing its modules.
+            return;
+        }
+
+        // Graphs that saw either the old or new modules must be resolved again.
+        std::vector<int> changedHandles = { handle };
+        AppendLinkedModuleHandles(handle, changedHandles);
 
         // Remove old links.
-        RemoveLinkedModule(handle);
+        RemoveLinkedModules(handle);
 
         // Add new links.
-        if (!modules.empty())
+        m_ModuleIdsByHandle.at(handle) = newModuleIds;
+        for (int moduleId : newModuleIds)
         {
-            for (const auto& module : modules)
-            {
-                m_ModulesByHandle[handle].insert(module);
-                m_HandlesByModule[module].insert(handle);
-            }
+            m_HandlesByModuleId.at(moduleId).push_back(handle);
         }
+
+        AppendLinkedModuleHandles(handle, changedHandles);
+        Invalidate(changedHandles);
     }
 
     void DependencyGraph::SetFileDependencies(const fs::path& filePath, const std::vector<fs::path>& dependencies)
     {
         int fileHandle = GetHandle(filePath);
 
-        Node* pNode = GetNode(fileHandle);
-        if (pNode == nullptr)
+        std::vector<int> dependencyHandles = AsHandles(dependencies);
+        std::sort(dependencyHandles.begin(), dependencyHandles.end());
+        dependencyHandles.erase(std::unique(dependencyHandles.begin(), dependencyHandles.end()),
+                dependencyHandles.end());
+
+        m_bInGraph.at(fileHandle) = true;
+        for (int dependencyHandle : dependencyHandles)
         {
-            pNode = CreateNode(filePath);
+            m_bInGraph.at(dependencyHandle) = true;
+        }
+
+        Adjacency::Range oldDependencies = m_Dependencies.Get(fileHandle);
+        std::vector<int> oldDependencyHandles(oldDependencies.begin(), oldDependencies.end());
+        std::sort(oldDependencyHandles.begin(), oldDependencyHandles.end());
+
+        if (dependencyHandles == oldDependencyHandles)
+        {
+            // Avoid invalidating cached graphs when a file is saved without changing its includes.
+            return;
         }
 
         // Remove reference to self from old dependencies.
-        for (int dependencyHandle : pNode->dependencyHandles)
+        for (int dependencyHandle : oldDependencyHandles)
         {
-            Node* pDependency = GetNode(dependencyHandle);
-            pDependency->dependentHandles.erase(fileHandle);
+            m_Dependents.Remove(dependencyHandle, fileHandle);
         }
 
         // Add reference to self to new dependencies.
-        pNode->dependencyHandles = AsHandleSet(dependencies);
-        for (int dependencyHandle : pNode->dependencyHandles)
+        for (int dependencyHandle : dependencyHandles)
         {
-            Node* pDependency = GetNode(dependencyHandle);
-            if (pDependency == nullptr)
-            {
-                pDependency = CreateNode(dependencyHandle);
-            }
-
-            pDependency->dependentHandles.insert(fileHandle);
+            m_Dependents.Add(dependencyHandle, fileHandle);
         }
+
+        m_Dependencies.Set(fileHandle, dependencyHandles);
+
+        std::vector<int> changedHandles = { fileHandle };
+        changedHandles.insert(changedHandles.end(), oldDependencyHandles.begin(), oldDependencyHandles.end());
+        changedHandles.insert(changedHandles.end(), dependencyHandles.begin(), dependencyHandles.end());
+        Invalidate(changedHandles);
     }
 
     void DependencyGraph::RemoveFile(const fs::path& filePath)
     {
-        int fileHandle = GetHandle(filePath);
-
-        Node* pNode = GetNode(fileHandle);
-        if (pNode == nullptr)
+        int fileHandle = 0;
+        if (!FindHandle(filePath, fileHandle))
         {
             // File is not part of dependency graph.
             return;
         }
 
-        // Remove reference to self from old dependencies.
-        for (int dependencyHandle : pNode->dependencyHandles)
-        {
-            Node* pDependency = GetNode(dependencyHandle);
-            pDependency->dependentHandles.erase(fileHandle);
-        }
+        std::vector<int> changedHandles = { fileHandle };
+        AppendLinkedModuleHandles(fileHandle, changedHandles);
 
-        // Remove reference to self from old dependents.
-        for (int dependentHandle : pNode->dependentHandles)
-        {
-            Node* pDependent = GetNode(dependentHandle);
-            pDependent->dependencyHandles.erase(fileHandle);
-        }
+        Adjacency::Range dependencies = m_Dependencies.Get(fileHandle);
+        changedHandles.insert(changedHandles.end(), dependencies.begin(), dependencies.end());
+
+        Adjacency::Range dependents = m_Dependents.Get(fileHandle);
+        changedHandles.insert(changedHandles.end(), dependents.begin(), dependents.end());
 
-        m_NodeByHandle.erase(m_NodeByHandle.find(fileHandle));
-        RemoveLinkedModule(fileHandle);
+        Invalidate(changedHandles);
+
+        RemoveEdges(fileHandle);
+        RemoveLinkedModules(fileHandle);
+
+        m_bInGraph.at(fileHandle) = false;
     }
 
     void DependencyGraph::Clear()
     {
-        m_HandlesByModule.clear();
-        m_ModulesByHandle.clear();
-        m_FilePathByHandle.clear();
         m_HandleByFilePath.clear();
-        m_NodeByHandle.clear();
+        m_FilePaths.clear();
+        m_bSourceFiles.clear();
+        m_bInGraph.clear();
+
+        m_Dependencies.Clear();
+        m_Dependents.Clear();
+
+        m_ResolvedGraphByHandle.clear();
+        m_CachedRootsByHandle.clear();
+        m_nCachedTouchedHandles = 0;
+        m_nCachedRoots = 0;
+
+        m_ModuleIdByName.clear();
+        m_ModuleNames.clear();
+        m_HandlesByModuleId.clear();
+        m_ModuleIdsByHandle.clear();
     }
 
-    void DependencyGraph::Collect(int handle,
-            std::unordered_set<int>& collectedHandles, const std::function<void(Node*)>& cb)
+    bool DependencyGraph::Explain(const fs::path& rootFilePath,
+            const fs::path& resolvedFilePath, std::vector<Link>& chain)
     {
-        if (collectedHandles.find(handle) != collectedHandles.end())
+        chain.clear();
+
+        int rootHandle = 0;
+        int resolvedHandle = 0;
+        if (!FindHandle(rootFilePath, rootHandle) || !FindHandle(resolvedFilePath, resolvedHandle))
         {
-            return;
+            return false;
         }
 
-        std::vector<int> linkedHandles;
+        // Breadth-first search through the same two passes as ResolveGraph, first through dependents
+        // and then through dependencies, such that the shortest explanation is found. Each step
+        // remembers how it was reached, to rebuild the chain afterwards.
+        struct Step
+        {
+            bool bReached = false;
+            Link::Type type = Link::Type::Root;
+            int moduleId = -1;
+
+            int iParentPass = -1;
+            int parentHandle = -1;
+        };
+
+        const int DEPENDENT_PASS = 0;
+        const int DEPENDENCY_PASS = 1;
+
+        std::vector<Step> steps[2] = {
+            std::vector<Step>(m_FilePaths.size()),
+            std::vector<Step>(m_FilePaths.size()),
+        };
+
+        std::vector<int> queue;
+
+        auto reach = [&](int iPass, int handle, const Step& step) {
+            Step& curStep = steps[iPass].at(handle);
+            if (curStep.bReached)
+            {
+                // A file reached through a module link does not pull in its own modules. If it is
+                // later reached directly, it must be searched again.
+                if (curStep.type != Link::Type::Module || step.type == Link::Type::Module)
+                {
+                    return;
+                }
+            }
+
+            curStep = step;
+            curStep.bReached = true;
+            queue.push_back(handle);
+        };
+
+        auto search = [&](int iPass, const Adjacency& adjacency, Link::Type edgeType) {
+            for (size_t iQueue = 0; iQueue < queue.size(); ++iQueue)
+            {
+                int handle = queue.at(iQueue);
+                const Step& step = steps[iPass].at(handle);
+
+                if (step.type != Link::Type::Module)
+                {
+                    for (int moduleId : m_ModuleIdsByHandle.at(handle))
+                    {
+                        for (int linkedHandle : m_HandlesByModuleId.at(moduleId))
+                        {
+                            Step linkedStep;
+                            linkedStep.type = Link::Type::Module;
+                            linkedStep.moduleId = moduleId;
+                            linkedStep.iParentPass = iPass;
+                            linkedStep.parentHandle = handle;
+
+                            reach(iPass, linkedHandle, linkedStep);
+                        }
+                    }
+                }
+
+                for (int edgeHandle : adjacency.Get(handle))
+                {
+                    Step edgeStep;
+                    edgeStep.type = edgeType;
+                    edgeStep.iParentPass = iPass;
+                    edgeStep.parentHandle = handle;
+
+                    reach(iPass, edgeHandle, edgeStep);
+                }
+            }
+
+            queue.clear();
+        };
+
+        CompactIfNeeded();
+
+        if (IsModule(rootHandle))
+        {
+            reach(DEPENDENT_PASS, rootHandle, Step());
+            search(DEPENDENT_PASS, m_Dependents, Link::Type::Dependent);
+        }
 
-        bool bModule = IsModule(handle);
-        if (bModule)
+        reach(DEPENDENCY_PASS, rootHandle, Step());
+        for (int handle = 0; handle < static_cast<int>(m_FilePaths.size()); ++handle)
         {
-            linkedHandles = GetLinkedModuleHandles(handle);
+            if (handle != rootHandle && steps[DEPENDENT_PASS].at(handle).bReached)
+            {
+                // Dependents are searched again for their dependencies, continuing the chain from the
+                // first pass.
+                Step continuedStep = steps[DEPENDENT_PASS].at(handle);
+                continuedStep.type = Link::Type::Root;
+                continuedStep.iParentPass = DEPENDENT_PASS;
+                continuedStep.parentHandle = handle;
+
+                reach(DEPENDENCY_PASS, handle, continuedStep);
+            }
         }
-        else
+
+        search(DEPENDENCY_PASS, m_Dependencies, Link::Type::Dependency);
+
+        if (!steps[DEPENDENCY_PASS].at(resolvedHandle).bReached)
         {
-            linkedHandles = { handle };
+            return false;
         }
 
-        for (const int linkedHandle : linkedHandles)
+        int iPass = DEPENDENCY_PASS;
+        int handle = resolvedHandle;
+
+        while (handle != -1)
         {
-            if (collectedHandles.find(linkedHandle) == collectedHandles.end())
+            const Step& step = steps[iPass].at(handle);
+
+            bool bContinued = (iPass == DEPENDENCY_PASS && step.iParentPass == DEPENDENT_PASS);
+            if (!bContinued)
             {
-                collectedHandles.insert(linkedHandle);
-                Node* pNode = GetNode(linkedHandle);
-                if (pNode != nullptr)
+                Link link;
+                link.type = step.type;
+                link.filePath = m_FilePaths.at(handle);
+
+                if (step.moduleId != -1)
                 {
-                    cb(pNode);
+                    link.module = m_ModuleNames.at(step.moduleId);
                 }
+
+                chain.push_back(link);
             }
+
+            iPass = step.iParentPass;
+            handle = step.parentHandle;
+        }
+
+        std::reverse(chain.begin(), chain.end());
+        return true;
+    }
+
+    DependencyGraph::FileStats DependencyGraph::GetFileStats(const fs::path& filePath)
+    {
+        // Querying a file must not add it to the graph.
+        int handle = 0;
+        if (!FindHandle(filePath, handle))
+        {
+            FileStats stats;
+            stats.filePath = filePath;
+
+            return stats;
         }
+
+        return GetFileStats(handle, GetAverageCompileDuration());
     }
 
-    void DependencyGraph::CollectDependencies(int handle, std::unordered_set<int>& collectedHandles)
+    std::vector<DependencyGraph::FileStats> DependencyGraph::GetHeaderStats()
     {
-        Collect(handle, collectedHandles, [&](Node* pNode) {
-            for (int dependencyHandle : pNode->dependencyHandles)
+        double averageCompileDuration = GetAverageCompileDuration();
+
+        std::vector<FileStats> headerStats;
+        for (int handle = 0; handle < static_cast<int>(m_FilePaths.size()); ++handle)
+        {
+            if (m_bInGraph.at(handle) && util::IsHeaderFile(m_FilePaths.at(handle)))
+            {
+                headerStats.push_back(GetFileStats(handle, averageCompileDuration));
+            }
+        }
+
+        std::sort(headerStats.begin(), headerStats.end(), [](const FileStats& a, const FileStats& b) {
+            if (a.rebuildCost != b.rebuildCost)
             {
-                CollectDependencies(dependencyHandle, collectedHandles);
+                return a.rebuildCost > b.rebuildCost;
             }
+
+            return a.nResolvedFiles > b.nResolvedFiles;
         });
+
+        return headerStats;
+    }
+
+    void DependencyGraph::RecordCompileDuration(const fs::path& sourceFilePath, double seconds)
+    {
+        m_CompileDurationByFilePath[sourceFilePath] = seconds;
     }
 
-    void DependencyGraph::CollectDependents(int handle, std::unordered_set<int>& collectedHandles)
+    void DependencyGraph::WriteJson(std::ostream& os)
     {
-        Collect(handle, collectedHandles, [&](Node* pNode) {
-            for (int dependentHandle : pNode->dependentHandles)
+        double averageCompileDuration = GetAverageCompileDuration();
+
+        os << "{\n";
+        os << "    \"files\": [";
+
+        bool bFirstFile = true;
+        for (int handle = 0; handle < static_cast<int>(m_FilePaths.size()); ++handle)
+        {
+            if (!m_bInGraph.at(handle))
             {
-                CollectDependents(dependentHandle, collectedHandles);
+                continue;
             }
-        });
+
+            FileStats stats = GetFileStats(handle, averageCompileDuration);
+
+            os << (bFirstFile ? "\n" : ",\n");
+            bFirstFile = false;
+
+            os << "        {\n";
+            os << "            \"id\": " << handle << ",\n";
+            os << "            \"path\": " << Quote(m_FilePaths.at(handle).generic_u8string()) << ",\n";
+            os << "            \"source\": " << (m_bSourceFiles.at(handle) ? "true" : "false") << ",\n";
+
+            os << "            \"modules\": [";
+            const std::vector<int>& moduleIds = m_ModuleIdsByHandle.at(handle);
+            for (size_t i = 0; i < moduleIds.size(); ++i)
+            {
+                os << (i == 0 ? "" : ", ") << Quote(m_ModuleNames.at(moduleIds.at(i)));
+            }
+            os << "],\n";
+
+            os << "            \"dependencies\": [";
+            bool bFirstDependency = true;
+            for (int dependencyHandle : m_Dependencies.Get(handle))
+            {
+                os << (bFirstDependency ? "" : ", ") << dependencyHandle;
+                bFirstDependency = false;
+            }
+            os << "],\n";
+
+            os << "            \"directDependents\": " << stats.nDirectDependents << ",\n";
+            os << "            \"resolvedFiles\": " << stats.nResolvedFiles << ",\n";
+            os << "            \"rebuildCost\": " << stats.rebuildCost << "\n";
+            os << "        }";
+        }
+
+        os << "\n    ]\n";
+        os << "}\n";
     }
 
-    bool DependencyGraph::IsModule(int handle)
+    void DependencyGraph::WriteDot(std::ostream& os)
     {
-        auto it = m_ModulesByHandle.find(handle);
-        if (it != m_ModulesByHandle.end())
+        double averageCompileDuration = GetAverageCompileDuration();
+
+        os << "digraph DependencyGraph {\n";
+
+        for (int handle = 0; handle < static_cast<int>(m_FilePaths.size()); ++handle)
         {
-            return !m_ModulesByHandle.empty();
+            if (!m_bInGraph.at(handle))
+            {
+                continue;
+            }
+
+            FileStats stats = GetFileStats(handle, averageCompileDuration);
+
+            // Label each file with its rebuild set size and cost, to make expensive files stand out.
+            os << "    f" << handle << " [label=" << Quote(m_FilePaths.at(handle).filename().u8string()
+                + "\n" + std::to_string(stats.nResolvedFiles) + " files, " + std::to_string(stats.rebuildCost) + "s")
+                << ", shape=" << (m_bSourceFiles.at(handle) ? "box" : "ellipse") << "];\n";
+
+            for (int dependencyHandle : m_Dependencies.Get(handle))
+            {
+                os << "    f" << handle << " -> f" << dependencyHandle << ";\n";
+            }
+
+            for (int moduleId : m_ModuleIdsByHandle.at(handle))
+            {
+                os << "    f" << handle << " -> m" << moduleId << " [style=dashed, arrowhead=none];\n";
+            }
         }
 
-        return false;
+        for (size_t moduleId = 0; moduleId < m_ModuleNames.size(); ++moduleId)
+        {
+            if (!m_HandlesByModuleId.at(moduleId).empty())
+            {
+                os << "    m" << moduleId << " [label=" << Quote(m_ModuleNames.at(moduleId))
+                    << ", shape=diamond];\n";
+            }
+        }
+
+        os << "}\n";
+    }
+
+    DependencyGraph::Adjacency::Range DependencyGraph::Adjacency::Get(int handle) const
+    {
+        Range range;
+
+        if (!m_OverlayEdgesByHandle.empty())
+        {
+            auto it = m_OverlayEdgesByHandle.find(handle);
+            if (it != m_OverlayEdgesByHandle.end())
+            {
+                range.pBegin = it->second.data();
+                range.pEnd = range.pBegin + it->second.size();
+                return range;
+            }
+        }
+
+        // Handles created after the last compaction have no compressed edges.
+        size_t iHandle = static_cast<size_t>(handle);
+        if (iHandle + 1 < m_Offsets.size())
+        {
+            range.pBegin = m_Edges.data() + m_Offsets.at(iHandle);
+            range.pEnd = m_Edges.data() + m_Offsets.at(iHandle + 1);
+        }
+
+        return range;
+    }
+
+    void DependencyGraph::Adjacency::Set(int handle, const std::vector<int>& edges)
+    {
+        m_OverlayEdgesByHandle[handle] = edges;
+    }
+
+    void DependencyGraph::Adjacency::Add(int handle, int edge)
+    {
+        std::vector<int>& edges = GetOverlay(handle);
+        if (std::find(edges.begin(), edges.end(), edge) == edges.end())
+        {
+            edges.push_back(edge);
+        }
+    }
+
+    void DependencyGraph::Adjacency::Remove(int handle, int edge)
+    {
+        std::vector<int>& edges = GetOverlay(handle);
+
+        auto it = std::find(edges.begin(), edges.end(), edge);
+        if (it != edges.end())
+        {
+            *it = edges.back();
+            edges.pop_back();
+        }
+    }
+
+    size_t DependencyGraph::Adjacency::GetOverlaySize() const
+    {
+        return m_OverlayEdgesByHandle.size();
+    }
+
+    void DependencyGraph::Adjacency::Compact(size_t nHandles)
+    {
+        std::vector<uint32_t> offsets;
+        std::vector<int> edges;
+
+        offsets.reserve(nHandles + 1);
+        edges.reserve(m_Edges.size());
+
+        for (size_t i = 0; i < nHandles; ++i)
+        {
+            offsets.push_back(static_cast<uint32_t>(edges.size()));
+
+            Range range = Get(static_cast<int>(i));
+            edges.insert(edges.end(), range.begin(), range.end());
+        }
+
+        offsets.push_back(static_cast<uint32_t>(edges.size()));
+
+        m_Offsets = std::move(offsets);
+        m_Edges = std::move(edges);
+        m_OverlayEdgesByHandle.clear();
     }
 
-    std::vector<int> DependencyGraph::GetLinkedModuleHandles(int handle)
+    void DependencyGraph::Adjacency::Clear()
     {
-        std::unordered_set<int> linkedHandles;
+        m_Offsets.clear();
+        m_Edges.clear();
+        m_OverlayEdgesByHandle.clear();
+    }
 
-        auto modulesIt = m_ModulesByHandle.find(handle);
-        if (modulesIt != m_ModulesByHandle.end())
+    std::vector<int>& DependencyGraph::Adjacency::GetOverlay(int handle)
+    {
+        auto it = m_OverlayEdgesByHandle.find(handle);
+        if (it != m_OverlayEdgesByHandle.end())
         {
-            for (const std::string& module : modulesIt->second)
+            return it->second;
+        }
+
+        // Copy the compressed edges into the overlay, so that they can be edited.
+        Range range = Get(handle);
+
+        std::vector<int>& edges = m_OverlayEdgesByHandle[handle];
+        edges.assign(range.begin(), range.end());
+
+        return edges;
+    }
+
+    const DependencyGraph::ResolvedGraph& DependencyGraph::GetResolvedGraph(int rootHandle)
+    {
+        auto it = m_ResolvedGraphByHandle.find(rootHandle);
+        if (it != m_ResolvedGraphByHandle.end())
+        {
+            return it->second;
+        }
+
+        ResolvedGraph resolvedGraph;
+        Resolve({ rootHandle }, resolvedGraph.resolvedHandles, resolvedGraph.sortedTouchedHandles);
+
+        const std::vector<int>& touchedHandles = resolvedGraph.sortedTouchedHandles;
+        if (m_nCachedTouchedHandles + touchedHandles.size() > MAX_CACHED_TOUCHED_HANDLES)
+        {
+            ClearResolvedGraphs();
+        }
+
+        resolvedGraph.generation = ++m_ResolvedGraphGeneration;
+        for (int touchedHandle : touchedHandles)
+        {
+            m_CachedRootsByHandle.at(touchedHandle).push_back({ rootHandle, resolvedGraph.generation });
+        }
+
+        m_nCachedRoots += touchedHandles.size();
+        m_nCachedTouchedHandles += touchedHandles.size();
+
+        return m_ResolvedGraphByHandle[rootHandle] = std::move(resolvedGraph);
+    }
+
+    void DependencyGraph::Resolve(const std::vector<int>& rootHandles,
+            std::vector<int>& resolvedHandles, std::vector<int>& sortedTouchedHandles)
+    {
+        CompactIfNeeded();
+
+        // When compiling a module, all dependents of that module must also be compiled.
+        std::vector<int> moduleRootHandles;
+        for (int rootHandle : rootHandles)
+        {
+            if (IsModule(rootHandle))
             {
-                auto linkedHandlesIt = m_HandlesByModule.find(module);
-                if (linkedHandlesIt != m_HandlesByModule.end())
+                moduleRootHandles.push_back(rootHandle);
+            }
+        }
+
+        std::vector<int> collectedDependentHandles;
+        if (!moduleRootHandles.empty())
+        {
+            Collect(m_Dependents, moduleRootHandles, collectedDependentHandles);
+        }
+
+        // We want to compile all dependencies that are modules. If we have any dependents, their
+        // dependencies must also be added to the compilation list. Since every dependent is a root
+        // of this traversal, the collected dependencies also contain all dependents.
+        std::vector<int> dependencyRootHandles = rootHandles;
+        dependencyRootHandles.insert(dependencyRootHandles.end(),
+                collectedDependentHandles.begin(), collectedDependentHandles.end());
+
+        std::vector<int> collectedHandles;
+        Collect(m_Dependencies, dependencyRootHandles, collectedHandles);
+
+        for (int collectedHandle : collectedHandles)
+        {
+            if (m_bSourceFiles.at(collectedHandle))
+            {
+                resolvedHandles.push_back(collectedHandle);
+            }
+        }
+
+        // Every handle read during traversal was collected in one of the two passes.
+        sortedTouchedHandles = std::move(collectedHandles);
+        sortedTouchedHandles.insert(sortedTouchedHandles.end(),
+                collectedDependentHandles.begin(), collectedDependentHandles.end());
+
+        std::sort(sortedTouchedHandles.begin(), sortedTouchedHandles.end());
+        sortedTouchedHandles.erase(std::unique(sortedTouchedHandles.begin(), sortedTouchedHandles.end()),
+                sortedTouchedHandles.end());
+    }
+
+    void DependencyGraph::Invalidate(const std::vector<int>& changedHandles)
+    {
+        for (int changedHandle : changedHandles)
+        {
+            std::vector<CachedRoot>& cachedRoots = m_CachedRootsByHandle.at(changedHandle);
+            for (const CachedRoot& cachedRoot : cachedRoots)
+            {
+                // Skip entries of graphs already invalidated, or since resolved again.
+                auto it = m_ResolvedGraphByHandle.find(cachedRoot.rootHandle);
+                if (it != m_ResolvedGraphByHandle.end() && it->second.generation == cachedRoot.generation)
                 {
-                    for (const auto& linkedHandle : linkedHandlesIt->second)
-                    {
-                        linkedHandles.insert(linkedHandle);
-                    }
+                    m_nCachedTouchedHandles -= it->second.sortedTouchedHandles.size();
+                    m_ResolvedGraphByHandle.erase(it);
                 }
             }
+
+            m_nCachedRoots -= cachedRoots.size();
+            cachedRoots.clear();
         }
 
-        return std::vector<int>(linkedHandles.begin(), linkedHandles.end());
+        // Invalidated graphs leave stale entries under the handles that did not change.
+        if (m_nCachedRoots > MIN_CACHED_ROOTS_BEFORE_PRUNE && m_nCachedRoots > 2 * m_nCachedTouchedHandles)
+        {
+            PruneCachedRoots();
+        }
     }
 
-    void DependencyGraph::RemoveLinkedModule(int handle)
+    void DependencyGraph::ClearResolvedGraphs()
     {
-        auto oldModulesIt = m_ModulesByHandle.find(handle);
-        if (oldModulesIt != m_ModulesByHandle.end())
+        m_ResolvedGraphByHandle.clear();
+
+        for (std::vector<CachedRoot>& cachedRoots : m_CachedRootsByHandle)
         {
-            // Create copy, to allow deletion during iteration.
-            std::unordered_set<std::string> oldModulesCopy = oldModulesIt->second;
+            cachedRoots.clear();
+        }
 
-            // Remove all previously linked modules associated with this handle.
-            m_ModulesByHandle.erase(oldModulesIt);
+        m_nCachedTouchedHandles = 0;
+        m_nCachedRoots = 0;
+    }
+
+    void DependencyGraph::PruneCachedRoots()
+    {
+        for (std::vector<CachedRoot>& cachedRoots : m_CachedRootsByHandle)
+        {
+            cachedRoots.clear();
+        }
 
-            // Remove stale handles.
-            for (const auto& oldModule : oldModulesCopy)
+        for (const auto& rootHandle__resolvedGraph : m_ResolvedGraphByHandle)
+        {
+            const ResolvedGraph& resolvedGraph = rootHandle__resolvedGraph.second;
+            for (int touchedHandle : resolvedGraph.sortedTouchedHandles)
             {
-                m_HandlesByModule[oldModule].erase(handle);
+                m_CachedRootsByHandle.at(touchedHandle).push_back(
+                        { rootHandle__resolvedGraph.first, resolvedGraph.generation });
             }
         }
+
+        m_nCachedRoots = m_nCachedTouchedHandles;
     }
 
-    int DependencyGraph::CreateHandle(const fs::path& filePath)
+    void DependencyGraph::Collect(const Adjacency& adjacency,
+            const std::vector<int>& rootHandles, std::vector<int>& collectedHandles)
     {
-        int handle = m_NextHandle;
-        ++m_NextHandle;
+        // Depth-first traversal using an explicit stack, to avoid overflowing the call stack on deep
+        // include chains. Visiting a handle collects it, or if it is a module, collects all files
+        // within its modules. The edges of each collected handle are visited before the next
+        // handle within the module is collected.
+        struct Frame
+        {
+            bool bLinked = false;
 
-        m_HandleByFilePath[filePath] = handle;
-        m_FilePathByHandle[handle] = filePath;
+            // Linked frames iterate over linked handles stored in linkedHandles[iCur..iEnd].
+            size_t iLinkedBegin = 0;
+            size_t iCur = 0;
+            size_t iEnd = 0;
 
-        return handle;
+            // Edge frames iterate over the edges of a collected handle.
+            const int* pCurEdge = nullptr;
+            const int* pEndEdge = nullptr;
+        };
+
+        std::vector<uint64_t> collected((m_FilePaths.size() + 63) / 64, 0);
+        std::vector<int> linkedHandles;
+        std::vector<Frame> stack;
+
+        auto visit = [&](int handle) {
+            if (IsBitSet(collected, handle))
+            {
+                return;
+            }
+
+            Frame frame;
+            frame.bLinked = true;
+            frame.iLinkedBegin = linkedHandles.size();
+
+            if (IsModule(handle))
+            {
+                AppendLinkedModuleHandles(handle, linkedHandles);
+
+                // Sort handles, such that traversal order is deterministic.
+                auto itBegin = linkedHandles.begin() + frame.iLinkedBegin;
+                std::sort(itBegin, linkedHandles.end());
+                linkedHandles.erase(std::unique(itBegin, linkedHandles.end()), linkedHandles.end());
+            }
+            else
+            {
+                linkedHandles.push_back(handle);
+            }
+
+            frame.iCur = frame.iLinkedBegin;
+            frame.iEnd = linkedHandles.size();
+            stack.push_back(frame);
+        };
+
+        for (int rootHandle : rootHandles)
+        {
+            visit(rootHandle);
+
+            while (!stack.empty())
+            {
+                Frame& frame = stack.back();
+
+                if (!frame.bLinked)
+                {
+                    if (frame.pCurEdge == frame.pEndEdge)
+                    {
+                        stack.pop_back();
+                    }
+                    else
+                    {
+                        visit(*frame.pCurEdge++);
+                    }
+
+                    continue;
+                }
+
+                while (frame.iCur < frame.iEnd && IsBitSet(collected, linkedHandles.at(frame.iCur)))
+                {
+                    ++frame.iCur;
+                }
+
+                if (frame.iCur == frame.iEnd)
+                {
+                    // Frames are popped in reverse order of creation, so this frame's linked
+                    // handles are always at the end of the array.
+                    linkedHandles.resize(frame.iLinkedBegin);
+                    stack.pop_back();
+                    continue;
+                }
+
+                int handle = linkedHandles.at(frame.iCur++);
+                SetBit(collected, handle);
+                collectedHandles.push_back(handle);
+
+                Adjacency::Range edges = adjacency.Get(handle);
+
+                Frame edgeFrame;
+                edgeFrame.pCurEdge = edges.begin();
+                edgeFrame.pEndEdge = edges.end();
+                stack.push_back(edgeFrame); // Invalidates frame.
+            }
+        }
     }
 
-    int DependencyGraph::GetHandle(const fs::path& filePath)
+    bool DependencyGraph::IsModule(int handle)
     {
-        auto it = m_HandleByFilePath.find(filePath);
-        if (it != m_HandleByFilePath.end())
+        return !m_ModuleIdsByHandle.at(handle).empty();
+    }
+
+    void DependencyGraph::AppendLinkedModuleHandles(int handle, std::vector<int>& linkedHandles)
+    {
+        for (int moduleId : m_ModuleIdsByHandle.at(handle))
         {
-            return it->second;
+            const std::vector<int>& moduleHandles = m_HandlesByModuleId.at(moduleId);
+            linkedHandles.insert(linkedHandles.end(), moduleHandles.begin(), moduleHandles.end());
         }
+    }
 
-        return CreateHandle(filePath);
+    void DependencyGraph::RemoveLinkedModules(int handle)
+    {
+        std::vector<int>& moduleIds = m_ModuleIdsByHandle.at(handle);
+        for (int moduleId : moduleIds)
+        {
+            std::vector<int>& linkedHandles = m_HandlesByModuleId.at(moduleId);
+            linkedHandles.erase(std::remove(linkedHandles.begin(), linkedHandles.end(), handle),
+                    linkedHandles.end());
+        }
+
+        moduleIds.clear();
     }
 
-    hscpp::DependencyGraph::Node* DependencyGraph::CreateNode(const fs::path& filePath)
+    void DependencyGraph::RemoveEdges(int handle)
     {
-        int handle = GetHandle(filePath);
-        return CreateNode(handle);
+        // Remove reference to self from old dependencies.
+        for (int dependencyHandle : m_Dependencies.Get(handle))
+        {
+            m_Dependents.Remove(dependencyHandle, handle);
+        }
+
+        // Remove reference to self from old dependents.
+        for (int dependentHandle : m_Dependents.Get(handle))
+        {
+            m_Dependencies.Remove(dependentHandle, handle);
+        }
+
+        m_Dependencies.Set(handle, {});
+        m_Dependents.Set(handle, {});
     }
 
-    hscpp::DependencyGraph::Node* DependencyGraph::CreateNode(int handle)
+    void DependencyGraph::CompactIfNeeded()
     {
-        m_NodeByHandle[handle] = std::unique_ptr<Node>(new Node());
+        size_t overlaySize = m_Dependencies.GetOverlaySize() + m_Dependents.GetOverlaySize();
+        size_t maxOverlaySize = std::max(MIN_OVERLAY_SIZE_BEFORE_COMPACT,
+                m_FilePaths.size() / OVERLAY_FRACTION_BEFORE_COMPACT);
 
-        Node* pNode = m_NodeByHandle[handle].get();
-        return pNode;
+        if (overlaySize > maxOverlaySize)
+        {
+            m_Dependencies.Compact(m_FilePaths.size());
+            m_Dependents.Compact(m_FilePaths.size());
+        }
     }
 
-    hscpp::DependencyGraph::Node* DependencyGraph::GetNode(int handle)
+    DependencyGraph::FileStats DependencyGraph::GetFileStats(int handle, double defaultCompileDuration)
     {
-        auto it = m_NodeByHandle.find(handle);
-        if (it != m_NodeByHandle.end())
+        FileStats stats;
+        stats.filePath = m_FilePaths.at(handle);
+
+        Adjacency::Range dependents = m_Dependents.Get(handle);
+        stats.nDirectDependents = static_cast<size_t>(dependents.end() - dependents.begin());
+
+        // Stats are usually queried for every file at once, so resolve without writing the cache,
+        // which would otherwise keep the closure of every file in the graph.
+        std::vector<int> resolvedHandles;
+        std::vector<int> touchedHandles;
+        Resolve({ handle }, resolvedHandles, touchedHandles);
+
+        stats.nResolvedFiles = resolvedHandles.size();
+
+        for (int resolvedHandle : resolvedHandles)
         {
-            return it->second.get();
+            auto it = m_CompileDurationByFilePath.find(m_FilePaths.at(resolvedHandle));
+            if (it != m_CompileDurationByFilePath.end())
+            {
+                stats.rebuildCost += it->second;
+            }
+            else
+            {
+                stats.rebuildCost += defaultCompileDuration;
+            }
         }
 
-        return nullptr;
+        return stats;
     }
 
-    hscpp::fs::path DependencyGraph::GetFilepath(int handle)
+    double DependencyGraph::GetAverageCompileDuration()
     {
-        auto it = m_FilePathByHandle.find(handle);
-        if (it != m_FilePathByHandle.end())
+        if (m_CompileDurationByFilePath.empty())
+        {
+            return 0;
+        }
+
+        double totalDuration = 0;
+        for (const auto& filePath__duration : m_CompileDurationByFilePath)
+        {
+            totalDuration += filePath__duration.second;
+        }
+
+        return totalDuration / m_CompileDurationByFilePath.size();
+    }
+
+    int DependencyGraph::GetModuleId(const std::string& module)
+    {
+        auto it = m_ModuleIdByName.find(module);
+        if (it != m_ModuleIdByName.end())
         {
             return it->second;
         }
 
-        return fs::path();
+        int moduleId = static_cast<int>(m_HandlesByModuleId.size());
+        m_HandlesByModuleId.emplace_back();
+        m_ModuleNames.push_back(module);
+        m_ModuleIdByName[module] = moduleId;
+
+        return moduleId;
+    }
+
+    int DependencyGraph::CreateHandle(const fs::path& filePath)
+    {
+        int handle = static_cast<int>(m_FilePaths.size());
+
+        m_HandleByFilePath[filePath] = handle;
+        m_FilePaths.push_back(filePath);
+        m_bSourceFiles.push_back(util::IsSourceFile(filePath));
+        m_bInGraph.push_back(false);
+        m_ModuleIdsByHandle.emplace_back();
+        m_CachedRootsByHandle.emplace_back();
+
+        return handle;
+    }
+
+    int DependencyGraph::GetHandle(const fs::path& filePath)
+    {
+        int handle = 0;
+        if (FindHandle(filePath, handle))
+        {
+            return handle;
+        }
+
+        return CreateHandle(filePath);
     }
 
-    std::unordered_set<int> DependencyGraph::AsHandleSet(const std::vector<fs::path>& paths)
+    bool DependencyGraph::FindHandle(const fs::path& filePath, int& handle)
     {
-        std::unordered_set<int> handleSet;
+        auto it = m_HandleByFilePath.find(filePath);
+        if (it != m_HandleByFilePath.end())
+        {
+            handle = it->second;
+            return true;
+        }
+
+        return false;
+    }
+
+    std::vector<int> DependencyGraph::AsHandles(const std::vector<fs::path>& paths)
+    {
+        std::vector<int> handles;
+        handles.reserve(paths.size());
+
         for (const auto& path : paths)
         {
-            handleSet.insert(GetHandle(path));
+            handles.push_back(GetHandle(path));
         }
 
-        return handleSet;
+        return handles;
     }
 
 }
\ No newline at end of file
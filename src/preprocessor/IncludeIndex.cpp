@@ -0,0 +1,220 @@
+#include <algorithm>
+
+#include "hscpp/preprocessor/IncludeIndex.h"
+#include "hscpp/Log.h"
+
+namespace hscpp
+{
+
+    void IncludeIndex::SetIncludeDirectories(const std::vector<fs::path>& includeDirectoryPaths)
+    {
+        bool bChanged = !m_bIndexed || includeDirectoryPaths.size() != m_Directories.size();
+        for (size_t i = 0; !bChanged && i < includeDirectoryPaths.size(); ++i)
+        {
+            bChanged = (includeDirectoryPaths.at(i) != m_Directories.at(i).path);
+        }
+
+        if (!bChanged)
+        {
+            return;
+        }
+
+        Clear();
+
+        for (const auto& includeDirectoryPath : includeDirectoryPaths)
+        {
+            Directory directory;
+            directory.path = includeDirectoryPath;
+
+            Index(directory);
+            m_Directories.push_back(std::move(directory));
+        }
+
+        m_bIndexed = true;
+    }
+
+    void IncludeIndex::AddFile(const fs::path& canonicalFilePath)
+    {
+        for (auto& directory : m_Directories)
+        {
+            std::string relativePath;
+            if (GetRelativePath(directory, canonicalFilePath, relativePath))
+            {
+                directory.canonicalFilePathByRelativePath[relativePath] = canonicalFilePath;
+                m_UnresolvedIncludes.erase(relativePath);
+            }
+        }
+    }
+
+    void IncludeIndex::RemoveFile(const fs::path& canonicalFilePath)
+    {
+        for (auto& directory : m_Directories)
+        {
+            std::string relativePath;
+            if (GetRelativePath(directory, canonicalFilePath, relativePath))
+            {
+                directory.canonicalFilePathByRelativePath.erase(relativePath);
+            }
+        }
+    }
+
+    void IncludeIndex::Resolve(const std::string& include, std::vector<fs::path>& canonicalIncludePaths)
+    {
+        fs::path includePath = fs::u8path(include);
+        std::string normalizedInclude = Normalize(includePath);
+
+        if (includePath.is_absolute() || IsOutsideDirectory(includePath.lexically_normal()))
+        {
+            // The include cannot be found within the index, as it is absolute or points outside of
+            // the include directory. This is rare, so fall back to searching the filesystem.
+            for (const auto& directory : m_Directories)
+            {
+                fs::path fullIncludePath = directory.path / includePath;
+                if (fs::exists(fullIncludePath))
+                {
+                    std::error_code error;
+                    fullIncludePath = fs::canonical(fullIncludePath, error);
+                    if (error.value() == HSCPP_ERROR_SUCCESS)
+                    {
+                        canonicalIncludePaths.push_back(fullIncludePath);
+                    }
+                }
+            }
+
+            return;
+        }
+
+        if (m_UnresolvedIncludes.find(normalizedInclude) != m_UnresolvedIncludes.end())
+        {
+            return;
+        }
+
+        bool bResolved = false;
+        for (const auto& directory : m_Directories)
+        {
+            // For example, the include may be "MathUtil.h", but we want to find the full path for
+            // creating the dependency graph. Search each include directory for a matching file.
+            auto it = directory.canonicalFilePathByRelativePath.find(normalizedInclude);
+            if (it != directory.canonicalFilePathByRelativePath.end())
+            {
+                canonicalIncludePaths.push_back(it->second);
+                bResolved = true;
+            }
+        }
+
+        if (!bResolved)
+        {
+            m_UnresolvedIncludes.insert(normalizedInclude);
+        }
+    }
+
+    void IncludeIndex::Clear()
+    {
+        m_bIndexed = false;
+        m_Directories.clear();
+        m_UnresolvedIncludes.clear();
+    }
+
+    void IncludeIndex::Index(Directory& directory)
+    {
+        std::error_code error;
+        directory.canonicalPath = fs::canonical(directory.path, error);
+
+        if (error.value() != HSCPP_ERROR_SUCCESS)
+        {
+            log::Warning() << HSCPP_LOG_PREFIX << "Unable to get canonical path of include directory "
+                << directory.path << ". " << log::OsError(error) << log::End();
+            return;
+        }
+
+        auto directoryIterator = fs::recursive_directory_iterator(directory.canonicalPath,
+                fs::directory_options::skip_permission_denied | fs::directory_options::follow_directory_symlink, error);
+
+        if (error.value() != HSCPP_ERROR_SUCCESS)
+        {
+            log::Warning() << HSCPP_LOG_PREFIX << "Unable to iterate include directory "
+                << directory.path << ". " << log::OsError(error) << log::End();
+            return;
+        }
+
+        // Symlinked directories are followed, so track the canonical path of each directory to avoid
+        // recursing forever into a symlink that points to one of its parents.
+        std::unordered_set<std::string> visitedDirectories = { directory.canonicalPath.generic_u8string() };
+
+        for (; directoryIterator != fs::recursive_directory_iterator(); directoryIterator.increment(error))
+        {
+            if (error.value() != HSCPP_ERROR_SUCCESS)
+            {
+                log::Warning() << HSCPP_LOG_PREFIX << "Failed to iterate include directory "
+                    << directory.path << ". " << log::OsError(error) << log::End();
+                return;
+            }
+
+            const fs::directory_entry& entry = *directoryIterator;
+            if (entry.is_directory(error))
+            {
+                fs::path canonicalDirectoryPath = fs::canonical(entry.path(), error);
+                if (error.value() != HSCPP_ERROR_SUCCESS
+                    || !visitedDirectories.insert(canonicalDirectoryPath.generic_u8string()).second)
+                {
+                    directoryIterator.disable_recursion_pending();
+                }
+
+                continue;
+            }
+
+            if (!entry.is_regular_file(error))
+            {
+                continue;
+            }
+
+            // Resolve symlinks, such that the indexed path matches the canonical path passed in
+            // through AddFile and RemoveFile.
+            fs::path canonicalFilePath = fs::canonical(entry.path(), error);
+            if (error.value() != HSCPP_ERROR_SUCCESS)
+            {
+                continue;
+            }
+
+            std::string relativePath = Normalize(entry.path().lexically_relative(directory.canonicalPath));
+            directory.canonicalFilePathByRelativePath[relativePath] = canonicalFilePath;
+        }
+    }
+
+    bool IncludeIndex::GetRelativePath(const Directory& directory,
+            const fs::path& canonicalFilePath, std::string& relativePath)
+    {
+        if (directory.canonicalPath.empty())
+        {
+            return false;
+        }
+
+        fs::path relativeFilePath = canonicalFilePath.lexically_relative(directory.canonicalPath);
+        if (relativeFilePath.empty())
+        {
+            return false;
+        }
+
+        relativePath = Normalize(relativeFilePath);
+        return !IsOutsideDirectory(relativeFilePath.lexically_normal());
+    }
+
+    bool IncludeIndex::IsOutsideDirectory(const fs::path& normalizedRelativePath)
+    {
+        // Compare the first element, such that a file named "..config.h" is not mistaken for a parent.
+        return !normalizedRelativePath.empty() && *normalizedRelativePath.begin() == "..";
+    }
+
+    std::string IncludeIndex::Normalize(const fs::path& path)
+    {
+        std::string normalizedPath = path.lexically_normal().generic_u8string();
+
+#if defined(HSCPP_PLATFORM_WIN32)
+        // Paths on Windows are case-insensitive.
+        std::transform(normalizedPath.begin(), normalizedPath.end(), normalizedPath.begin(), ::tolower);
+#endif
+
+        return normalizedPath;
+    }
+
+}
@@ -2,14 +2,21 @@
 #include <sstream>
 #include <algorithm>
 #include <cassert>
+#include <thread>
+#include <atomic>
+#include <functional>
 
 #include "hscpp/preprocessor/Preprocessor.h"
 #include "hscpp/preprocessor/Ast.h"
 #include "hscpp/Log.h"
+#include "hscpp/Util.h"
 
 namespace hscpp
 {
 
+    // Spawning a thread is not free, so avoid starting workers that would only process a few files.
+    const static size_t MIN_FILES_PER_WORKER = 4;
+
     bool Preprocessor::Preprocess(const std::vector<fs::path>& canonicalFilePaths, IPreprocessor::Output& output)
     {
         Reset(output);
@@ -61,51 +68,96 @@ namespace hscpp
     void Preprocessor::ClearDependencyGraph()
     {
         m_DependencyGraph.Clear();
+        m_IncludeIndex.Clear();
+
+        m_SemanticHashByFilePath.clear();
+        m_PendingSemanticHashByFilePath.clear();
+        m_SemanticallyUnchangedFilePaths.clear();
     }
 
     void Preprocessor::UpdateDependencyGraph(const std::vector<fs::path>& canonicalModifiedFilePaths,
             const std::vector<fs::path>& canonicalRemovedFilePaths,
             const std::vector<fs::path>& includeDirectoryPaths)
     {
+        m_IncludeIndex.SetIncludeDirectories(includeDirectoryPaths);
+        m_SemanticallyUnchangedFilePaths.clear();
+
         for (const auto& filePath : canonicalRemovedFilePaths)
         {
+            m_IncludeIndex.RemoveFile(filePath);
             m_DependencyGraph.RemoveFile(filePath);
+            m_SemanticHashByFilePath.erase(filePath);
+            m_PendingSemanticHashByFilePath.erase(filePath);
         }
 
+        // Index all files before processing, as a modified file may include a newly added file.
         for (const auto& filePath : canonicalModifiedFilePaths)
         {
-            Interpreter::Result result;
-            if (Process(filePath, result))
+            m_IncludeIndex.AddFile(filePath);
+        }
+
+        std::vector<FileResult> fileResults;
+        ProcessAll(canonicalModifiedFilePaths, fileResults);
+
+        for (size_t i = 0; i < canonicalModifiedFilePaths.size(); ++i)
+        {
+            if (fileResults.at(i).bSuccess)
             {
-                std::vector<fs::path> canonicalIncludePaths;
+                const fs::path& filePath = canonicalModifiedFilePaths.at(i);
+                const Interpreter::Result& result = fileResults.at(i).result;
 
+                std::vector<fs::path> canonicalIncludePaths;
                 for (const auto& include : result.includePaths)
                 {
-                    fs::path includePath = fs::u8path(include);
-                    for (const auto& includeDirectoryPath : includeDirectoryPaths)
-                    {
-                        // For example, the includePath may be "MathUtil.h", but we want to find the
-                        // full path for creating the dependency graph. Iterate through our include
-                        // directories to find the folder that contains a matching include.
-                        fs::path fullIncludePath = includeDirectoryPath / includePath;
-                        if (fs::exists(fullIncludePath))
-                        {
-                            std::error_code error;
-                            fullIncludePath = fs::canonical(fullIncludePath, error);
-                            if (error.value() == HSCPP_ERROR_SUCCESS)
-                            {
-                                canonicalIncludePaths.push_back(fullIncludePath);
-                            }
-                        }
-                    }
+                    m_IncludeIndex.Resolve(include, canonicalIncludePaths);
                 }
 
                 m_DependencyGraph.SetLinkedModules(filePath, result.hscppModules);
                 m_DependencyGraph.SetFileDependencies(filePath, canonicalIncludePaths);
+
+                uint64_t semanticHash = fileResults.at(i).semanticHash;
+
+                // Compare against the last built contents, rather than the last seen contents. If a
+                // build fails, a later comment-only edit must still rebuild the earlier change.
+                auto it = m_SemanticHashByFilePath.find(filePath);
+                if (it == m_SemanticHashByFilePath.end())
+                {
+                    // First time the file is seen, so its contents are assumed to be built.
+                    m_SemanticHashByFilePath[filePath] = semanticHash;
+                }
+                else if (it->second == semanticHash)
+                {
+                    m_SemanticallyUnchangedFilePaths.insert(filePath);
+                    m_PendingSemanticHashByFilePath.erase(filePath);
+                }
+                else
+                {
+                    m_PendingSemanticHashByFilePath[filePath] = semanticHash;
+                }
             }
         }
     }
 
+    bool Preprocessor::HasSemanticChanges(const fs::path& canonicalFilePath)
+    {
+        return m_SemanticallyUnchangedFilePaths.find(canonicalFilePath) == m_SemanticallyUnchangedFilePaths.end();
+    }
+
+    void Preprocessor::CommitSemanticHashes()
+    {
+        for (const auto& filePath__semanticHash : m_PendingSemanticHashByFilePath)
+        {
+            m_SemanticHashByFilePath[filePath__semanticHash.first] = filePath__semanticHash.second;
+        }
+
+        m_PendingSemanticHashByFilePath.clear();
+    }
+
+    DependencyGraph* Preprocessor::GetDependencyGraph()
+    {
+        return &m_DependencyGraph;
+    }
+
     void Preprocessor::Reset(Output& output)
     {
         output = Output();
@@ -133,22 +185,43 @@ namespace hscpp
 
     void Preprocessor::AddDependentFilePaths(std::unordered_set<fs::path, FsPathHasher>& filePaths)
     {
-        std::unordered_set<fs::path, FsPathHasher> dependentPaths;
+        std::vector<fs::path> rootFilePaths;
         for (const auto& filePath : filePaths)
         {
-            std::vector<fs::path> dependentFilePaths = m_DependencyGraph.ResolveGraph(filePath);
-            dependentPaths.insert(dependentFilePaths.begin(), dependentFilePaths.end());
+            // Skip headers that only had comment or whitespace changes. Source files are still
+            // resolved, as the modules they depend on must be linked in.
+            if (util::IsHeaderFile(filePath)
+                && m_SemanticallyUnchangedFilePaths.find(filePath) != m_SemanticallyUnchangedFilePaths.end())
+            {
+                log::Info() << HSCPP_LOG_PREFIX << "Skipping dependents of " << filePath
+                    << ", as it has no semantic changes." << log::End();
+                continue;
+            }
+
+            rootFilePaths.push_back(filePath);
         }
 
-        filePaths.insert(dependentPaths.begin(), dependentPaths.end());
+        std::vector<fs::path> dependentFilePaths = m_DependencyGraph.ResolveGraph(rootFilePaths);
+
+        filePaths.insert(dependentFilePaths.begin(), dependentFilePaths.end());
     }
 
     bool Preprocessor::Preprocess(const std::unordered_set<fs::path, FsPathHasher>& filePaths)
     {
-        for (const auto& filePath : filePaths)
+        // Sort paths, so that results are merged in the same order regardless of which worker
+        // finished first.
+        std::vector<fs::path> sortedFilePaths(filePaths.begin(), filePaths.end());
+        std::sort(sortedFilePaths.begin(), sortedFilePaths.end());
+
+        std::vector<FileResult> fileResults;
+        ProcessAll(sortedFilePaths, fileResults);
+
+        for (size_t i = 0; i < sortedFilePaths.size(); ++i)
         {
-            Interpreter::Result result;
-            if (!Process(filePath, result))
+            const fs::path& filePath = sortedFilePaths.at(i);
+            const Interpreter::Result& result = fileResults.at(i).result;
+
+            if (!fileResults.at(i).bSuccess)
             {
                 log::Error() << HSCPP_LOG_PREFIX << "Failed to process file " << filePath << log::End(".");
                 return false;
@@ -173,38 +246,98 @@ namespace hscpp
         return true;
     }
 
-    bool Preprocessor::Process(const fs::path& filePath, Interpreter::Result& result)
+    void Preprocessor::ProcessAll(const std::vector<fs::path>& filePaths, std::vector<FileResult>& fileResults)
     {
+        fileResults = std::vector<FileResult>(filePaths.size());
+
+        size_t nHardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+        size_t nWorkers = (filePaths.size() + MIN_FILES_PER_WORKER - 1) / MIN_FILES_PER_WORKER;
+        nWorkers = std::max<size_t>(1, std::min(nWorkers, nHardwareThreads));
+
+        while (m_Workers.size() < nWorkers)
+        {
+            m_Workers.push_back(std::unique_ptr<Worker>(new Worker()));
+        }
+
+        // Each worker claims the next unprocessed file. Results are written to the file's own slot,
+        // so no further synchronization is needed.
+        std::atomic<size_t> iNextFile(0);
+
+        auto work = [&](Worker& worker) {
+            for (size_t iFile = iNextFile++; iFile < filePaths.size(); iFile = iNextFile++)
+            {
+                FileResult& fileResult = fileResults.at(iFile);
+                fileResult.bSuccess = Process(filePaths.at(iFile), worker, fileResult);
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < nWorkers; ++i)
+        {
+            threads.emplace_back(work, std::ref(*m_Workers.at(i)));
+        }
+
+        // The calling thread acts as the first worker.
+        work(*m_Workers.at(0));
+
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        for (const auto& fileResult : fileResults)
+        {
+            for (const auto& error : fileResult.errors)
+            {
+                log::Error() << error << log::End();
+            }
+        }
+    }
+
+    bool Preprocessor::Process(const fs::path& filePath, Worker& worker, FileResult& fileResult)
+    {
+        // Runs on a worker thread, so errors are collected rather than logged directly.
         std::ifstream ifs(filePath.u8string());
         if (!ifs.is_open())
         {
-            log::Error() << HSCPP_LOG_PREFIX << "Failed to open file "
-                << filePath << log::LastOsError() << log::End(".");
+            std::stringstream error;
+            error << HSCPP_LOG_PREFIX << "Failed to open file " << filePath
+                << "[" << platform::GetLastErrorString() << "].";
+            fileResult.errors.push_back(error.str());
             return false;
         }
 
         std::stringstream ss;
         ss << ifs.rdbuf();
 
-        if (!m_Lexer.Lex(ss.str(), m_Tokens))
+        std::string content = ss.str();
+        fileResult.semanticHash = worker.semanticHasher.Hash(content);
+
+        if (!worker.lexer.Lex(content, worker.tokens))
         {
-            log::Error() << HSCPP_LOG_PREFIX << "Failed to lex " << filePath << log::End(".");
-            log::Error() << m_Lexer.GetLastError().ToString() << log::End();
+            std::stringstream error;
+            error << HSCPP_LOG_PREFIX << "Failed to lex " << filePath << ".";
+            fileResult.errors.push_back(error.str());
+            fileResult.errors.push_back(worker.lexer.GetLastError().ToString());
             return false;
         }
 
         std::unique_ptr<Stmt> pRootStmt;
-        if (!m_Parser.Parse(m_Tokens, pRootStmt))
+        if (!worker.parser.Parse(worker.tokens, pRootStmt))
         {
-            log::Error() << HSCPP_LOG_PREFIX << "Failed to parse " << filePath << log::End(".");
-            log::Error() << m_Parser.GetLastError().ToString() << log::End();
+            std::stringstream error;
+            error << HSCPP_LOG_PREFIX << "Failed to parse " << filePath << ".";
+            fileResult.errors.push_back(error.str());
+            fileResult.errors.push_back(worker.parser.GetLastError().ToString());
             return false;
         }
 
-        if (!m_Interpreter.Evaluate(*pRootStmt, m_VarStore, result))
+        if (!worker.interpreter.Evaluate(*pRootStmt, m_VarStore, fileResult.result))
         {
-            log::Error() << HSCPP_LOG_PREFIX << "Failed to interpret " << filePath << log::End(".");
-            log::Error() << m_Interpreter.GetLastError().ToString() << log::End();
+            std::stringstream error;
+            error << HSCPP_LOG_PREFIX << "Failed to interpret " << filePath << ".";
+            fileResult.errors.push_back(error.str());
+            fileResult.errors.push_back(worker.interpreter.GetLastError().ToString());
             return false;
         }
 
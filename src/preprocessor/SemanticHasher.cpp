@@ -0,0 +1,242 @@
+#include <cctype>
+#include <algorithm>
+
+#include "hscpp/preprocessor/SemanticHasher.h"
+
+namespace hscpp
+{
+
+    // 64-bit FNV-1a.
+    const static uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+    const static uint64_t FNV_PRIME = 1099511628211ull;
+
+    // Maximum length of a raw string delimiter, as defined by the standard.
+    const static size_t MAX_RAW_STRING_DELIMITER_LENGTH = 16;
+
+    uint64_t SemanticHasher::Hash(const std::string& content)
+    {
+        Reset(content);
+
+        while (!IsAtEnd())
+        {
+            char c = Peek();
+
+            if (c == '/' && PeekNext() == '/')
+            {
+                SkipLineComment();
+            }
+            else if (c == '/' && PeekNext() == '*')
+            {
+                SkipBlockComment();
+            }
+            else if (std::isspace(static_cast<unsigned char>(c)))
+            {
+                AddSeparator(c == '\n' ? '\n' : ' ');
+                ++m_iChar;
+            }
+            else if (c == '"')
+            {
+                if (!HashRawString())
+                {
+                    HashLiteral('"');
+                }
+            }
+            else if (c == '\'' && !IsDigitSeparator())
+            {
+                HashLiteral('\'');
+            }
+            else
+            {
+                HashChar(c);
+                ++m_iChar;
+            }
+        }
+
+        return m_Hash;
+    }
+
+    void SemanticHasher::Reset(const std::string& content)
+    {
+        m_pContent = &content;
+        m_iChar = 0;
+
+        m_Hash = FNV_OFFSET_BASIS;
+        m_PendingSeparator = 0;
+        m_bHashedChar = false;
+    }
+
+    void SemanticHasher::SkipLineComment()
+    {
+        // The terminating newline is left to be handled as whitespace.
+        while (!IsAtEnd() && Peek() != '\n')
+        {
+            if (Peek() == '\\' && PeekNext() == '\n')
+            {
+                // Line continuation continues the comment.
+                ++m_iChar;
+            }
+
+            ++m_iChar;
+        }
+
+        AddSeparator(' ');
+    }
+
+    void SemanticHasher::SkipBlockComment()
+    {
+        m_iChar += 2; // Skip '/*'.
+
+        bool bNewline = false;
+        while (!IsAtEnd() && !(Peek() == '*' && PeekNext() == '/'))
+        {
+            bNewline |= (Peek() == '\n');
+            ++m_iChar;
+        }
+
+        m_iChar = std::min(m_iChar + 2, m_pContent->size()); // Skip '*/'.
+        AddSeparator(bNewline ? '\n' : ' ');
+    }
+
+    void SemanticHasher::HashLiteral(char endChar)
+    {
+        HashChar(Peek());
+        ++m_iChar;
+
+        while (!IsAtEnd() && Peek() != endChar && Peek() != '\n')
+        {
+            if (Peek() == '\\')
+            {
+                // Escaped character, which may be the end character or a newline.
+                HashChar(Peek());
+                ++m_iChar;
+
+                if (IsAtEnd())
+                {
+                    break;
+                }
+            }
+
+            HashChar(Peek());
+            ++m_iChar;
+        }
+
+        if (!IsAtEnd() && Peek() == endChar)
+        {
+            HashChar(endChar);
+            ++m_iChar;
+        }
+    }
+
+    bool SemanticHasher::HashRawString()
+    {
+        // Raw strings may contain unescaped quotes, so they must be matched to avoid treating their
+        // contents as code. The R prefix has already been hashed as part of an identifier.
+        std::string prefix = GetPrecedingIdentifier();
+        if (prefix != "R" && prefix != "u8R" && prefix != "uR" && prefix != "UR" && prefix != "LR")
+        {
+            return false;
+        }
+
+        size_t iOpenParen = m_iChar + 1;
+        while (iOpenParen < m_pContent->size() && iOpenParen - m_iChar - 1 <= MAX_RAW_STRING_DELIMITER_LENGTH)
+        {
+            char c = m_pContent->at(iOpenParen);
+            if (c == '(' || c == ')' || c == '\\' || std::isspace(static_cast<unsigned char>(c)))
+            {
+                break;
+            }
+
+            ++iOpenParen;
+        }
+
+        if (iOpenParen >= m_pContent->size() || m_pContent->at(iOpenParen) != '(')
+        {
+            return false;
+        }
+
+        std::string delimiter = m_pContent->substr(m_iChar + 1, iOpenParen - m_iChar - 1);
+        std::string terminator = ")" + delimiter + "\"";
+
+        size_t iTerminator = m_pContent->find(terminator, iOpenParen + 1);
+        size_t iEnd = (iTerminator == std::string::npos)
+                ? m_pContent->size() : iTerminator + terminator.size();
+
+        for (; m_iChar < iEnd; ++m_iChar)
+        {
+            HashChar(Peek());
+        }
+
+        return true;
+    }
+
+    bool SemanticHasher::IsDigitSeparator()
+    {
+        // A quote within a number literal (ex. 1'000'000) is a digit separator, rather than the start
+        // of a character literal. Prefixed character literals like u8'a' start with a letter.
+        std::string precedingIdentifier = GetPrecedingIdentifier();
+        return !precedingIdentifier.empty()
+            && std::isdigit(static_cast<unsigned char>(precedingIdentifier.front()));
+    }
+
+    std::string SemanticHasher::GetPrecedingIdentifier()
+    {
+        size_t iStart = m_iChar;
+        while (iStart > 0)
+        {
+            char c = m_pContent->at(iStart - 1);
+            if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_' && c != '\'' && c != '.')
+            {
+                break;
+            }
+
+            --iStart;
+        }
+
+        return m_pContent->substr(iStart, m_iChar - iStart);
+    }
+
+    void SemanticHasher::HashChar(char c)
+    {
+        if (m_PendingSeparator != 0 && m_bHashedChar)
+        {
+            m_Hash ^= static_cast<uint8_t>(m_PendingSeparator);
+            m_Hash *= FNV_PRIME;
+        }
+
+        m_PendingSeparator = 0;
+        m_bHashedChar = true;
+
+        m_Hash ^= static_cast<uint8_t>(c);
+        m_Hash *= FNV_PRIME;
+    }
+
+    void SemanticHasher::AddSeparator(char separator)
+    {
+        // Newlines take precedence, as they end preprocessor directives.
+        if (m_PendingSeparator != '\n')
+        {
+            m_PendingSeparator = separator;
+        }
+    }
+
+    bool SemanticHasher::IsAtEnd()
+    {
+        return m_iChar >= m_pContent->size();
+    }
+
+    char SemanticHasher::Peek()
+    {
+        return m_pContent->at(m_iChar);
+    }
+
+    char SemanticHasher::PeekNext()
+    {
+        if (m_iChar + 1 >= m_pContent->size())
+        {
+            return '\0';
+        }
+
+        return m_pContent->at(m_iChar + 1);
+    }
+
+}
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include "common/Util.h"
 #include "common/Macros.h"
+#include "common/SharedState.h"
 #include "common/Typedefs.h"
 #include "common/UpdateLoop.h"
 #include "common/Validation.h"
\ No newline at end of file
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <mutex>
+
+#include "hscpp/module/ModuleSharedState.h"
+
+namespace hscpp { namespace test
+{
+
+    // Saves hscpp's ModuleSharedState on construction, and restores it on destruction. Tests may
+    // point the shared state at local objects, which is undone even if a REQUIRE fails.
+    class ScopedSharedState
+    {
+    public:
+        ScopedSharedState();
+        ~ScopedSharedState();
+
+        ScopedSharedState(const ScopedSharedState& rhs) = delete;
+        ScopedSharedState& operator=(const ScopedSharedState& rhs) = delete;
+
+    private:
+        bool* m_pbSwapping = nullptr;
+        std::unordered_map<uint64_t, std::vector<ITracker*>>* m_pTrackersByKey = nullptr;
+        std::unordered_map<uint64_t, CompactTrackerTable>* m_pCompactTrackersByKey = nullptr;
+        std::unordered_map<uint64_t, IConstructor*>* m_pConstructorsByKey = nullptr;
+        const uint64_t* m_pConstructorsGeneration = nullptr;
+        IAllocator* m_pAllocator = nullptr;
+        std::recursive_mutex* m_pTrackerMutex = nullptr;
+    };
+
+}}
\ No newline at end of file
@@ -0,0 +1,28 @@
+#include "common/SharedState.h"
+
+namespace hscpp { namespace test
+{
+
+    ScopedSharedState::ScopedSharedState()
+    {
+        m_pbSwapping = ModuleSharedState::s_pbSwapping;
+        m_pTrackersByKey = ModuleSharedState::s_pTrackersByKey;
+        m_pCompactTrackersByKey = ModuleSharedState::s_pCompactTrackersByKey;
+        m_pConstructorsByKey = ModuleSharedState::s_pConstructorsByKey;
+        m_pConstructorsGeneration = ModuleSharedState::s_pConstructorsGeneration;
+        m_pAllocator = ModuleSharedState::s_pAllocator;
+        m_pTrackerMutex = ModuleSharedState::s_pTrackerMutex;
+    }
+
+    ScopedSharedState::~ScopedSharedState()
+    {
+        ModuleSharedState::s_pbSwapping = m_pbSwapping;
+        ModuleSharedState::s_pTrackersByKey = m_pTrackersByKey;
+        ModuleSharedState::s_pCompactTrackersByKey = m_pCompactTrackersByKey;
+        ModuleSharedState::s_pConstructorsByKey = m_pConstructorsByKey;
+        ModuleSharedState::s_pConstructorsGeneration = m_pConstructorsGeneration;
+        ModuleSharedState::s_pAllocator = m_pAllocator;
+        ModuleSharedState::s_pTrackerMutex = m_pTrackerMutex;
+    }
+
+}}
\ No newline at end of file
@@ -14,6 +14,7 @@ hscpp::fs::path TEST_PATH = hscpp::util::GetHscppTestPath() / "integration-tests
 int main()
 {
     hscpp::Hotswapper swapper;
+    swapper.EnableFeature(hscpp::Feature::UnloadModules);
 
     swapper.AddIncludeDirectory(SANDBOX_PATH / "include");
     swapper.AddIncludeDirectory(TEST_PATH / "integration-test-log" / "include");
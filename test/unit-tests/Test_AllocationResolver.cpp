@@ -0,0 +1,139 @@
+#include <thread>
+
+#include "catch/catch.hpp"
+#include "common/Common.h"
+#include "hscpp/module/Tracker.h"
+#include "hscpp/module/AllocationResolver.h"
+
+namespace hscpp { namespace test
+{
+
+#ifndef HSCPP_DISABLE
+
+    struct Resolved
+    {
+        HSCPP_TRACK(Resolved, "Resolved");
+    };
+
+    // Counts allocations, to find which constructor was used.
+    class CountingConstructor : public Constructor<Resolved>
+    {
+    public:
+        int nAllocations = 0;
+
+        AllocationInfo Allocate() override
+        {
+            ++nAllocations;
+            return Constructor<Resolved>::Allocate();
+        }
+    };
+
+    TEST_CASE("AllocationResolver caches constructors until they are patched.")
+    {
+        std::unordered_map<uint64_t, std::vector<ITracker*>> trackersByKey;
+        std::unordered_map<uint64_t, IConstructor*> constructorsByKey;
+        uint64_t generation = 1;
+
+        ScopedSharedState sharedState;
+
+        ModuleSharedState::s_pTrackersByKey = &trackersByKey;
+        ModuleSharedState::s_pConstructorsByKey = &constructorsByKey;
+        ModuleSharedState::s_pConstructorsGeneration = &generation;
+
+        uint64_t keyHash = decltype(Resolved::hscpp_ClassKey)::hash;
+
+        CountingConstructor oldConstructor;
+        CountingConstructor newConstructor;
+        constructorsByKey[keyHash] = &oldConstructor;
+
+        AllocationResolver resolver;
+        delete resolver.Allocate<Resolved>();
+        REQUIRE(oldConstructor.nAllocations == 1);
+
+        // The cached constructor is used until the generation changes.
+        constructorsByKey[keyHash] = &newConstructor;
+        delete resolver.Allocate<Resolved>();
+        REQUIRE(oldConstructor.nAllocations == 2);
+        REQUIRE(newConstructor.nAllocations == 0);
+
+        ++generation;
+        delete resolver.Allocate<Resolved>();
+        delete resolver.Allocate<Resolved>();
+        REQUIRE(oldConstructor.nAllocations == 2);
+        REQUIRE(newConstructor.nAllocations == 2);
+
+        // Removed constructors are not used once the generation changes.
+        constructorsByKey.clear();
+        ++generation;
+        REQUIRE(resolver.Allocate<Resolved>() == nullptr);
+
+        REQUIRE(trackersByKey[keyHash].empty());
+    }
+
+    TEST_CASE("AllocationResolver can allocate tracked types from several threads.")
+    {
+        std::unordered_map<uint64_t, std::vector<ITracker*>> trackersByKey;
+        std::unordered_map<uint64_t, IConstructor*> constructorsByKey;
+        std::recursive_mutex trackerMutex;
+        uint64_t generation = 1;
+
+        ScopedSharedState sharedState;
+
+        ModuleSharedState::s_pTrackersByKey = &trackersByKey;
+        ModuleSharedState::s_pConstructorsByKey = &constructorsByKey;
+        ModuleSharedState::s_pConstructorsGeneration = &generation;
+        ModuleSharedState::s_pTrackerMutex = &trackerMutex;
+
+        uint64_t keyHash = decltype(Resolved::hscpp_ClassKey)::hash;
+
+        CountingConstructor oldConstructor;
+        CountingConstructor newConstructor;
+        constructorsByKey[keyHash] = &oldConstructor;
+
+        size_t nThreads = 4;
+        size_t nObjects = 2000;
+
+        AllocationResolver resolver;
+        std::vector<std::thread> threads;
+        for (size_t iThread = 0; iThread < nThreads; ++iThread)
+        {
+            threads.emplace_back([&]() {
+                std::vector<Resolved*> objects;
+                for (size_t i = 0; i < nObjects; ++i)
+                {
+                    objects.push_back(resolver.Allocate<Resolved>());
+
+                    // Free every other object, so that trackers are moved between slots.
+                    if (i % 2 == 1)
+                    {
+                        delete objects.at(i - 1);
+                        objects.at(i - 1) = nullptr;
+                    }
+                }
+
+                for (Resolved* pObject : objects)
+                {
+                    delete pObject;
+                }
+            });
+        }
+
+        // Patch the constructor while other threads allocate, as done by a runtime swap.
+        {
+            std::lock_guard<std::recursive_mutex> lock(trackerMutex);
+            constructorsByKey[keyHash] = &newConstructor;
+            ++generation;
+        }
+
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+
+        REQUIRE(oldConstructor.nAllocations + newConstructor.nAllocations == static_cast<int>(nThreads * nObjects));
+        REQUIRE(trackersByKey[keyHash].empty());
+    }
+
+#endif
+
+}}
\ No newline at end of file
@@ -0,0 +1,35 @@
+#include "catch/catch.hpp"
+#include "hscpp/module/CompileTimeString.h"
+
+// Pack a key into a compile_time::String, as done by HSCPP_TRACK.
+#define TEST_SEGMENT(key, i) hscpp::compile_time::StringSegmentToIntegral(key, i, hscpp::compile_time::Strlen(key))
+#define TEST_STRING(key) hscpp::compile_time::String< \
+    TEST_SEGMENT(key, 0), TEST_SEGMENT(key, 1), TEST_SEGMENT(key, 2), TEST_SEGMENT(key, 3), \
+    TEST_SEGMENT(key, 4), TEST_SEGMENT(key, 5), TEST_SEGMENT(key, 6), TEST_SEGMENT(key, 7), \
+    TEST_SEGMENT(key, 8), TEST_SEGMENT(key, 9), TEST_SEGMENT(key, 10), TEST_SEGMENT(key, 11), \
+    TEST_SEGMENT(key, 12), TEST_SEGMENT(key, 13), TEST_SEGMENT(key, 14), TEST_SEGMENT(key, 15)>
+
+namespace hscpp { namespace test
+{
+
+    TEST_CASE("compile_time::String hashes match runtime hashes.")
+    {
+        typedef TEST_STRING("Printer") PrinterKey;
+        typedef TEST_STRING("ExactlyEightByt") FifteenByteKey;
+        typedef TEST_STRING("ExactlyEightByte") SixteenByteKey;
+
+        // Hash is usable as a compile-time constant.
+        static_assert(PrinterKey::hash == compile_time::HashKey("Printer"), "Hash must be constexpr.");
+
+        REQUIRE(std::string(PrinterKey().ToString()) == "Printer");
+
+        REQUIRE(PrinterKey::hash == compile_time::HashKey(PrinterKey().ToString()));
+        REQUIRE(FifteenByteKey::hash == compile_time::HashKey("ExactlyEightByt"));
+        REQUIRE(SixteenByteKey::hash == compile_time::HashKey("ExactlyEightByte"));
+
+        REQUIRE(PrinterKey::hash != compile_time::HashKey("Printer2"));
+        REQUIRE(FifteenByteKey::hash != SixteenByteKey::hash);
+        REQUIRE(compile_time::HashKey("") == compile_time::FNV_OFFSET_BASIS);
+    }
+
+}}
\ No newline at end of file
@@ -1,3 +1,6 @@
+#include <algorithm>
+#include <sstream>
+
 #include "catch/catch.hpp"
 #include "common/Common.h"
 
@@ -161,4 +164,318 @@ namespace hscpp { namespace test {
         });
     }
 
+    TEST_CASE("DependencyGraph can resolve multiple files at once.")
+    {
+        DependencyGraph graph;
+
+        fs::path childCpp = "child.cpp";
+        fs::path parent1H = "parent1.h";
+        fs::path parent1Cpp = "parent1.cpp";
+        fs::path parent2H = "parent2.h";
+        fs::path parent2Cpp = "parent2.cpp";
+        fs::path unrelatedCpp = "unrelated.cpp";
+
+        graph.SetFileDependencies(childCpp, { parent1H, parent2H });
+        graph.SetFileDependencies(parent1Cpp, { parent1H });
+        graph.SetFileDependencies(parent2Cpp, { parent2H });
+        graph.SetFileDependencies(unrelatedCpp, {});
+
+        graph.SetLinkedModules(parent1H, { "module" });
+        graph.SetLinkedModules(parent2Cpp, { "module" });
+
+        std::vector<fs::path> paths = { childCpp, parent2H, unrelatedCpp };
+
+        std::vector<fs::path> expected;
+        for (const auto& path : paths)
+        {
+            std::vector<fs::path> resolved = graph.ResolveGraph(path);
+            for (const auto& resolvedPath : resolved)
+            {
+                if (std::find(expected.begin(), expected.end(), resolvedPath) == expected.end())
+                {
+                    expected.push_back(resolvedPath);
+                }
+            }
+        }
+
+        CALL(ValidateUnorderedVector, graph.ResolveGraph(paths), expected);
+        CALL(ValidateUnorderedVector, expected, {
+            childCpp,
+            parent2Cpp,
+            unrelatedCpp,
+        });
+    }
+
+    TEST_CASE("DependencyGraph can handle deep graphs.")
+    {
+        DependencyGraph graph;
+
+        // Create a long include chain, with enough edits that the graph will be compacted.
+        const int nHeaders = 100000;
+
+        for (int i = 0; i < nHeaders - 1; ++i)
+        {
+            graph.SetFileDependencies("header" + std::to_string(i) + ".h",
+                { "header" + std::to_string(i + 1) + ".h" });
+        }
+
+        fs::path mainCpp = "main.cpp";
+        fs::path leafCpp = "leaf.cpp";
+        fs::path leafH = "header" + std::to_string(nHeaders - 1) + ".h";
+
+        graph.SetFileDependencies(mainCpp, { "header0.h" });
+        graph.SetFileDependencies(leafCpp, { leafH });
+
+        graph.SetLinkedModules(leafH, { "module" });
+        graph.SetLinkedModules(leafCpp, { "module" });
+
+        CALL(ValidateUnorderedVector, graph.ResolveGraph(mainCpp), {
+            mainCpp,
+            leafCpp,
+        });
+
+        CALL(ValidateUnorderedVector, graph.ResolveGraph(leafH), {
+            mainCpp,
+            leafCpp,
+        });
+
+        // Break the chain in the middle.
+        graph.RemoveFile("header50000.h");
+
+        CALL(ValidateUnorderedVector, graph.ResolveGraph(mainCpp), {
+            mainCpp,
+        });
+
+        CALL(ValidateUnorderedVector, graph.ResolveGraph(leafH), {
+            leafCpp,
+        });
+    }
+
+    TEST_CASE("DependencyGraph keeps many resolved graphs up to date.")
+    {
+        DependencyGraph graph;
+
+        // Enough sources that invalidating them leaves many stale entries behind.
+        const int nSources = 2000;
+
+        fs::path sharedH = "shared.h";
+        fs::path extraH = "extra.h";
+        fs::path extraCpp = "extra.cpp";
+
+        graph.SetFileDependencies(extraCpp, { extraH });
+        graph.SetLinkedModules(extraH, { "extra" });
+        graph.SetLinkedModules(extraCpp, { "extra" });
+
+        std::vector<fs::path> sourcePaths;
+        for (int i = 0; i < nSources; ++i)
+        {
+            std::string name = "source" + std::to_string(i);
+            sourcePaths.push_back(name + ".cpp");
+            graph.SetFileDependencies(sourcePaths.back(), { sharedH, name + ".h" });
+        }
+
+        for (int iEdit = 0; iEdit < 4; ++iEdit)
+        {
+            bool bExtra = (iEdit % 2 == 1);
+            graph.SetFileDependencies(sharedH, bExtra ? std::vector<fs::path>{ extraH } : std::vector<fs::path>{});
+
+            for (int i = 0; i < nSources; ++i)
+            {
+                std::vector<fs::path> resolvedPaths = graph.ResolveGraph(sourcePaths.at(i));
+                REQUIRE(resolvedPaths.size() == (bExtra ? 2 : 1));
+            }
+
+            // Editing an unshared header only affects the graph of its source.
+            graph.SetFileDependencies("source0.h", { extraH });
+            CALL(ValidateUnorderedVector, graph.ResolveGraph(sourcePaths.at(0)), { sourcePaths.at(0), extraCpp });
+            REQUIRE(graph.ResolveGraph(sourcePaths.at(1)).size() == (bExtra ? 2 : 1));
+            graph.SetFileDependencies("source0.h", {});
+        }
+
+        // Resolve more graphs than the cache holds, and check them after an edit.
+        std::vector<fs::path> chainPaths;
+        for (int i = 0; i < 100000; ++i)
+        {
+            chainPaths.push_back("chain" + std::to_string(i) + ".h");
+        }
+
+        for (size_t i = 0; i + 1 < chainPaths.size(); ++i)
+        {
+            graph.SetFileDependencies(chainPaths.at(i), { chainPaths.at(i + 1) });
+        }
+
+        fs::path leafCpp = "leaf.cpp";
+        graph.SetLinkedModules(chainPaths.back(), { "leaf" });
+        graph.SetLinkedModules(leafCpp, { "leaf" });
+
+        std::vector<fs::path> chainSourcePaths;
+        for (int i = 0; i < 20; ++i)
+        {
+            chainSourcePaths.push_back("chain" + std::to_string(i) + ".cpp");
+            graph.SetFileDependencies(chainSourcePaths.back(), { chainPaths.at(i * 1000) });
+
+            CALL(ValidateUnorderedVector, graph.ResolveGraph(chainSourcePaths.back()), {
+                chainSourcePaths.back(),
+                leafCpp,
+            });
+        }
+
+        graph.RemoveFile(chainPaths.at(500));
+
+        CALL(ValidateUnorderedVector, graph.ResolveGraph(chainSourcePaths.at(0)), { chainSourcePaths.at(0) });
+        CALL(ValidateUnorderedVector, graph.ResolveGraph(chainSourcePaths.at(1)), {
+            chainSourcePaths.at(1),
+            leafCpp,
+        });
+    }
+
+    TEST_CASE("DependencyGraph updates resolved graphs when the graph changes.")
+    {
+        DependencyGraph graph;
+
+        fs::path mainCpp = "main.cpp";
+        fs::path libH = "lib.h";
+        fs::path libCpp = "lib.cpp";
+        fs::path otherH = "other.h";
+        fs::path otherCpp = "other.cpp";
+
+        graph.SetFileDependencies(mainCpp, { libH });
+        graph.SetFileDependencies(libCpp, { libH });
+        graph.SetFileDependencies(otherCpp, { otherH });
+
+        graph.SetLinkedModules(libH, { "lib" });
+        graph.SetLinkedModules(libCpp, { "lib" });
+
+        CALL(ValidateUnorderedVector, graph.ResolveGraph(mainCpp), { mainCpp, libCpp });
+        CALL(ValidateUnorderedVector, graph.ResolveGraph(otherH), {});
+
+        // Setting identical dependencies and modules does not change the result.
+        graph.SetFileDependencies(mainCpp, { libH });
+        graph.SetLinkedModules(libH, { "lib" });
+        CALL(ValidateUnorderedVector, graph.ResolveGraph(mainCpp), { mainCpp, libCpp });
+
+        // Changing dependencies of a file affects graphs that include it.
+        graph.SetFileDependencies(mainCpp, { libH, otherH });
+        graph.SetLinkedModules(otherH, { "other" });
+        graph.SetLinkedModules(otherCpp, { "other" });
+
+        CALL(ValidateUnorderedVector, graph.ResolveGraph(mainCpp), { mainCpp, libCpp, otherCpp });
+        CALL(ValidateUnorderedVector, graph.ResolveGraph(otherH), { mainCpp, libCpp, otherCpp });
+
+        // Changing the modules of a file affects graphs that see the old or new module.
+        graph.SetLinkedModules(otherCpp, { "lib" });
+
+        CALL(ValidateUnorderedVector, graph.ResolveGraph(mainCpp), { mainCpp, libCpp, otherCpp });
+        CALL(ValidateUnorderedVector, graph.ResolveGraph(otherH), { mainCpp, libCpp, otherCpp });
+
+        graph.SetLinkedModules(otherCpp, {});
+
+        CALL(ValidateUnorderedVector, graph.ResolveGraph(mainCpp), { mainCpp, libCpp });
+        CALL(ValidateUnorderedVector, graph.ResolveGraph(otherH), { mainCpp, libCpp, otherCpp });
+
+        // Removing a file affects graphs that reach it.
+        graph.RemoveFile(libH);
+
+        CALL(ValidateUnorderedVector, graph.ResolveGraph(mainCpp), { mainCpp });
+        CALL(ValidateUnorderedVector, graph.ResolveGraph(libCpp), { libCpp });
+    }
+
+    TEST_CASE("DependencyGraph can explain and measure rebuilds.")
+    {
+        DependencyGraph graph;
+
+        fs::path childCpp = "child.cpp";
+        fs::path parent1H = "parent1.h";
+        fs::path parent1Cpp = "parent1.cpp";
+        fs::path parent2H = "parent2.h";
+        fs::path parent2Cpp = "parent2.cpp";
+
+        graph.SetFileDependencies(childCpp, { parent1H, parent2H });
+        graph.SetFileDependencies(parent1Cpp, { parent1H });
+        graph.SetFileDependencies(parent2Cpp, { parent2H });
+
+        graph.SetLinkedModules(parent1H, { "module" });
+        graph.SetLinkedModules(parent2Cpp, { "module" });
+
+        SECTION("Rebuilds are explained by include chains and module links.")
+        {
+            std::vector<DependencyGraph::Link> chain;
+
+            // child.cpp includes parent1.h, which is linked to parent2.cpp.
+            REQUIRE(graph.Explain(childCpp, parent2Cpp, chain));
+            REQUIRE(chain.size() == 3);
+            REQUIRE(chain.at(0).type == DependencyGraph::Link::Type::Root);
+            REQUIRE(chain.at(0).filePath == childCpp);
+            REQUIRE(chain.at(1).type == DependencyGraph::Link::Type::Dependency);
+            REQUIRE(chain.at(1).filePath == parent1H);
+            REQUIRE(chain.at(2).type == DependencyGraph::Link::Type::Module);
+            REQUIRE(chain.at(2).filePath == parent2Cpp);
+            REQUIRE(chain.at(2).module == "module");
+
+            // parent1.cpp includes parent1.h, which is a module.
+            REQUIRE(graph.Explain(parent1H, parent1Cpp, chain));
+            REQUIRE(chain.size() == 2);
+            REQUIRE(chain.at(1).type == DependencyGraph::Link::Type::Dependent);
+            REQUIRE(chain.at(1).filePath == parent1Cpp);
+
+            // parent2.h is not a module, so nothing is rebuilt.
+            REQUIRE_FALSE(graph.Explain(parent2H, childCpp, chain));
+            REQUIRE(chain.empty());
+        }
+
+        SECTION("Header stats are ordered by rebuild cost.")
+        {
+            // Without recorded durations, headers are ordered by the number of files they rebuild.
+            std::vector<DependencyGraph::FileStats> unrecordedStats = graph.GetHeaderStats();
+            REQUIRE(unrecordedStats.size() == 2);
+            REQUIRE(unrecordedStats.at(0).filePath == parent1H);
+            REQUIRE(unrecordedStats.at(0).rebuildCost == Approx(0));
+
+            graph.RecordCompileDuration(childCpp, 1);
+            graph.RecordCompileDuration(parent1Cpp, 2);
+
+            // parent2.cpp has no recorded duration, so it is assumed to take the average.
+            std::vector<DependencyGraph::FileStats> stats = graph.GetHeaderStats();
+            REQUIRE(stats.size() == 2);
+
+            REQUIRE(stats.at(0).filePath == parent1H);
+            REQUIRE(stats.at(0).nDirectDependents == 2);
+            REQUIRE(stats.at(0).nResolvedFiles == 3);
+            REQUIRE(stats.at(0).rebuildCost == Approx(4.5));
+
+            REQUIRE(stats.at(1).filePath == parent2H);
+            REQUIRE(stats.at(1).nDirectDependents == 2);
+            REQUIRE(stats.at(1).nResolvedFiles == 0);
+            REQUIRE(stats.at(1).rebuildCost == Approx(0));
+        }
+
+        SECTION("Querying stats of an unknown file does not add it to the graph.")
+        {
+            DependencyGraph::FileStats stats = graph.GetFileStats("unknown.h");
+            REQUIRE(stats.filePath == fs::path("unknown.h"));
+            REQUIRE(stats.nDirectDependents == 0);
+            REQUIRE(stats.nResolvedFiles == 0);
+            REQUIRE(stats.rebuildCost == Approx(0));
+
+            REQUIRE(graph.GetHeaderStats().size() == 2);
+
+            std::stringstream json;
+            graph.WriteJson(json);
+            REQUIRE(json.str().find("unknown.h") == std::string::npos);
+        }
+
+        SECTION("Graph can be written as JSON and DOT.")
+        {
+            std::stringstream json;
+            graph.WriteJson(json);
+            REQUIRE(json.str().find("\"path\": \"parent1.h\"") != std::string::npos);
+            REQUIRE(json.str().find("\"modules\": [\"module\"]") != std::string::npos);
+
+            std::stringstream dot;
+            graph.WriteDot(dot);
+            REQUIRE(dot.str().find("digraph") == 0);
+            REQUIRE(dot.str().find("[label=\"module\", shape=diamond]") != std::string::npos);
+        }
+    }
+
 }}
@@ -0,0 +1,110 @@
+#include "catch/catch.hpp"
+#include "common/Common.h"
+#include "hscpp/preprocessor/IncludeIndex.h"
+
+namespace hscpp { namespace test
+{
+
+    TEST_CASE("IncludeIndex can resolve includes across include directories.")
+    {
+        fs::path sandboxPath = CALL(CreateSandboxDirectory);
+
+        fs::path includeAPath = sandboxPath / "includeA";
+        fs::path includeBPath = sandboxPath / "includeB";
+
+        REQUIRE(fs::create_directories(includeAPath / "lib"));
+        REQUIRE(fs::create_directories(includeBPath));
+
+        CALL(NewFile, includeAPath / "lib" / "Lib.h", "");
+        CALL(NewFile, includeAPath / "Shared.h", "");
+        CALL(NewFile, includeBPath / "Shared.h", "");
+
+        IncludeIndex index;
+        index.SetIncludeDirectories({ includeAPath, includeBPath });
+
+        std::vector<fs::path> resolved;
+
+        SECTION("Includes resolve to canonical paths within each include directory.")
+        {
+            index.Resolve("lib/Lib.h", resolved);
+            CALL(ValidateOrderedVector, resolved, { CALL(Canonical, includeAPath / "lib" / "Lib.h") });
+
+            resolved.clear();
+            index.Resolve("./lib/../lib/Lib.h", resolved);
+            CALL(ValidateOrderedVector, resolved, { CALL(Canonical, includeAPath / "lib" / "Lib.h") });
+
+            resolved.clear();
+            index.Resolve("Shared.h", resolved);
+            CALL(ValidateOrderedVector, resolved, {
+                CALL(Canonical, includeAPath / "Shared.h"),
+                CALL(Canonical, includeBPath / "Shared.h"),
+            });
+        }
+
+        SECTION("Unresolved includes are found once the file is added.")
+        {
+            index.Resolve("New.h", resolved);
+            REQUIRE(resolved.empty());
+
+            CALL(NewFile, includeBPath / "New.h", "");
+            index.Resolve("New.h", resolved);
+            REQUIRE(resolved.empty()); // Negative cache is used until the index is notified.
+
+            fs::path canonicalNewFilePath = CALL(Canonical, includeBPath / "New.h");
+            index.AddFile(canonicalNewFilePath);
+            index.Resolve("New.h", resolved);
+            CALL(ValidateOrderedVector, resolved, { canonicalNewFilePath });
+        }
+
+        SECTION("Removed files are no longer resolved.")
+        {
+            fs::path canonicalLibFilePath = CALL(Canonical, includeAPath / "lib" / "Lib.h");
+
+            CALL(RemoveFile, canonicalLibFilePath);
+            index.RemoveFile(canonicalLibFilePath);
+
+            index.Resolve("lib/Lib.h", resolved);
+            REQUIRE(resolved.empty());
+        }
+
+        SECTION("Names beginning with two dots are within the include directory.")
+        {
+            CALL(NewFile, includeBPath / "..config.h", "");
+            fs::path canonicalFilePath = CALL(Canonical, includeBPath / "..config.h");
+
+            index.AddFile(canonicalFilePath);
+            index.Resolve("..config.h", resolved);
+            CALL(ValidateOrderedVector, resolved, { canonicalFilePath });
+        }
+    }
+
+#if !defined(HSCPP_PLATFORM_WIN32)
+
+    TEST_CASE("IncludeIndex follows symlinked directories.")
+    {
+        fs::path sandboxPath = CALL(CreateSandboxDirectory);
+
+        fs::path includePath = sandboxPath / "include";
+        fs::path externalPath = sandboxPath / "external";
+
+        REQUIRE(fs::create_directories(includePath));
+        REQUIRE(fs::create_directories(externalPath / "sub"));
+
+        CALL(NewFile, externalPath / "sub" / "External.h", "");
+
+        fs::create_directory_symlink(externalPath, includePath / "linked");
+
+        // Symlink to a parent directory, which must not be followed forever.
+        fs::create_directory_symlink(externalPath, externalPath / "sub" / "cycle");
+
+        IncludeIndex index;
+        index.SetIncludeDirectories({ includePath });
+
+        std::vector<fs::path> resolved;
+        index.Resolve("linked/sub/External.h", resolved);
+        CALL(ValidateOrderedVector, resolved, { CALL(Canonical, externalPath / "sub" / "External.h") });
+    }
+
+#endif
+
+}}
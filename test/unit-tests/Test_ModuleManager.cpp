@@ -0,0 +1,224 @@
+#include <memory>
+#include <string>
+
+#include "catch/catch.hpp"
+#include "common/Common.h"
+#include "hscpp/Platform.h"
+#include "hscpp/Util.h"
+#include "hscpp/Config.h"
+#include "hscpp/ModuleManager.h"
+#include "hscpp/compiler/ICompiler.h"
+#include "hscpp/module/Tracker.h"
+
+namespace hscpp { namespace test
+{
+
+#ifndef HSCPP_DISABLE
+
+    const static fs::path BUILD_DIRECTORY_PATH = util::GetHscppTestPath() / "test-module-builds";
+
+    // Compiled into a module, along with the module's shared state.
+    const static std::string WIDGET_SOURCE =
+        "#include \"hscpp/module/Tracker.h\"\n"
+        "\n"
+        "struct ModuleWidget\n"
+        "{\n"
+        "    HSCPP_TRACK_COMPACT(ModuleWidget, \"ModuleWidget\");\n"
+        "    ModuleWidget();\n"
+        "};\n"
+        "\n"
+        "ModuleWidget::ModuleWidget()\n"
+        "{}\n";
+
+    // Version 2 of MigratedV1, where a field was removed, a field was added, and the remaining
+    // fields were reordered. It is compiled into a module, as both versions share a key.
+    const static std::string MIGRATED_V2_SOURCE =
+        "#include <string>\n"
+        "#include <vector>\n"
+        "#include \"hscpp/module/Tracker.h\"\n"
+        "\n"
+        "struct Migrated\n"
+        "{\n"
+        "    HSCPP_TRACK(Migrated, \"Migrated\");\n"
+        "    HSCPP_FIELDS(added, name, count)\n"
+        "\n"
+        "    static std::vector<Migrated*> s_Instances;\n"
+        "\n"
+        "    double added = 0.5;\n"
+        "    std::string name;\n"
+        "    int count = 0;\n"
+        "\n"
+        "    Migrated();\n"
+        "};\n"
+        "\n"
+        "std::vector<Migrated*> Migrated::s_Instances;\n"
+        "\n"
+        "Migrated::Migrated()\n"
+        "{\n"
+        "    s_Instances.push_back(this);\n"
+        "}\n"
+        "\n"
+        "extern \"C\" HSCPP_API void GetMigrated(size_t i, double& added, std::string& name, int& count)\n"
+        "{\n"
+        "    added = Migrated::s_Instances.at(i)->added;\n"
+        "    name = Migrated::s_Instances.at(i)->name;\n"
+        "    count = Migrated::s_Instances.at(i)->count;\n"
+        "}\n";
+
+    struct MigratedV1
+    {
+        HSCPP_TRACK(MigratedV1, "Migrated");
+        HSCPP_FIELDS(count, name, removed)
+
+        int count = 0;
+        std::string name;
+        int removed = 0;
+    };
+
+    static fs::path CompileModule(const fs::path& sandboxPath, const std::string& fileName, const std::string& source)
+    {
+        CALL(NewFile, sandboxPath / fileName, source);
+
+        REQUIRE_NOTHROW(fs::create_directories(BUILD_DIRECTORY_PATH));
+
+        fs::path buildDirectoryPath = BUILD_DIRECTORY_PATH / ("build-" + platform::CreateGuid());
+        REQUIRE(fs::create_directory(buildDirectoryPath));
+
+        auto pConfig = std::unique_ptr<Config>(new Config());
+        std::unique_ptr<ICompiler> pCompiler = platform::CreateCompiler(&pConfig->compiler);
+
+        ICompiler::Input compileInput;
+        compileInput.buildDirectoryPath = buildDirectoryPath;
+        compileInput.sourceFilePaths.push_back(sandboxPath / fileName);
+        compileInput.sourceFilePaths.push_back(util::GetHscppSourcePath() / "module" / "Module.cpp");
+        compileInput.includeDirectoryPaths.push_back(util::GetHscppIncludePath());
+        compileInput.compileOptions = platform::GetDefaultCompileOptions();
+        compileInput.preprocessorDefinitions = platform::GetDefaultPreprocessorDefinitions();
+
+        bool bStartedBuild = false;
+        auto cb = [&](Milliseconds)
+        {
+            pCompiler->Update();
+            if (!bStartedBuild && pCompiler->IsInitialized())
+            {
+                REQUIRE(pCompiler->StartBuild(compileInput));
+                bStartedBuild = true;
+            }
+
+            if (pCompiler->HasCompiledModule())
+            {
+                return UpdateLoop::Done;
+            }
+
+            return UpdateLoop::Running;
+        };
+
+        CALL(StartUpdateLoop, Milliseconds(60000), Milliseconds(10), cb);
+
+        REQUIRE(pCompiler->HasCompiledModule());
+        return pCompiler->PopModule();
+    }
+
+    TEST_CASE("ModuleManager only unloads modules that are no longer referenced.")
+    {
+        fs::path sandboxPath = CALL(CreateSandboxDirectory);
+        fs::path modulePath = CALL(CompileModule, sandboxPath, "Widget.cpp", WIDGET_SOURCE);
+
+        // A copy of a module is loaded as a separate module.
+        fs::path modulePathCopy = modulePath.parent_path() / ("copy-" + modulePath.filename().u8string());
+        REQUIRE_NOTHROW(fs::copy_file(modulePath, modulePathCopy));
+
+        const uint64_t keyHash = compile_time::HashKey("ModuleWidget");
+
+        ModuleManager moduleManager;
+        REQUIRE(moduleManager.PerformRuntimeSwap(modulePath));
+
+        ModuleSharedState::s_pConstructorsByKey->at(keyHash)->Allocate();
+
+        // The second module is unchanged, so the first module's object is not swapped.
+        REQUIRE(moduleManager.PerformRuntimeSwap(modulePathCopy, [](const fs::path&) { return true; }));
+
+        ModuleSharedState::s_pConstructorsByKey->at(keyHash)->Allocate();
+
+        CompactTrackerTable& table = ModuleSharedState::s_pCompactTrackersByKey->at(keyHash);
+        REQUIRE(table.entries.size() == 2);
+        REQUIRE(table.entries.at(0).pOps != table.entries.at(1).pOps);
+
+        // Each module constructed one of the objects, so neither can be unloaded.
+        REQUIRE(moduleManager.UnloadUnusedModules() == 0);
+
+        std::vector<ModuleManager::ModuleReport> pinnedModules = moduleManager.GetPinnedModules();
+        REQUIRE(pinnedModules.size() == 2);
+        REQUIRE(pinnedModules.at(0).modulePath == modulePath);
+        REQUIRE(pinnedModules.at(0).nConstructors == 0);
+        REQUIRE(pinnedModules.at(0).nInstances == 1);
+        REQUIRE(pinnedModules.at(1).modulePath == modulePathCopy);
+        REQUIRE(pinnedModules.at(1).nConstructors == 1);
+        REQUIRE(pinnedModules.at(1).nInstances == 1);
+
+        // Destroying the first module's object leaves it unused.
+        CompactTrackerTable::Entry entry = table.entries.at(0);
+        entry.pOps->FreeTrackedObject(entry.pObject);
+
+        REQUIRE(moduleManager.UnloadUnusedModules() == 1);
+
+        pinnedModules = moduleManager.GetPinnedModules();
+        REQUIRE(pinnedModules.size() == 1);
+        REQUIRE(pinnedModules.at(0).modulePath == modulePathCopy);
+
+        entry = table.entries.at(0);
+        entry.pOps->FreeTrackedObject(entry.pObject);
+        REQUIRE(table.entries.empty());
+    }
+
+    TEST_CASE("ModuleManager migrates listed fields by name when their layout changes.")
+    {
+        fs::path sandboxPath = CALL(CreateSandboxDirectory);
+        fs::path modulePath = CALL(CompileModule, sandboxPath, "Migrated.cpp", MIGRATED_V2_SOURCE);
+
+        ModuleManager moduleManager;
+
+        // Ownership passes to the registry, as swapping frees the old objects.
+        for (int i = 0; i < 5; ++i)
+        {
+            MigratedV1* pMigrated = new MigratedV1();
+            pMigrated->count = i;
+            pMigrated->name = "A name long enough to be allocated on the heap " + std::to_string(i);
+            pMigrated->removed = -1;
+        }
+
+        const uint64_t keyHash = compile_time::HashKey("Migrated");
+        std::vector<ITracker*>& trackers = ModuleSharedState::s_pTrackersByKey->at(keyHash);
+        REQUIRE(trackers.size() == 5);
+
+        REQUIRE(moduleManager.PerformRuntimeSwap(modulePath));
+        REQUIRE(trackers.size() == 5);
+
+        void* pModule = platform::LoadModule(modulePath);
+        REQUIRE(pModule != nullptr);
+
+        auto GetMigrated = platform::GetModuleFunction<void(size_t, double&, std::string&, int&)>(
+            pModule, "GetMigrated");
+        REQUIRE(GetMigrated != nullptr);
+
+        for (int i = 0; i < 5; ++i)
+        {
+            double added = 0;
+            std::string name;
+            int count = 0;
+            GetMigrated(static_cast<size_t>(i), added, name, count);
+
+            REQUIRE(count == i);
+            REQUIRE(name == "A name long enough to be allocated on the heap " + std::to_string(i));
+            REQUIRE(added == 0.5);
+        }
+
+        while (!trackers.empty())
+        {
+            trackers.back()->FreeTrackedObject();
+        }
+    }
+
+#endif
+
+}}
\ No newline at end of file
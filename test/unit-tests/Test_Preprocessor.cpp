@@ -201,4 +201,127 @@ namespace hscpp { namespace test
             assetsPath / "File-c.cpp",
         });
     }
+
+    TEST_CASE("Preprocessor can process many files across worker threads.")
+    {
+        fs::path sandboxPath = CALL(CreateSandboxDirectory);
+
+        // Each file requires the next, so that every round of preprocessing adds a new file, and
+        // the first file requires all others, such that a single round processes many files.
+        const int nFiles = 64;
+
+        std::string firstFileContents;
+        std::vector<fs::path> expectedSourceFiles;
+        std::vector<std::string> expectedDefinitions;
+
+        for (int i = 0; i < nFiles; ++i)
+        {
+            std::string fileName = "File" + std::to_string(i) + ".cpp";
+            std::string nextFileName = "File" + std::to_string((i + 1) % nFiles) + ".cpp";
+            std::string definition = "FILE" + std::to_string(i);
+
+            std::string contents = "hscpp_require_source(\"" + nextFileName + "\")\n"
+                + "hscpp_require_preprocessor_def(\"" + definition + "\")\n";
+
+            if (i == 0)
+            {
+                firstFileContents = contents;
+            }
+            else
+            {
+                CALL(NewFile, sandboxPath / fileName, contents);
+                firstFileContents += "hscpp_require_source(\"" + fileName + "\")\n";
+            }
+
+            expectedDefinitions.push_back(definition);
+        }
+
+        CALL(NewFile, sandboxPath / "File0.cpp", firstFileContents);
+
+        for (int i = 0; i < nFiles; ++i)
+        {
+            expectedSourceFiles.push_back(CALL(Canonical, sandboxPath / ("File" + std::to_string(i) + ".cpp")));
+        }
+
+        Preprocessor preprocessor;
+        Preprocessor::Output output;
+
+        REQUIRE(preprocessor.Preprocess({ CALL(Canonical, sandboxPath / "File0.cpp") }, output));
+        CALL(ValidateUnorderedVector, output.sourceFiles, expectedSourceFiles);
+        CALL(ValidateUnorderedVector, output.preprocessorDefinitions, expectedDefinitions);
+
+        // Starting from the middle of the chain requires one round per file.
+        REQUIRE(preprocessor.Preprocess({ CALL(Canonical, sandboxPath / "File32.cpp") }, output));
+        CALL(ValidateUnorderedVector, output.sourceFiles, expectedSourceFiles);
+        CALL(ValidateUnorderedVector, output.preprocessorDefinitions, expectedDefinitions);
+    }
+
+    TEST_CASE("Preprocessor skips dependents of headers without semantic changes.")
+    {
+        fs::path sandboxPath = CALL(CreateSandboxDirectory);
+
+        CALL(NewFile, sandboxPath / "Lib.h", "hscpp_module(\"lib\")\nint Lib();\n");
+        CALL(NewFile, sandboxPath / "Lib.cpp", "#include \"Lib.h\"\nhscpp_module(\"lib\")\n");
+        CALL(NewFile, sandboxPath / "User.cpp", "#include \"Lib.h\"\n");
+
+        fs::path libHeaderPath = CALL(Canonical, sandboxPath / "Lib.h");
+        fs::path libSourcePath = CALL(Canonical, sandboxPath / "Lib.cpp");
+        fs::path userSourcePath = CALL(Canonical, sandboxPath / "User.cpp");
+
+        Preprocessor preprocessor;
+        preprocessor.UpdateDependencyGraph({ libHeaderPath, libSourcePath, userSourcePath }, {}, { sandboxPath });
+
+        Preprocessor::Output output;
+
+        SECTION("Comment and whitespace changes do not propagate.")
+        {
+            CALL(NewFile, libHeaderPath, "// Comment.\nhscpp_module(\"lib\")\n\n    int Lib(); // Comment.\n");
+            preprocessor.UpdateDependencyGraph({ libHeaderPath }, {}, { sandboxPath });
+            REQUIRE(!preprocessor.HasSemanticChanges(libHeaderPath));
+
+            REQUIRE(preprocessor.Preprocess({ libHeaderPath }, output));
+            CALL(ValidateUnorderedVector, output.sourceFiles, { libHeaderPath });
+
+            // Source files are still compiled along with their module.
+            REQUIRE(preprocessor.Preprocess({ userSourcePath }, output));
+            CALL(ValidateUnorderedVector, output.sourceFiles, { userSourcePath, libSourcePath });
+        }
+
+        SECTION("Semantic changes propagate.")
+        {
+            CALL(NewFile, libHeaderPath, "hscpp_module(\"lib\")\nint Lib(int n);\n");
+            preprocessor.UpdateDependencyGraph({ libHeaderPath }, {}, { sandboxPath });
+            REQUIRE(preprocessor.HasSemanticChanges(libHeaderPath));
+
+            REQUIRE(preprocessor.Preprocess({ libHeaderPath }, output));
+            CALL(ValidateUnorderedVector, output.sourceFiles, { libHeaderPath, libSourcePath, userSourcePath });
+
+            // Once built, the header is unchanged until it is modified again.
+            preprocessor.CommitSemanticHashes();
+            preprocessor.UpdateDependencyGraph({ libHeaderPath }, {}, { sandboxPath });
+
+            REQUIRE(preprocessor.Preprocess({ libHeaderPath }, output));
+            CALL(ValidateUnorderedVector, output.sourceFiles, { libHeaderPath });
+        }
+
+        SECTION("Semantic changes propagate until they are built.")
+        {
+            CALL(NewFile, libHeaderPath, "hscpp_module(\"lib\")\nint Lib(int n);\n");
+            preprocessor.UpdateDependencyGraph({ libHeaderPath }, {}, { sandboxPath });
+            REQUIRE(preprocessor.HasSemanticChanges(libHeaderPath));
+
+            // The build failed, so the header is saved again with only a comment change.
+            CALL(NewFile, libHeaderPath, "hscpp_module(\"lib\")\nint Lib(int n); // Retry.\n");
+            preprocessor.UpdateDependencyGraph({ libHeaderPath }, {}, { sandboxPath });
+            REQUIRE(preprocessor.HasSemanticChanges(libHeaderPath));
+
+            REQUIRE(preprocessor.Preprocess({ libHeaderPath }, output));
+            CALL(ValidateUnorderedVector, output.sourceFiles, { libHeaderPath, libSourcePath, userSourcePath });
+
+            // Reverting to the built contents is not a semantic change.
+            CALL(NewFile, libHeaderPath, "hscpp_module(\"lib\")\nint Lib();\n");
+            preprocessor.UpdateDependencyGraph({ libHeaderPath }, {}, { sandboxPath });
+            REQUIRE(!preprocessor.HasSemanticChanges(libHeaderPath));
+        }
+    }
 }}
\ No newline at end of file
@@ -0,0 +1,61 @@
+#include "catch/catch.hpp"
+#include "hscpp/preprocessor/SemanticHasher.h"
+
+namespace hscpp { namespace test
+{
+
+    static bool HashesEqual(const std::string& lhs, const std::string& rhs)
+    {
+        SemanticHasher hasher;
+        return hasher.Hash(lhs) == hasher.Hash(rhs);
+    }
+
+    TEST_CASE("SemanticHasher ignores comments and formatting.")
+    {
+        std::string code = "struct A\n{\n    int x = 1;\n};\n";
+
+        REQUIRE(HashesEqual(code, "struct A\n{\n    int x = 1;\n};\n"));
+        REQUIRE(HashesEqual(code, "// Comment.\nstruct A\n{\n    int x = 1; // Value.\n};\n"));
+        REQUIRE(HashesEqual(code, "struct A\n{\n\n\tint  x =  1;\n};"));
+        REQUIRE(HashesEqual(code, "struct A /* Block\n comment. */\n{\n    int x = 1;\n};\n"));
+        REQUIRE(HashesEqual(code, "  struct A\r\n{\r\n    int x = 1;\r\n};\r\n\r\n"));
+
+        REQUIRE(!HashesEqual(code, "struct A\n{\n    int x = 2;\n};\n"));
+        REQUIRE(!HashesEqual(code, "struct B\n{\n    int x = 1;\n};\n"));
+    }
+
+    TEST_CASE("SemanticHasher distinguishes newlines from spaces.")
+    {
+        // Newlines end preprocessor directives, so joining lines changes meaning.
+        REQUIRE(!HashesEqual("#define A\nint x;", "#define A int x;"));
+        REQUIRE(!HashesEqual("#define A /*\n*/ int x;", "#define A /* */ int x;"));
+
+        REQUIRE(HashesEqual("#define A\nint x;", "#define A // Comment.\nint x;"));
+        REQUIRE(HashesEqual("#define A\nint x;", "#define A /* Comment. */\n\nint x;"));
+    }
+
+    TEST_CASE("SemanticHasher hashes literals verbatim.")
+    {
+        REQUIRE(!HashesEqual("auto s = \"a  b\";", "auto s = \"a b\";"));
+        REQUIRE(!HashesEqual("auto s = \"// a\";", "auto s = \"// b\";"));
+        REQUIRE(!HashesEqual("auto s = \"/* a */\";", "auto s = \"/* b */\";"));
+        REQUIRE(!HashesEqual("auto s = \"\\\" // a\";", "auto s = \"\\\" // b\";"));
+        REQUIRE(!HashesEqual("char c = '\"'; // \"a\"\nint x;", "char c = '\"'; // \"b\"\nint y;"));
+        REQUIRE(HashesEqual("char c = '\"'; // \"a\"\nint x;", "char c = '\"'; // \"b\"\nint x;"));
+
+        SECTION("Raw strings may contain quotes and comment markers.")
+        {
+            REQUIRE(!HashesEqual("auto s = R\"(\" // a)\";", "auto s = R\"(\" // b)\";"));
+            REQUIRE(!HashesEqual("auto s = R\"x()\" /* a */)x\";", "auto s = R\"x()\" /* b */)x\";"));
+            REQUIRE(HashesEqual("auto s = u8R\"(a)\"; // a", "auto s = u8R\"(a)\"; // b"));
+        }
+
+        SECTION("Digit separators do not start character literals.")
+        {
+            REQUIRE(HashesEqual("int x = 1'000'000; // '", "int x = 1'000'000; // ''"));
+            REQUIRE(!HashesEqual("int x = 1'000; int y;", "int x = 1'000; int z;"));
+            REQUIRE(HashesEqual("auto c = u8'a'; // a", "auto c = u8'a';"));
+        }
+    }
+
+}}
\ No newline at end of file
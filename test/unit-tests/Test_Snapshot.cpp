@@ -0,0 +1,184 @@
+#include <string>
+#include <vector>
+
+#include "catch/catch.hpp"
+#include "common/Common.h"
+#include "hscpp/Snapshot.h"
+#include "hscpp/module/Tracker.h"
+#include "hscpp/module/Constructors.h"
+
+namespace hscpp { namespace test
+{
+
+    typedef compile_time::String<compile_time::StringSegmentToIntegral("Cached", 0, 6),
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0> CachedKey;
+
+    typedef compile_time::String<compile_time::StringSegmentToIntegral("CompactCached", 0, 13),
+        compile_time::StringSegmentToIntegral("CompactCached", 1, 13),
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0> CompactCachedKey;
+
+    struct Cached
+    {
+        struct Stats
+        {
+            int nHits = 0;
+            double hitRate = 0;
+        };
+
+        // Objects restored from a snapshot must register themselves, as nothing else refers to them.
+        static std::vector<Cached*> s_RestoredObjects;
+
+        Stats stats;
+        std::string name = "Default";
+        std::vector<int> history;
+        int nMisses = 0;
+
+        Tracker<Cached, CachedKey> tracker = { this };
+
+        Cached()
+        {
+            tracker.SwapHandler = [this](SwapInfo& info) {
+                info.Save("stats", stats);
+                info.Save("name", name);
+                info.SaveMove("history", history);
+                info.SaveMove("nMisses", nMisses);
+
+                if (info.IsSnapshot() && info.Phase() == SwapPhase::AfterSwap)
+                {
+                    s_RestoredObjects.push_back(this);
+                }
+            };
+        }
+    };
+
+    std::vector<Cached*> Cached::s_RestoredObjects;
+
+    struct CompactCached
+    {
+        int value = 0;
+        CompactTracker<CompactCached, CompactCachedKey> tracker = { this };
+
+        static void Hscpp_SwapHandler(CompactCached* pObject, SwapInfo& info)
+        {
+            info.Save("value", pObject->value);
+        }
+    };
+
+    TEST_CASE("Snapshot can save and restore the state of tracked objects.")
+    {
+        fs::path sandboxPath = CALL(CreateSandboxDirectory);
+        fs::path snapshotPath = sandboxPath / "snapshot.bin";
+
+        std::unordered_map<uint64_t, std::vector<ITracker*>> trackersByKey;
+        std::unordered_map<uint64_t, CompactTrackerTable> compactTrackersByKey;
+        std::unordered_map<uint64_t, IConstructor*> constructorsByKey;
+
+        ScopedSharedState sharedState;
+
+        ModuleSharedState::s_pTrackersByKey = &trackersByKey;
+        ModuleSharedState::s_pCompactTrackersByKey = &compactTrackersByKey;
+        ModuleSharedState::s_pConstructorsByKey = &constructorsByKey;
+
+        Constructor<Cached> cachedConstructor;
+        Constructor<CompactCached> compactCachedConstructor;
+        constructorsByKey[CachedKey::hash] = &cachedConstructor;
+        constructorsByKey[CompactCachedKey::hash] = &compactCachedConstructor;
+
+        ModuleInterface moduleInterface;
+
+        {
+            std::vector<std::unique_ptr<Cached>> cachedObjects;
+            std::vector<std::unique_ptr<CompactCached>> compactCachedObjects;
+            for (int i = 0; i < 3; ++i)
+            {
+                cachedObjects.emplace_back(new Cached());
+                cachedObjects.back()->stats.nHits = i;
+                cachedObjects.back()->stats.hitRate = i * 0.5;
+                cachedObjects.back()->name = "Cached";
+                cachedObjects.back()->history = { i, i + 1 };
+                cachedObjects.back()->nMisses = i + 1;
+
+                compactCachedObjects.emplace_back(new CompactCached());
+                compactCachedObjects.back()->value = i * 10;
+            }
+
+            REQUIRE(Snapshot::Save(&moduleInterface, snapshotPath));
+            REQUIRE(fs::exists(snapshotPath));
+
+            // Saving a snapshot does not move state out of the objects.
+            for (int i = 0; i < 3; ++i)
+            {
+                CALL(ValidateOrderedVector, cachedObjects.at(i)->history, { i, i + 1 });
+                REQUIRE(cachedObjects.at(i)->nMisses == i + 1);
+            }
+        }
+
+        // Simulate a restart of the process, where no objects exist.
+        REQUIRE(trackersByKey[CachedKey::hash].empty());
+        REQUIRE(compactTrackersByKey[CompactCachedKey::hash].entries.empty());
+
+        REQUIRE(Snapshot::Restore(&moduleInterface, snapshotPath));
+
+        std::vector<ITracker*>& trackers = trackersByKey[CachedKey::hash];
+        CompactTrackerTable& table = compactTrackersByKey[CompactCachedKey::hash];
+        REQUIRE(trackers.size() == 3);
+        REQUIRE(table.entries.size() == 3);
+
+        REQUIRE(Cached::s_RestoredObjects.size() == 3);
+
+        std::vector<int> nHits;
+        for (Cached* pCached : Cached::s_RestoredObjects)
+        {
+            nHits.push_back(pCached->stats.nHits);
+            REQUIRE(pCached->stats.hitRate == pCached->stats.nHits * 0.5);
+
+            // Strings and vectors are not trivially copyable, so they are not kept in a snapshot.
+            REQUIRE(pCached->name == "Default");
+            REQUIRE(pCached->history.empty());
+            REQUIRE(pCached->nMisses == pCached->stats.nHits + 1);
+        }
+        CALL(ValidateUnorderedVector, nHits, { 0, 1, 2 });
+
+        std::vector<int> values;
+        for (const auto& entry : table.entries)
+        {
+            values.push_back(static_cast<CompactCached*>(entry.pObject)->value);
+        }
+        CALL(ValidateUnorderedVector, values, { 0, 10, 20 });
+
+        Cached::s_RestoredObjects.clear();
+
+        while (!trackers.empty())
+        {
+            trackers.back()->FreeTrackedObject();
+        }
+
+        while (!table.entries.empty())
+        {
+            delete static_cast<CompactCached*>(table.entries.back().pObject);
+        }
+
+        SECTION("Invalid snapshots are rejected.")
+        {
+            fs::path invalidPath = sandboxPath / "invalid.bin";
+            {
+                std::ofstream ofs(invalidPath.native().c_str());
+                ofs << "Not a snapshot.";
+            }
+
+            REQUIRE(!Snapshot::Restore(&moduleInterface, invalidPath));
+            REQUIRE(!Snapshot::Restore(&moduleInterface, sandboxPath / "missing.bin"));
+
+            // A truncated snapshot restores none of its objects, rather than those before the cut.
+            fs::path truncatedPath = sandboxPath / "truncated.bin";
+            REQUIRE_NOTHROW(fs::copy_file(snapshotPath, truncatedPath));
+            REQUIRE_NOTHROW(fs::resize_file(truncatedPath, fs::file_size(truncatedPath) / 2));
+
+            REQUIRE(!Snapshot::Restore(&moduleInterface, truncatedPath));
+            REQUIRE(trackers.empty());
+            REQUIRE(table.entries.empty());
+            REQUIRE(Cached::s_RestoredObjects.empty());
+        }
+    }
+
+}}
\ No newline at end of file
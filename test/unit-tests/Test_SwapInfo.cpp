@@ -73,5 +73,79 @@ namespace hscpp { namespace test
         REQUIRE(pDataUnserialized->float2 == 66);
         REQUIRE(pDataUnserialized->pInnerData->int1 == 77);
     }
+    TEST_CASE("SwapInfo does not unserialize items as a different type.")
+    {
+        hscpp::SwapInfo info;
+
+        info.Serialize("value", 10);
+        info.Serialize("name", std::string("name"));
+
+        float floatValue = 0;
+        int intValue = 0;
+        std::string name;
+
+        REQUIRE(!info.Unserialize("value", floatValue));
+        REQUIRE(!info.Unserialize("name", intValue));
+        REQUIRE(!info.Unserialize("missing", intValue));
+        REQUIRE(floatValue == 0);
+        REQUIRE(intValue == 0);
+
+        REQUIRE(info.Unserialize("value", intValue));
+        REQUIRE(info.Unserialize("name", name));
+        REQUIRE(intValue == 10);
+        REQUIRE(name == "name");
+
+        SECTION("Serializing an item again replaces it.")
+        {
+            info.Serialize("value", 2.5f);
+
+            REQUIRE(!info.Unserialize("value", intValue));
+            REQUIRE(info.Unserialize("value", floatValue));
+            REQUIRE(floatValue == 2.5f);
+        }
+    }
+
+    TEST_CASE("SwapInfo can share an arena between many items.")
+    {
+        SerializerArena arena(64);
+
+        // Allocations larger than a block, or with large alignments, are still satisfied.
+        struct alignas(32) Aligned
+        {
+            uint8_t bytes[100] = {};
+        };
+
+        uint8_t* pAligned = arena.Allocate(sizeof(Aligned), alignof(Aligned));
+        REQUIRE(reinterpret_cast<uintptr_t>(pAligned) % alignof(Aligned) == 0);
+
+        std::vector<std::unique_ptr<Serializer>> serializers;
+        for (int i = 0; i < 10; ++i)
+        {
+            serializers.emplace_back(new Serializer());
+            serializers.back()->SetArena(&arena);
+
+            for (int iField = 0; iField < 100; ++iField)
+            {
+                serializers.back()->SerializeCopy("field" + std::to_string(iField), i * iField);
+                serializers.back()->SerializeMove("string" + std::to_string(iField),
+                    std::string(64, static_cast<char>('a' + iField % 26)));
+            }
+        }
+
+        for (int i = 0; i < 10; ++i)
+        {
+            for (int iField = 0; iField < 100; ++iField)
+            {
+                int value = -1;
+                std::string str;
+
+                REQUIRE(serializers.at(i)->UnserializeCopy("field" + std::to_string(iField), value));
+                REQUIRE(serializers.at(i)->UnserializeMove("string" + std::to_string(iField), str));
+
+                REQUIRE(value == i * iField);
+                REQUIRE(str == std::string(64, static_cast<char>('a' + iField % 26)));
+            }
+        }
+    }
 
 }}
\ No newline at end of file
@@ -0,0 +1,341 @@
+#include <memory>
+#include <string>
+
+#include "catch/catch.hpp"
+#include "common/Common.h"
+#include "hscpp/module/Tracker.h"
+#include "hscpp/module/ModuleInterface.h"
+
+namespace hscpp { namespace test
+{
+
+    // Key for "Tracked", packed as done by HSCPP_TRACK.
+    typedef compile_time::String<compile_time::StringSegmentToIntegral("Tracked", 0, 7),
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0> TrackedKey;
+
+    typedef compile_time::String<compile_time::StringSegmentToIntegral("CompactTracked", 0, 14),
+        compile_time::StringSegmentToIntegral("CompactTracked", 1, 14),
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0> CompactTrackedKey;
+
+    typedef compile_time::String<compile_time::StringSegmentToIntegral("Relocated", 0, 9),
+        compile_time::StringSegmentToIntegral("Relocated", 1, 9),
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0> RelocatedKey;
+
+    struct Tracked
+    {
+        Tracker<Tracked, TrackedKey> tracker = { this };
+    };
+
+    struct CompactTracked
+    {
+        int value = 0;
+        CompactTracker<CompactTracked, CompactTrackedKey> tracker = { this };
+
+        static void Hscpp_SwapHandler(CompactTracked* pObject, SwapInfo& info)
+        {
+            info.Save("value", pObject->value);
+        }
+    };
+
+    TEST_CASE("Tracker can register and unregister itself in any order.")
+    {
+        std::unordered_map<uint64_t, std::vector<ITracker*>> trackersByKey;
+
+        ScopedSharedState sharedState;
+        ModuleSharedState::s_pTrackersByKey = &trackersByKey;
+
+        std::vector<std::unique_ptr<Tracked>> trackedObjects;
+        for (int i = 0; i < 100; ++i)
+        {
+            trackedObjects.emplace_back(new Tracked());
+        }
+
+        std::vector<ITracker*>& trackers = trackersByKey[TrackedKey::hash];
+        REQUIRE(trackers.size() == 100);
+
+        for (size_t i = 0; i < trackedObjects.size(); ++i)
+        {
+            REQUIRE(trackers.at(i) == &trackedObjects.at(i)->tracker);
+        }
+
+        // Remove from the front, middle, and back, such that trackers are moved between slots.
+        std::vector<size_t> removalOrder = { 0, 50, 98, 10, 10, 0 };
+        for (size_t iRemove : removalOrder)
+        {
+            trackedObjects.erase(trackedObjects.begin() + iRemove);
+            REQUIRE(trackers.size() == trackedObjects.size());
+
+            for (const auto& pTracked : trackedObjects)
+            {
+                REQUIRE(std::find(trackers.begin(), trackers.end(), &pTracked->tracker) != trackers.end());
+            }
+        }
+
+        trackedObjects.clear();
+        REQUIRE(trackers.empty());
+    }
+
+
+    struct Relocated
+    {
+        std::string name;
+        int x = 0;
+        int y = 0;
+        int unlisted = 0;
+        std::vector<int> values;
+
+        Tracker<Relocated, RelocatedKey> tracker = { this };
+
+        HSCPP_FIELDS(name, x, y, values)
+    };
+
+#ifndef HSCPP_DISABLE
+
+    TEST_CASE("Tracker can swap objects in place when their layout is unchanged.")
+    {
+        std::unordered_map<uint64_t, std::vector<ITracker*>> trackersByKey;
+
+        ScopedSharedState sharedState;
+        ModuleSharedState::s_pTrackersByKey = &trackersByKey;
+
+        std::vector<std::unique_ptr<Relocated>> relocatedObjects;
+        for (int i = 0; i < 10; ++i)
+        {
+            relocatedObjects.emplace_back(new Relocated());
+            relocatedObjects.back()->name = "A name long enough to be allocated on the heap " + std::to_string(i);
+            relocatedObjects.back()->values = { i, i + 1 };
+            relocatedObjects.back()->x = i;
+            relocatedObjects.back()->y = -i;
+            relocatedObjects.back()->unlisted = i + 1;
+        }
+
+        IConstructor* pConstructor = Constructors::GetConstructor(RelocatedKey::hash);
+        REQUIRE(pConstructor->GetLayoutInfo().fingerprint != 0);
+        REQUIRE(pConstructor->GetLayoutInfo().fingerprint == trackersByKey[RelocatedKey::hash].front()->GetLayoutFingerprint());
+
+        ModuleInterface moduleInterface;
+
+        SECTION("Objects with a swap handler are not swapped in place.")
+        {
+            relocatedObjects.back()->tracker.SwapHandler = [](SwapInfo&) {};
+            REQUIRE(!moduleInterface.PerformInPlaceRuntimeSwap(trackersByKey[RelocatedKey::hash], pConstructor));
+
+            relocatedObjects.back()->tracker.SwapHandler = nullptr;
+        }
+
+        REQUIRE(moduleInterface.PerformInPlaceRuntimeSwap(trackersByKey[RelocatedKey::hash], pConstructor));
+
+        // Objects keep their address and listed fields, and unlisted fields are default constructed.
+        REQUIRE(trackersByKey[RelocatedKey::hash].size() == 10);
+        for (int i = 0; i < 10; ++i)
+        {
+            const auto& pRelocated = relocatedObjects.at(i);
+
+            REQUIRE(pRelocated->name == "A name long enough to be allocated on the heap " + std::to_string(i));
+            CALL(ValidateOrderedVector, pRelocated->values, { i, i + 1 });
+            REQUIRE(pRelocated->x == i);
+            REQUIRE(pRelocated->y == -i);
+            REQUIRE(pRelocated->unlisted == 0);
+        }
+
+        relocatedObjects.clear();
+        REQUIRE(trackersByKey[RelocatedKey::hash].empty());
+    }
+
+    typedef compile_time::String<compile_time::StringSegmentToIntegral("VirtualBase", 0, 11),
+        compile_time::StringSegmentToIntegral("VirtualBase", 1, 11),
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0> VirtualBaseKey;
+
+    struct Base
+    {
+        virtual ~Base() = default;
+
+        int baseValue = 0;
+    };
+
+    // Fields in a virtual base can only be found through a constructed object.
+    struct VirtualBase : virtual Base
+    {
+        std::string name;
+
+        Tracker<VirtualBase, VirtualBaseKey> tracker = { this };
+
+        HSCPP_FIELDS(baseValue, name)
+    };
+
+    TEST_CASE("Tracker can swap objects with fields in a virtual base in place.")
+    {
+        std::unordered_map<uint64_t, std::vector<ITracker*>> trackersByKey;
+
+        ScopedSharedState sharedState;
+        ModuleSharedState::s_pTrackersByKey = &trackersByKey;
+
+        std::unique_ptr<VirtualBase> pObject(new VirtualBase());
+        pObject->baseValue = 5;
+        pObject->name = "A name long enough to be allocated on the heap";
+
+        IConstructor* pConstructor = Constructors::GetConstructor(VirtualBaseKey::hash);
+        REQUIRE(pConstructor->GetLayoutInfo().fingerprint != 0);
+
+        ModuleInterface moduleInterface;
+        REQUIRE(moduleInterface.PerformInPlaceRuntimeSwap(trackersByKey[VirtualBaseKey::hash], pConstructor));
+
+        REQUIRE(pObject->baseValue == 5);
+        REQUIRE(pObject->name == "A name long enough to be allocated on the heap");
+
+        pObject.reset();
+        REQUIRE(trackersByKey[VirtualBaseKey::hash].empty());
+    }
+
+    struct Declared
+    {
+        HSCPP_TRACK(Declared, "Declared");
+    };
+
+    TEST_CASE("Tracker registers the file declaring its class.")
+    {
+        uint64_t keyHash = compile_time::HashKey("Declared");
+
+        fs::path classFilePath = Constructors::GetClassFilePath(keyHash);
+        REQUIRE(classFilePath.filename() == "Test_Tracker.cpp");
+
+        // Classes without HSCPP_TRACK have no known file.
+        REQUIRE(Constructors::GetClassFilePath(RelocatedKey::hash).empty());
+    }
+
+#endif
+
+    TEST_CASE("CompactTracker stores objects in a per-type table.")
+    {
+        std::unordered_map<uint64_t, CompactTrackerTable> compactTrackersByKey;
+
+        ScopedSharedState sharedState;
+        ModuleSharedState::s_pCompactTrackersByKey = &compactTrackersByKey;
+
+        // Objects only carry their index into the table.
+        REQUIRE(sizeof(CompactTracker<CompactTracked, CompactTrackedKey>) == sizeof(uint32_t));
+
+        std::vector<std::unique_ptr<CompactTracked>> trackedObjects;
+        for (int i = 0; i < 100; ++i)
+        {
+            trackedObjects.emplace_back(new CompactTracked());
+            trackedObjects.back()->value = i;
+        }
+
+        CompactTrackerTable& table = compactTrackersByKey[CompactTrackedKey::hash];
+        REQUIRE(table.entries.size() == 100);
+        REQUIRE(table.entries.front().pOps != nullptr);
+
+        SECTION("Objects can be removed in any order.")
+        {
+            std::vector<size_t> removalOrder = { 0, 50, 98, 10, 10, 0 };
+            for (size_t iRemove : removalOrder)
+            {
+                trackedObjects.erase(trackedObjects.begin() + iRemove);
+                REQUIRE(table.entries.size() == trackedObjects.size());
+
+                for (size_t i = 0; i < table.entries.size(); ++i)
+                {
+                    REQUIRE(*table.entries.at(i).piSlot == i);
+                }
+            }
+
+            trackedObjects.clear();
+            REQUIRE(table.entries.empty());
+        }
+
+        SECTION("Objects are swapped with their state preserved.")
+        {
+            // Ownership passes to the table, as swapping frees the old objects.
+            for (auto& pTrackedObject : trackedObjects)
+            {
+                pTrackedObject.release();
+            }
+
+            ModuleInterface moduleInterface;
+            moduleInterface.PerformCompactRuntimeSwap(table,
+                    Constructors::GetConstructor(CompactTrackedKey::hash));
+
+            REQUIRE(table.entries.size() == 100);
+            for (size_t i = 0; i < table.entries.size(); ++i)
+            {
+                auto pObject = static_cast<CompactTracked*>(table.entries.at(i).pObject);
+                REQUIRE(pObject->value == static_cast<int>(i));
+            }
+
+            while (!table.entries.empty())
+            {
+                delete static_cast<CompactTracked*>(table.entries.back().pObject);
+            }
+        }
+    }
+
+    TEST_CASE("Tracked objects can be swapped incrementally in batches.")
+    {
+        bool bSwapping = false;
+        std::unordered_map<uint64_t, std::vector<ITracker*>> trackersByKey;
+        std::unordered_map<uint64_t, CompactTrackerTable> compactTrackersByKey;
+        std::unordered_map<uint64_t, IConstructor*> constructorsByKey;
+
+        ScopedSharedState sharedState;
+
+        ModuleSharedState::s_pbSwapping = &bSwapping;
+        ModuleSharedState::s_pTrackersByKey = &trackersByKey;
+        ModuleSharedState::s_pCompactTrackersByKey = &compactTrackersByKey;
+        ModuleSharedState::s_pConstructorsByKey = &constructorsByKey;
+
+        // Ownership passes to the registries, as swapping frees the old objects.
+        std::vector<Tracked*> trackedObjects;
+        std::vector<CompactTracked*> compactTrackedObjects;
+        for (int i = 0; i < 10; ++i)
+        {
+            trackedObjects.push_back(new Tracked());
+            compactTrackedObjects.push_back(new CompactTracked());
+            compactTrackedObjects.back()->value = i;
+        }
+
+        std::vector<ITracker*>& trackers = trackersByKey[TrackedKey::hash];
+        CompactTrackerTable& table = compactTrackersByKey[CompactTrackedKey::hash];
+
+        ModuleInterface moduleInterface;
+        std::unordered_map<uint64_t, std::vector<ITracker*>> pendingTrackersByKey;
+
+        moduleInterface.BeginIncrementalRuntimeSwap({}, pendingTrackersByKey);
+        REQUIRE(bSwapping);
+        REQUIRE(trackers.empty());
+        REQUIRE(table.entries.empty());
+        REQUIRE(pendingTrackersByKey[TrackedKey::hash].size() == 10);
+        REQUIRE(table.pendingEntries.size() == 10);
+
+        // Objects destroyed before being swapped are removed from the pending registries.
+        delete trackedObjects.at(3);
+        delete compactTrackedObjects.at(3);
+        REQUIRE(pendingTrackersByKey[TrackedKey::hash].size() == 9);
+        REQUIRE(table.pendingEntries.size() == 9);
+
+        REQUIRE(moduleInterface.PerformRuntimeSwapBatch(pendingTrackersByKey, 4) == 14);
+        REQUIRE(trackers.size() + table.entries.size() == 4);
+
+        REQUIRE(moduleInterface.PerformRuntimeSwapBatch(pendingTrackersByKey, 100) == 0);
+        REQUIRE(trackers.size() == 9);
+        REQUIRE(table.entries.size() == 9);
+
+        std::vector<int> values;
+        for (const auto& entry : table.entries)
+        {
+            values.push_back(static_cast<CompactTracked*>(entry.pObject)->value);
+        }
+        CALL(ValidateUnorderedVector, values, { 0, 1, 2, 4, 5, 6, 7, 8, 9 });
+
+        while (!trackers.empty())
+        {
+            trackers.back()->FreeTrackedObject();
+        }
+
+        while (!table.entries.empty())
+        {
+            delete static_cast<CompactTracked*>(table.entries.back().pObject);
+        }
+    }
+
+}}
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include "common/Common.h"
 
 #include "hscpp/mem/MemoryManager.h"
+#include "hscpp/module/Tracker.h"
 #include "hscpp/Platform.h"
 #include "hscpp/Util.h"
 #include "hscpp/Hotswapper.h"
@@ -16,20 +17,34 @@ namespace hscpp { namespace test {
     template <typename T>
     using Ref = hscpp::mem::Ref<T>;
 
-    void RunTest(const std::function<void(UniqueRef<hscpp::mem::MemoryManager>)>& cb)
-    {
-        UniqueRef<hscpp::mem::MemoryManager> rMemoryManager = hscpp::mem::MemoryManager::Create();
-        CALL(cb, std::move(rMemoryManager));
-
-        hscpp::Hotswapper swapper;
-
-        hscpp::mem::MemoryManager::Config config;
-        config.pAllocationResolver = swapper.GetAllocationResolver();
+    template <typename T>
+    using SharedRef = hscpp::mem::SharedRef<T>;
 
-        rMemoryManager = hscpp::mem::MemoryManager::Create(config);
-        swapper.SetAllocator(&rMemoryManager);
+    template <typename T>
+    using WeakRef = hscpp::mem::WeakRef<T>;
 
-        CALL(cb, std::move(rMemoryManager));
+    void RunTest(const std::function<void(UniqueRef<hscpp::mem::MemoryManager>)>& cb)
+    {
+        std::vector<hscpp::mem::MemoryManager::Config> configs(4);
+        configs.at(1).bUseSlabs = true;
+        configs.at(2).arenaSize = 64 * 1024 * 1024;
+        configs.at(3).bUseSlabs = true;
+        configs.at(3).arenaSize = 64 * 1024 * 1024;
+        configs.at(3).bUseHugePages = true;
+
+        for (hscpp::mem::MemoryManager::Config& config : configs)
+        {
+            UniqueRef<hscpp::mem::MemoryManager> rMemoryManager = hscpp::mem::MemoryManager::Create(config);
+            CALL(cb, std::move(rMemoryManager));
+
+            hscpp::Hotswapper swapper;
+            config.pAllocationResolver = swapper.GetAllocationResolver();
+
+            rMemoryManager = hscpp::mem::MemoryManager::Create(config);
+            swapper.SetAllocator(&rMemoryManager);
+
+            CALL(cb, std::move(rMemoryManager));
+        }
     }
 
     TEST_CASE("MemoryManager can handle basic allocations.")
@@ -162,4 +177,694 @@ namespace hscpp { namespace test {
 
         CALL(RunTest, cb);
     }
+
+    TEST_CASE("MemoryManager can allocate swapped instances contiguously.")
+    {
+        auto cb = [](UniqueRef<hscpp::mem::MemoryManager> rMemoryManager){
+            struct Data
+            {
+                int value = 0;
+                std::string str;
+            };
+
+            std::vector<UniqueRef<Data>> data;
+
+            size_t nData = 100;
+            for (size_t i = 0; i < nData; ++i)
+            {
+                data.push_back(rMemoryManager->Allocate<Data>());
+                data.back()->value = static_cast<int>(i);
+            }
+
+            // Swap every instance, as done by hscpp during a runtime swap.
+            IAllocator* pAllocator = rMemoryManager.operator->();
+
+            std::vector<uint64_t> ids;
+            for (auto& rData : data)
+            {
+                Data* pData = rData.operator->();
+                pData->~Data();
+
+                ids.push_back(pAllocator->Hscpp_FreeSwap(reinterpret_cast<uint8_t*>(pData)));
+            }
+
+            uint64_t size = sizeof(typename std::aligned_storage<sizeof(Data)>::type);
+
+            std::vector<AllocationInfo> infos(nData);
+            pAllocator->Hscpp_AllocateSwapBatch(ids.data(), nData, size, alignof(Data), infos.data());
+
+            ptrdiff_t stride = infos.at(1).pMemory - infos.at(0).pMemory;
+            REQUIRE(stride >= static_cast<ptrdiff_t>(size));
+
+            for (size_t i = 0; i < nData; ++i)
+            {
+                REQUIRE(infos.at(i).id == ids.at(i));
+                REQUIRE(infos.at(i).pMemory - infos.at(0).pMemory == stride * static_cast<ptrdiff_t>(i));
+                REQUIRE(reinterpret_cast<uintptr_t>(infos.at(i).pMemory) % alignof(Data) == 0);
+
+                Data* pData = new (infos.at(i).pMemory) Data;
+                pData->value = static_cast<int>(i) * 2;
+            }
+
+            // Old Refs refer to the new instances.
+            for (size_t i = 0; i < nData; ++i)
+            {
+                REQUIRE(data.at(i)->value == static_cast<int>(i) * 2);
+            }
+
+            // Freeing Blocks within a chunk or slab does not affect the others.
+            for (size_t i = 0; i < nData; i += 2)
+            {
+                data.at(i).Free();
+            }
+
+            for (size_t i = 1; i < nData; i += 2)
+            {
+                REQUIRE(data.at(i)->value == static_cast<int>(i) * 2);
+            }
+
+            data.clear();
+            REQUIRE(rMemoryManager->GetNumBlocks() == 0);
+        };
+
+        CALL(RunTest, cb);
+    }
+
+    TEST_CASE("MemoryManager aligns objects to alignof(T) when using slabs.")
+    {
+        struct alignas(64) Aligned
+        {
+            float values[4] = {};
+        };
+
+        struct Small
+        {
+            char c = 'a';
+        };
+
+        hscpp::mem::MemoryManager::Config config;
+        config.bUseSlabs = true;
+        config.slabSize = 256;
+
+        UniqueRef<hscpp::mem::MemoryManager> rMemoryManager = hscpp::mem::MemoryManager::Create(config);
+
+        std::vector<UniqueRef<Aligned>> aligned;
+        std::vector<UniqueRef<Small>> small;
+        for (size_t i = 0; i < 50; ++i)
+        {
+            aligned.push_back(rMemoryManager->Allocate<Aligned>());
+            small.push_back(rMemoryManager->Allocate<Small>());
+
+            aligned.back()->values[0] = static_cast<float>(i);
+        }
+
+        for (size_t i = 0; i < aligned.size(); ++i)
+        {
+            Aligned* pAligned = aligned.at(i).operator->();
+            REQUIRE(reinterpret_cast<uintptr_t>(pAligned) % alignof(Aligned) == 0);
+            REQUIRE(pAligned->values[0] == static_cast<float>(i));
+            REQUIRE(small.at(i)->c == 'a');
+        }
+
+        // Freed slots are reused by objects of the same size class.
+        Aligned* pFirst = aligned.at(0).operator->();
+        aligned.at(0).Free();
+
+        aligned.at(0) = rMemoryManager->Allocate<Aligned>();
+        REQUIRE(aligned.at(0).operator->() == pFirst);
+
+        // Objects larger than a slab are given a slab of their own.
+        struct Large
+        {
+            uint8_t bytes[1000] = {};
+        };
+
+        UniqueRef<Large> rLarge = rMemoryManager->Allocate<Large>();
+        rLarge->bytes[999] = 1;
+        REQUIRE(rLarge->bytes[999] == 1);
+
+        aligned.clear();
+        small.clear();
+        rLarge.Free();
+        REQUIRE(rMemoryManager->GetNumBlocks() == 0);
+    }
+
+    TEST_CASE("MemoryManager aligns over-aligned objects, with or without slabs.")
+    {
+        auto cb = [](UniqueRef<hscpp::mem::MemoryManager> rMemoryManager){
+            struct alignas(64) Aligned
+            {
+                int value = 0;
+            };
+
+            std::vector<UniqueRef<Aligned>> aligned;
+
+            size_t nAligned = 20;
+            for (size_t i = 0; i < nAligned; ++i)
+            {
+                aligned.push_back(rMemoryManager->Allocate<Aligned>());
+                aligned.back()->value = static_cast<int>(i);
+
+                REQUIRE(reinterpret_cast<uintptr_t>(aligned.back().operator->()) % alignof(Aligned) == 0);
+            }
+
+            // Swapped instances are aligned as well.
+            IAllocator* pAllocator = rMemoryManager.operator->();
+
+            std::vector<uint64_t> ids;
+            for (auto& rAligned : aligned)
+            {
+                Aligned* pAligned = rAligned.operator->();
+                pAligned->~Aligned();
+
+                ids.push_back(pAllocator->Hscpp_FreeSwap(reinterpret_cast<uint8_t*>(pAligned)));
+            }
+
+            std::vector<AllocationInfo> infos(nAligned);
+            pAllocator->Hscpp_AllocateSwapBatch(ids.data(), nAligned, sizeof(Aligned), alignof(Aligned), infos.data());
+
+            for (size_t i = 0; i < nAligned; ++i)
+            {
+                REQUIRE(reinterpret_cast<uintptr_t>(infos.at(i).pMemory) % alignof(Aligned) == 0);
+
+                Aligned* pAligned = new (infos.at(i).pMemory) Aligned;
+                pAligned->value = static_cast<int>(i) * 2;
+            }
+
+            for (size_t i = 0; i < nAligned; ++i)
+            {
+                REQUIRE(aligned.at(i)->value == static_cast<int>(i) * 2);
+            }
+
+            aligned.clear();
+            REQUIRE(rMemoryManager->GetNumBlocks() == 0);
+        };
+
+        CALL(RunTest, cb);
+    }
+
+    TEST_CASE("FastRef follows its object across allocations and swaps.")
+    {
+        auto cb = [](UniqueRef<hscpp::mem::MemoryManager> rMemoryManager){
+            struct Data
+            {
+                int value = 0;
+            };
+
+            using FastRef = hscpp::mem::FastRef<Data>;
+
+            UniqueRef<Data> rFirst = rMemoryManager->Allocate<Data>();
+            rFirst->value = 1;
+
+            FastRef fastRef = rFirst;
+            REQUIRE(fastRef->value == 1);
+
+            // Fill several segments of the Block table, which must not move the first Block.
+            std::vector<UniqueRef<Data>> data;
+            for (size_t i = 0; i < 5000; ++i)
+            {
+                data.push_back(rMemoryManager->Allocate<Data>());
+                data.back()->value = static_cast<int>(i);
+            }
+
+            std::vector<FastRef> fastRefs(data.begin(), data.end());
+            for (size_t i = 0; i < fastRefs.size(); ++i)
+            {
+                REQUIRE(fastRefs.at(i)->value == static_cast<int>(i));
+            }
+
+            REQUIRE(fastRef->value == 1);
+
+            // Swap the first object, as done by hscpp during a runtime swap.
+            IAllocator* pAllocator = rMemoryManager.operator->();
+
+            Data* pFirst = rFirst.operator->();
+            pFirst->~Data();
+
+            uint64_t id = pAllocator->Hscpp_FreeSwap(reinterpret_cast<uint8_t*>(pFirst));
+            AllocationInfo info = pAllocator->Hscpp_AllocateSwapAligned(id, sizeof(Data), alignof(Data));
+
+            Data* pSwapped = new (info.pMemory) Data;
+            pSwapped->value = 2;
+
+            REQUIRE(fastRef->value == 2);
+            REQUIRE(&fastRef == pSwapped);
+
+            data.clear();
+            rFirst.Free();
+            REQUIRE(rMemoryManager->GetNumBlocks() == 0);
+
+#ifndef NDEBUG
+            CHECK_THROWS(fastRef->value);
+            CHECK_THROWS(FastRef()->value);
+#endif
+        };
+
+        CALL(RunTest, cb);
+    }
+
+    TEST_CASE("SharedRef and WeakRef track the lifetime of shared objects.")
+    {
+        auto cb = [](UniqueRef<hscpp::mem::MemoryManager> rMemoryManager){
+            struct Data
+            {
+                int value = 0;
+            };
+
+            SharedRef<Data> rShared = rMemoryManager->Allocate<Data>();
+            rShared->value = 1;
+            REQUIRE(rShared.GetNumSharedRefs() == 1);
+
+            WeakRef<Data> rWeak = rShared;
+            REQUIRE(!rWeak.IsExpired());
+            REQUIRE(rWeak->value == 1);
+
+            // Intentional scope.
+            {
+                SharedRef<Data> rCopy = rShared;
+                REQUIRE(rShared.GetNumSharedRefs() == 2);
+                REQUIRE(rCopy->value == 1);
+
+                SharedRef<Data> rLocked = rWeak.Lock();
+                REQUIRE(rShared.GetNumSharedRefs() == 3);
+                REQUIRE(rLocked->value == 1);
+            }
+
+            REQUIRE(rShared.GetNumSharedRefs() == 1);
+            REQUIRE(rMemoryManager->GetNumBlocks() == 1);
+
+            // A swap does not expire WeakRefs.
+            IAllocator* pAllocator = rMemoryManager.operator->();
+
+            Data* pData = rShared.operator->();
+            pData->~Data();
+
+            uint64_t id = pAllocator->Hscpp_FreeSwap(reinterpret_cast<uint8_t*>(pData));
+            AllocationInfo info = pAllocator->Hscpp_AllocateSwapAligned(id, sizeof(Data), alignof(Data));
+            new (info.pMemory) Data;
+            rShared->value = 2;
+
+            REQUIRE(!rWeak.IsExpired());
+            REQUIRE(rWeak->value == 2);
+            REQUIRE(rShared.GetNumSharedRefs() == 1);
+
+            SharedRef<Data> rMoved = std::move(rShared);
+            REQUIRE(rMoved.GetNumSharedRefs() == 1);
+            REQUIRE(rShared.GetNumSharedRefs() == 0);
+
+            // Freeing the last SharedRef destroys the object and expires WeakRefs, even once the
+            // Block is reused by another object.
+            rMoved.Free();
+            REQUIRE(rMemoryManager->GetNumBlocks() == 0);
+            REQUIRE(rWeak.IsExpired());
+            REQUIRE(rWeak.Lock().GetNumSharedRefs() == 0);
+            CHECK_THROWS(rWeak->value);
+
+            UniqueRef<Data> rReused = rMemoryManager->Allocate<Data>();
+            REQUIRE(rMemoryManager->GetNumBlocks() == 1);
+            REQUIRE(rWeak.IsExpired());
+
+            // Objects owned by a UniqueRef can be observed, but not locked.
+            WeakRef<Data> rWeakUnique = rReused;
+            REQUIRE(!rWeakUnique.IsExpired());
+            REQUIRE(rWeakUnique.Lock().GetNumSharedRefs() == 0);
+
+            rReused.Free();
+            REQUIRE(rWeakUnique.IsExpired());
+        };
+
+        CALL(RunTest, cb);
+    }
+
+    TEST_CASE("MemoryManager can allocate from several threads when thread-safe.")
+    {
+        struct Data
+        {
+            size_t value = 0;
+        };
+
+        for (bool bUseSlabs : { false, true })
+        {
+            hscpp::mem::MemoryManager::Config config;
+            config.bThreadSafe = true;
+            config.bUseSlabs = bUseSlabs;
+
+            UniqueRef<hscpp::mem::MemoryManager> rMemoryManager = hscpp::mem::MemoryManager::Create(config);
+            hscpp::mem::MemoryManager* pMemoryManager = rMemoryManager.operator->();
+
+            SharedRef<Data> rShared = pMemoryManager->Allocate<Data>();
+
+            size_t nThreads = 4;
+            size_t nData = 5000;
+
+            std::vector<std::vector<UniqueRef<Data>>> dataByThread(nThreads);
+            std::vector<std::thread> threads;
+            for (size_t iThread = 0; iThread < nThreads; ++iThread)
+            {
+                threads.emplace_back([&, iThread]() {
+                    std::vector<UniqueRef<Data>>& data = dataByThread.at(iThread);
+                    for (size_t i = 0; i < nData; ++i)
+                    {
+                        data.push_back(pMemoryManager->Allocate<Data>());
+                        data.back()->value = iThread * nData + i;
+
+                        SharedRef<Data> rCopy = rShared;
+
+                        // Free every other object, so that Blocks are reused across threads.
+                        if (i % 2 == 1)
+                        {
+                            data.at(i - 1).Free();
+                        }
+                    }
+                });
+            }
+
+            for (std::thread& thread : threads)
+            {
+                thread.join();
+            }
+
+            REQUIRE(rMemoryManager->GetNumBlocks() == nThreads * nData / 2 + 1);
+            REQUIRE(rShared.GetNumSharedRefs() == 1);
+
+            for (size_t iThread = 0; iThread < nThreads; ++iThread)
+            {
+                for (size_t i = 1; i < nData; i += 2)
+                {
+                    REQUIRE(dataByThread.at(iThread).at(i)->value == iThread * nData + i);
+                }
+            }
+
+            dataByThread.clear();
+            rShared.Free();
+            REQUIRE(rMemoryManager->GetNumBlocks() == 0);
+
+            // Slots cached by this thread, and by the threads that have exited, are returned.
+            rMemoryManager->Compact();
+            REQUIRE(rMemoryManager->GetNumSlabs() == 0);
+        }
+    }
+
+    struct ThreadTracked
+    {
+        size_t value = 0;
+
+        HSCPP_TRACK(ThreadTracked, "ThreadTracked");
+    };
+
+    TEST_CASE("MemoryManager can allocate tracked objects from several threads when thread-safe.")
+    {
+        for (bool bUseSlabs : { false, true })
+        {
+            hscpp::Hotswapper swapper;
+
+            hscpp::mem::MemoryManager::Config config;
+            config.bThreadSafe = true;
+            config.bUseSlabs = bUseSlabs;
+            config.pAllocationResolver = swapper.GetAllocationResolver();
+
+            UniqueRef<hscpp::mem::MemoryManager> rMemoryManager = hscpp::mem::MemoryManager::Create(config);
+            swapper.SetAllocator(&rMemoryManager);
+
+            hscpp::mem::MemoryManager* pMemoryManager = rMemoryManager.operator->();
+
+            size_t nThreads = 4;
+            size_t nData = 2000;
+
+            std::vector<std::vector<UniqueRef<ThreadTracked>>> dataByThread(nThreads);
+            std::vector<std::thread> threads;
+            for (size_t iThread = 0; iThread < nThreads; ++iThread)
+            {
+                threads.emplace_back([&, iThread]() {
+                    std::vector<UniqueRef<ThreadTracked>>& data = dataByThread.at(iThread);
+                    for (size_t i = 0; i < nData; ++i)
+                    {
+                        data.push_back(pMemoryManager->Allocate<ThreadTracked>());
+                        data.back()->value = iThread * nData + i;
+
+                        if (i % 2 == 1)
+                        {
+                            data.at(i - 1).Free();
+                        }
+                    }
+                });
+            }
+
+            for (std::thread& thread : threads)
+            {
+                thread.join();
+            }
+
+            REQUIRE(rMemoryManager->GetNumBlocks() == nThreads * nData / 2);
+
+            for (size_t iThread = 0; iThread < nThreads; ++iThread)
+            {
+                for (size_t i = 1; i < nData; i += 2)
+                {
+                    REQUIRE(dataByThread.at(iThread).at(i)->value == iThread * nData + i);
+                }
+            }
+
+            dataByThread.clear();
+            REQUIRE(rMemoryManager->GetNumBlocks() == 0);
+        }
+    }
+
+    TEST_CASE("WeakRef only locks objects that are still shared, when thread-safe.")
+    {
+        struct Data
+        {
+            size_t value = 0;
+        };
+
+        hscpp::mem::MemoryManager::Config config;
+        config.bThreadSafe = true;
+
+        UniqueRef<hscpp::mem::MemoryManager> rMemoryManager = hscpp::mem::MemoryManager::Create(config);
+        hscpp::mem::MemoryManager* pMemoryManager = rMemoryManager.operator->();
+
+        // Free the last SharedRef on one thread while locking a WeakRef on another. The freed Block
+        // is reused by another shared object, which is released at once.
+        for (size_t i = 0; i < 1000; ++i)
+        {
+            SharedRef<Data> rShared = pMemoryManager->Allocate<Data>();
+            rShared->value = i;
+
+            WeakRef<Data> rWeak = rShared;
+
+            std::thread freeThread([&]() {
+                rShared.Free();
+
+                SharedRef<Data> rReused = pMemoryManager->Allocate<Data>();
+                rReused.Free();
+            });
+
+            SharedRef<Data> rLocked = rWeak.Lock();
+            freeThread.join();
+
+            if (rLocked.GetNumSharedRefs() == 0)
+            {
+                REQUIRE(rWeak.IsExpired());
+            }
+            else
+            {
+                REQUIRE(rLocked.GetNumSharedRefs() == 1);
+                REQUIRE(rLocked->value == i);
+            }
+
+            rLocked.Free();
+            REQUIRE(rMemoryManager->GetNumBlocks() == 0);
+        }
+    }
+
+    TEST_CASE("MemoryManager can compact slabs on swap and on demand.")
+    {
+        struct Data
+        {
+            uint64_t value = 0;
+            uint64_t padding = 0;
+        };
+
+        hscpp::mem::MemoryManager::Config config;
+        config.bUseSlabs = true;
+        config.bCompactOnSwap = true;
+        config.slabSize = 16 * sizeof(Data);
+
+        UniqueRef<hscpp::mem::MemoryManager> rMemoryManager = hscpp::mem::MemoryManager::Create(config);
+        IAllocator* pAllocator = rMemoryManager.operator->();
+
+        std::vector<UniqueRef<Data>> data;
+        for (size_t i = 0; i < 160; ++i)
+        {
+            data.push_back(rMemoryManager->Allocate<Data>());
+            data.back()->value = i;
+        }
+
+        uint64_t nSlabs = rMemoryManager->GetNumSlabs();
+        REQUIRE(nSlabs >= 10);
+
+        // Fragment the slabs, leaving a few objects in each.
+        std::vector<UniqueRef<Data>> liveData;
+        for (size_t i = 0; i < data.size(); ++i)
+        {
+            if (i % 8 == 0)
+            {
+                liveData.push_back(std::move(data.at(i)));
+            }
+        }
+
+        data.clear();
+        REQUIRE(rMemoryManager->GetNumSlabs() == nSlabs);
+
+        // Swap every instance, as done by hscpp during a runtime swap.
+        std::vector<uint64_t> ids;
+        for (auto& rData : liveData)
+        {
+            Data* pData = rData.operator->();
+            pData->~Data();
+
+            ids.push_back(pAllocator->Hscpp_FreeSwap(reinterpret_cast<uint8_t*>(pData)));
+        }
+
+        std::vector<AllocationInfo> infos(ids.size());
+        pAllocator->Hscpp_AllocateSwapBatch(ids.data(), ids.size(), sizeof(Data), alignof(Data), infos.data());
+
+        for (size_t i = 0; i < infos.size(); ++i)
+        {
+            // New instances are sorted by address, and adjacent within each slab of 16 slots.
+            if (i > 0)
+            {
+                REQUIRE(infos.at(i).pMemory > infos.at(i - 1).pMemory);
+            }
+
+            if (i % 16 != 0)
+            {
+                REQUIRE(infos.at(i).pMemory - infos.at(i - 1).pMemory == static_cast<ptrdiff_t>(sizeof(Data)));
+            }
+
+            Data* pData = new (infos.at(i).pMemory) Data;
+            pData->value = i * 8;
+        }
+
+        // The 20 live objects fit in two slabs.
+        REQUIRE(rMemoryManager->GetNumSlabs() == 2);
+        for (size_t i = 0; i < liveData.size(); ++i)
+        {
+            REQUIRE(liveData.at(i)->value == i * 8);
+        }
+
+        // Empty slabs are freed on demand.
+        liveData.resize(10);
+        REQUIRE(rMemoryManager->GetNumSlabs() == 2);
+
+        rMemoryManager->Compact();
+        REQUIRE(rMemoryManager->GetNumSlabs() == 1);
+
+        liveData.clear();
+        rMemoryManager->Compact();
+        REQUIRE(rMemoryManager->GetNumSlabs() == 0);
+        REQUIRE(rMemoryManager->GetNumBlocks() == 0);
+    }
+
+    TEST_CASE("MemoryManager can allocate from a reserved arena.")
+    {
+        struct Data
+        {
+            uint64_t values[8] = {};
+        };
+
+        hscpp::mem::MemoryManager::Config config;
+        config.bUseSlabs = true;
+        config.bCompactOnSwap = true;
+        config.slabSize = 64 * 1024;
+        config.arenaSize = 256 * 1024 * 1024;
+
+        UniqueRef<hscpp::mem::MemoryManager> rMemoryManager = hscpp::mem::MemoryManager::Create(config);
+
+        const hscpp::mem::Arena* pArena = rMemoryManager->GetArena();
+        REQUIRE(pArena != nullptr);
+        REQUIRE(pArena->GetReservedSize() >= config.arenaSize);
+        REQUIRE(pArena->GetCommittedSize() == 0);
+
+        std::vector<UniqueRef<Data>> data;
+        for (size_t i = 0; i < 10000; ++i)
+        {
+            data.push_back(rMemoryManager->Allocate<Data>());
+            data.back()->values[7] = i;
+        }
+
+        // Pages are committed only as slabs are created.
+        uint64_t committedSize = pArena->GetCommittedSize();
+        REQUIRE(committedSize >= 10000 * sizeof(Data));
+        REQUIRE(committedSize < pArena->GetReservedSize());
+
+        for (size_t i = 0; i < data.size(); ++i)
+        {
+            REQUIRE(data.at(i)->values[7] == i);
+        }
+
+        // Freed slabs are reused, rather than committing more of the arena.
+        data.clear();
+        rMemoryManager->Compact();
+        REQUIRE(rMemoryManager->GetNumSlabs() == 0);
+
+        for (size_t i = 0; i < 10000; ++i)
+        {
+            data.push_back(rMemoryManager->Allocate<Data>());
+            data.back()->values[0] = i;
+        }
+
+        REQUIRE(pArena->GetCommittedSize() <= committedSize);
+        REQUIRE(data.back()->values[0] == 9999);
+
+        // Exhausting the arena throws, as new would.
+        hscpp::mem::Arena arena(1024 * 1024, false);
+        REQUIRE(arena.IsValid());
+        REQUIRE(arena.Allocate(512 * 1024) != nullptr);
+        CHECK_THROWS_AS(arena.Allocate(1024 * 1024), std::bad_alloc);
+    }
+
+    TEST_CASE("Arena merges freed ranges, so that allocations of changing sizes fit.")
+    {
+        hscpp::mem::Arena arena(1024 * 1024, false);
+        REQUIRE(arena.IsValid());
+
+        // Keep two generations of allocations alive, as a swap does, with a size that changes on
+        // each generation. Without merging, each generation would use up more of the arena.
+        std::vector<uint8_t*> previous;
+        for (uint64_t iGeneration = 0; iGeneration < 1000; ++iGeneration)
+        {
+            uint64_t size = 1000 + (iGeneration * 4099) % 30000;
+
+            std::vector<uint8_t*> current;
+            for (size_t i = 0; i < 8; ++i)
+            {
+                uint8_t* pMemory = nullptr;
+                REQUIRE_NOTHROW(pMemory = arena.Allocate(size));
+
+                pMemory[0] = static_cast<uint8_t>(i);
+                pMemory[size - 1] = static_cast<uint8_t>(i);
+                current.push_back(pMemory);
+            }
+
+            for (uint8_t* pMemory : previous)
+            {
+                arena.Free(pMemory);
+            }
+
+            previous = current;
+        }
+
+        for (size_t i = 0; i < previous.size(); ++i)
+        {
+            REQUIRE(previous.at(i)[0] == static_cast<uint8_t>(i));
+            arena.Free(previous.at(i));
+        }
+
+        // With every range freed, the arena can be used in full again.
+        uint8_t* pMemory = nullptr;
+        REQUIRE_NOTHROW(pMemory = arena.Allocate(arena.GetReservedSize()));
+        arena.Free(pMemory);
+    }
+
 }}
\ No newline at end of file